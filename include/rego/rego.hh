@@ -7,8 +7,19 @@
 #include "trieste/logging.h"
 #include "trieste/token.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
 #include <initializer_list>
+#include <limits>
+#include <memory_resource>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <thread>
 #include <trieste/trieste.h>
+#include <unordered_map>
 
 /// This namespace provides the C++ API for the library.
 /// It includes all the token types for nodes in the AST, the well-formedness
@@ -231,15 +242,13 @@ namespace rego
   /// @brief The function pointer to the behavior of the built-in.
   using BuiltInBehavior = std::function<Node(const Nodes&)>;
 
-  /// @brief Big Integer implemention based on strings.
+  /// @brief Big Integer implementation based on binary limbs.
   /// @details
-  //  This is a basic, non-optimized implementation of a big integer
-  /// using strings. In most circumstances this would be considerably slower
-  /// than other approaches, but given the way in which Trieste nodes store
-  /// their content as Location objects into a source document, and given how
-  /// this class operates over those Locations, it is actually quite efficient
-  /// when compared to parsing and serializing the Location into a vector of
-  /// unsigned longs.
+  /// Values which fit in 64 bits are held (and operated on) as a native
+  /// integer. Larger values are held as a sign and a vector of 64-bit limbs.
+  /// Trieste nodes store their content as Location objects, so a BigInt
+  /// constructed from a Location keeps it, and loc() returns it unchanged.
+  /// Otherwise the decimal text is produced the first time loc() is called.
   class BigInt
   {
   public:
@@ -365,29 +374,20 @@ namespace rego
     friend std::ostream& operator<<(std::ostream& os, const BigInt& value);
 
   private:
-    struct DivideResult
-    {
-      std::string quotient;
-      std::string remainder;
-    };
-
-    static bool less_than(
-      const std::string_view& lhs, const std::string_view& rhs);
-    static bool greater_than(
-      const std::string_view& lhs, const std::string_view& rhs);
-    static bool equal(const std::string_view& lhs, const std::string_view& rhs);
-    static std::string add(
-      const std::string_view& lhs, const std::string_view& rhs, bool negative);
-    static std::string subtract(
-      const std::string_view& lhs, const std::string_view& rhs, bool negative);
-    static DivideResult divide(
-      const std::string_view& lhs, const std::string_view& rhs);
-    static std::string multiply(
-      const std::string_view& lhs, const std::string_view& rhs);
-    std::string_view digits() const;
-    Location m_loc;
-    static Location Zero;
-    static Location One;
+    static BigInt from_magnitude(bool negative, std::uint64_t magnitude);
+    static BigInt from_limbs(bool negative, std::vector<std::uint64_t> limbs);
+    static int compare(const BigInt& lhs, const BigInt& rhs);
+    std::vector<std::uint64_t> magnitude() const;
+    std::string to_string() const;
+
+    // Values which fit in 64 bits are held in m_value. Larger values are held
+    // as a sign and a magnitude (least significant limb first) in m_limbs.
+    bool m_small;
+    std::int64_t m_value;
+    bool m_negative;
+    std::vector<std::uint64_t> m_limbs;
+    // The decimal text, kept from construction or produced when first needed.
+    mutable std::optional<Location> m_loc;
   };
 
   /// @brief Result of unwrapping a node.
@@ -556,6 +556,15 @@ namespace rego
   /// @return The integer value of the node
   std::optional<BigInt> try_get_int(const Node& node);
 
+  /// @brief Attempts to extract the value of an integer node as a 64-bit
+  /// integer.
+  /// @details Unlike get_int(), this does not allocate. Integers which do not
+  /// fit in 64 bits (and non-integer nodes) produce no value, in which case
+  /// callers should fall back to get_int().
+  /// @param node The node to extract from.
+  /// @return The integer value of the node, if it fits in 64 bits.
+  std::optional<std::int64_t> try_get_int64(const Node& node);
+
   /// @brief Extracts the value of a node as an double
   /// @param node The node to extract from.
   /// @return The double value of the node.
@@ -735,6 +744,74 @@ namespace rego
     /// @endcond
   }
 
+  /// @brief State which built-ins keep for the duration of one evaluation.
+  /// @details
+  /// Some built-ins must return the same value every time they are called
+  /// during a query evaluation (e.g. `time.now_ns` and `uuid.rfc4122`). That
+  /// state belongs to the evaluation rather than to the built-in, as a single
+  /// set of built-ins may be used by several evaluations at once. The virtual
+  /// machine owns one context per evaluation, and makes it current on the
+  /// evaluating thread while the evaluation runs:
+  ///
+  /// ```cpp
+  /// Node call(const Nodes& args)
+  /// {
+  ///   BuiltInContext* context = BuiltInContext::current();
+  ///   Node value = context == nullptr ? nullptr : context->get("my.key");
+  ///   if (value == nullptr)
+  ///   {
+  ///     value = compute(args);
+  ///     if (context != nullptr)
+  ///     {
+  ///       context->put("my.key", value);
+  ///     }
+  ///   }
+  ///
+  ///   return value;
+  /// }
+  /// ```
+  class BuiltInContext
+  {
+  public:
+    /// @brief Gets the context of the evaluation running on this thread.
+    /// @return The context, or nullptr if no evaluation is running.
+    static BuiltInContext* current();
+
+    /// @brief Gets a value stored during this evaluation.
+    /// @param key The key under which the value was stored.
+    /// @return The value, or nullptr if there is none.
+    Node get(const std::string& key) const;
+
+    /// @brief Stores a value for the rest of this evaluation.
+    /// @param key The key under which to store the value.
+    /// @param value The value to store.
+    void put(const std::string& key, Node value);
+
+    /// @brief Removes all stored values.
+    void clear();
+
+    /// @brief Makes a context current on this thread for the lifetime of the
+    /// scope, restoring the previous context (if any) afterwards.
+    class Scope
+    {
+    public:
+      /// @brief Constructor.
+      /// @param context The context to make current.
+      explicit Scope(BuiltInContext& context);
+
+      ~Scope();
+
+      Scope(const Scope&) = delete;
+      Scope& operator=(const Scope&) = delete;
+
+    private:
+      BuiltInContext* m_previous;
+    };
+
+  private:
+    std::map<std::string, Node> m_values;
+  };
+
   /// @brief Struct which defines a built-in function.
   /// @details
   /// You can extend Rego by registering your own built-ins. A built-in is a
@@ -810,6 +887,17 @@ namespace rego
     /// @brief Whether the builtin is available.
     bool available;
 
+    /// @brief Whether the built-in always returns the same result for the
+    /// same arguments, without side effects.
+    /// @details
+    /// The virtual machine shares and memoizes the results of functions which
+    /// call only deterministic built-ins. A built-in which depends on the
+    /// time, on randomness or on the outside world, or which has side effects
+    /// (like `print`), must leave this false. False by default, as nothing is
+    /// known about a custom built-in; the pure built-ins of the standard
+    /// library set it to true where they are created.
+    bool deterministic;
+
     /// @brief Constructor.
     BuiltInDef(
       Location name_, Node decl_, BuiltInBehavior behavior_, bool available_);
@@ -817,6 +905,12 @@ namespace rego
     virtual ~BuiltInDef() = default;
 
     /// @brief Called to clear any persistent state or caching.
+    /// @details
+    /// The Interpreter calls this (through BuiltInsDef::clear) before it
+    /// compiles a query or a bundle. The virtual machine never calls it, as
+    /// its evaluations may run concurrently on different threads: state
+    /// which must only last for one evaluation belongs in the context of that
+    /// evaluation (see BuiltInContext::current) rather than in the built-in.
     virtual void clear();
 
     /// @brief Creates a new built-in.
@@ -895,6 +989,14 @@ namespace rego
     /// otherwise false.
     bool is_deprecated(const Location& version, const Location& name) const;
 
+    /// @brief Determines whether the provided built-in always returns the same
+    /// result for the same arguments.
+    /// @details
+    /// Each built-in declares this with BuiltInDef::deterministic.
+    /// @param name The name to check.
+    /// @return True if the built-in is deterministic, otherwise false.
+    bool is_deterministic(const Location& name) const;
+
     /// @brief Calls the built-in with the provided name and arguments.
     /// @param name The name of the built-in to call.
     /// @param version The Rego version.
@@ -902,6 +1004,17 @@ namespace rego
     /// @return The result of the built-in call.
     Node call(const Location& name, const Location& version, const Nodes& args);
 
+    /// @brief Calls a built-in which has already been looked up.
+    /// @details
+    /// Unlike the overload which takes a name, this does not check whether the
+    /// built-in is deprecated or is being passed the right number of
+    /// arguments. It is intended for callers (such as the virtual machine)
+    /// which check these once, before evaluation.
+    /// @param builtin The built-in to call.
+    /// @param args The arguments to pass to the built-in.
+    /// @return The result of the built-in call.
+    Node call(const BuiltIn& builtin, const Nodes& args) const;
+
     /// @brief Called to clear any persistent state or caching.
     void clear();
 
@@ -958,6 +1071,7 @@ namespace rego
       m_list.clear();
       m_list.insert(allowed.begin(), allowed.end());
       m_builtins.clear();
+      m_generation++;
       return *this;
     }
 
@@ -975,6 +1089,7 @@ namespace rego
       m_list.clear();
       m_list.insert(begin, end);
       m_builtins.clear();
+      m_generation++;
       return *this;
     }
 
@@ -991,6 +1106,7 @@ namespace rego
       m_list.clear();
       m_list.insert(forbidden.begin(), forbidden.end());
       m_builtins.clear();
+      m_generation++;
       return *this;
     }
 
@@ -1009,6 +1125,7 @@ namespace rego
       m_list.clear();
       m_list.insert(begin, end);
       m_builtins.clear();
+      m_generation++;
       return *this;
     }
 
@@ -1016,6 +1133,14 @@ namespace rego
     /// @return A reference to this instance
     BuiltInsDef& allow_all();
 
+    /// @brief Counts the changes made to which built-ins are registered or
+    /// allowed.
+    /// @details
+    /// The virtual machine uses this to tell whether it must resolve the
+    /// calls of its bundle again when it is given the same built-ins.
+    /// @return The number of changes so far.
+    std::size_t generation() const;
+
     /// @brief Creates the standard builtin set.
     /// @return A shared pointer to the created BuiltInsDef.
     static std::shared_ptr<BuiltInsDef> create();
@@ -1034,6 +1159,7 @@ namespace rego
     std::set<Location> m_list;
     std::map<Location, BuiltIn> m_builtins;
     bool m_strict_errors;
+    std::size_t m_generation = 0;
   };
 
   /// @cond
@@ -1105,6 +1231,35 @@ namespace rego
     bool sort_arrays = false,
     const char* list_delim = ",");
 
+  /// @brief Computes a hash of a term which is consistent with term_equal().
+  /// @details
+  /// The term is walked structurally, so no intermediate strings are built.
+  /// Term, Scalar and DataTerm wrappers are ignored.
+  /// @param node The term to hash.
+  /// @return The hash of the term.
+  std::size_t term_hash(const trieste::Node& node);
+
+  /// @brief Determines whether two terms represent the same Rego value.
+  /// @details
+  /// Numbers compare by value (so `1` and `1.0` are equal), strings compare
+  /// by content regardless of quoting, and objects and sets compare without
+  /// regard to the order of their members.
+  /// @param lhs The first term.
+  /// @param rhs The second term.
+  /// @return True if the terms are equal, otherwise false.
+  bool term_equal(const trieste::Node& lhs, const trieste::Node& rhs);
+
+  /// @brief Compares two terms using the Rego total ordering.
+  /// @details
+  /// Values are ordered first by kind (null < boolean < number < string <
+  /// array < object < set) and then by value. The result is zero exactly
+  /// when term_equal() is true.
+  /// @param lhs The first term.
+  /// @param rhs The second term.
+  /// @return A negative value, zero, or a positive value if `lhs` is less
+  /// than, equal to, or greater than `rhs`.
+  int term_compare(const trieste::Node& lhs, const trieste::Node& rhs);
+
   /// @brief The logging level.
   enum class LogLevel : regoEnum
   {
@@ -1456,7 +1611,189 @@ namespace rego
     /// embedders do not need to call it explicitly. It is exposed publicly
     /// only so that callers who want an early diagnostic on a freshly
     /// constructed bundle can do so.
+    ///
+    /// A bundle which passes is marked as verified, and later calls (for
+    /// example, binding the same bundle for every query) return at once. A
+    /// bundle must therefore not be modified once it has been verified.
     void verify() const;
+
+    /// @brief Whether verify() has succeeded on this bundle.
+    /// @return True if the bundle has been verified, otherwise false.
+    bool is_verified() const;
+
+  private:
+    // An atomic flag which is copied along with the rest of the bundle.
+    struct VerifiedFlag
+    {
+      std::atomic<bool> value{false};
+
+      VerifiedFlag() = default;
+
+      VerifiedFlag(const VerifiedFlag& other) : value(other.value.load()) {}
+
+      VerifiedFlag& operator=(const VerifiedFlag& other)
+      {
+        value = other.value.load();
+        return *this;
+      }
+    };
+
+    mutable VerifiedFlag m_verified;
+  };
+
+  /// @brief A compact tagged value, used by the virtual machine for locals.
+  /// @details
+  /// Null, booleans, 64-bit integers and references to the interned strings
+  /// of a bundle are held inline, so producing them does not allocate. All
+  /// other values (collections, floats, large integers and computed strings)
+  /// are held as a Node. Inline values are turned into Nodes by to_node() only
+  /// when they leave the frame, e.g. when they are placed in a collection,
+  /// passed to a built-in or returned as a result.
+  class Value
+  {
+  public:
+    /// @brief The kind of value held.
+    enum class Kind : std::uint8_t
+    {
+      Undefined,
+      Null,
+      False,
+      True,
+      Int,
+      String,
+      Node
+    };
+
+    /// @brief Constructs an undefined value.
+    Value();
+
+    /// @brief Constructs a value from a node.
+    /// @details
+    /// Term and Scalar wrappers are removed. Undefined becomes an undefined
+    /// value and null/boolean nodes are held inline.
+    /// @param node The node to hold.
+    Value(const Node& node);
+
+    /// @brief Constructs a null value.
+    static Value null();
+
+    /// @brief Constructs a boolean value.
+    /// @param value The boolean.
+    static Value boolean(bool value);
+
+    /// @brief Constructs an integer value.
+    /// @param value The integer.
+    static Value integer(std::int64_t value);
+
+    /// @brief Constructs a string value which refers to an interned JSON
+    /// string node.
+    /// @note The node is not copied, and must outlive the value (e.g. the
+    /// node a VirtualMachine interns for an entry of BundleDef::strings).
+    /// @param value The JSONString node.
+    static Value string(const Node& value);
+
+    Value(const Value& other);
+    Value(Value&& other) noexcept;
+    Value& operator=(const Value& other);
+    Value& operator=(Value&& other) noexcept;
+    ~Value();
+
+    /// @brief Gets the kind of value held.
+    Kind kind() const;
+
+    /// @brief Gets the node type that this value would have as a node.
+    Token type() const;
+
+    /// @brief Whether the value is defined.
+    bool is_defined() const;
+
+    /// @brief Gets the integer (only valid for Kind::Int).
+    std::int64_t int_value() const;
+
+    /// @brief Gets the string location (only valid for Kind::String).
+    const Location& string_value() const;
+
+    /// @brief Gets the held node (only valid for Kind::Node).
+    const Node& node() const;
+
+    /// @brief Converts the value to a node, creating one if it is inline.
+    Node to_node() const;
+
+    /// @brief Writes the value to a stream (used for debugging purposes).
+    friend std::ostream& operator<<(std::ostream& os, const Value& value);
+
+  private:
+    void clear();
+
+    Kind m_kind;
+    union
+    {
+      std::int64_t m_int;
+      const Node* m_string;
+      Node m_node;
+    };
+  };
+
+  /// @brief A fixed set of worker threads which share out the tasks of a run
+  /// by work stealing.
+  /// @details
+  /// The indices of a run are dealt out evenly to the workers up front. Each
+  /// worker takes indices from the front of its own queue and, once that is
+  /// empty, steals from the back of the queues of the other workers, so that
+  /// workers which draw cheap tasks help those which draw expensive ones.
+  /// ```cpp
+  /// ThreadPool pool(4);
+  /// pool.run(inputs.size(), [&](std::size_t worker, std::size_t index) {
+  ///   outputs[index] = process(inputs[index]);
+  /// });
+  /// ```
+  class ThreadPool
+  {
+  public:
+    /// @brief Constructor.
+    /// @param num_threads The number of worker threads, or 0 for one per
+    /// hardware thread.
+    explicit ThreadPool(std::size_t num_threads = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// @brief Gets the number of worker threads.
+    std::size_t size() const;
+
+    /// @brief Calls `task(worker, index)` for every index in `[0, count)` on
+    /// the workers, and waits for all of the calls to finish.
+    /// @details
+    /// `worker` is the index (less than size()) of the worker making the call,
+    /// so that a task can keep per-worker state without locking. Runs are
+    /// serialised: a run started while another is in progress waits for it.
+    /// If a task throws, the remaining tasks still run and the first
+    /// exception is rethrown once they have.
+    /// @param count The number of tasks.
+    /// @param task The task to call.
+    void run(
+      std::size_t count,
+      const std::function<void(std::size_t worker, std::size_t index)>& task);
+
+  private:
+    struct Queue;
+
+    void work(std::size_t worker);
+    bool next(std::size_t worker, std::size_t& index);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::mutex m_run_mutex;
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+    const std::function<void(std::size_t, std::size_t)>* m_task;
+    std::size_t m_generation;
+    std::size_t m_busy;
+    std::exception_ptr m_error;
+    bool m_stop;
   };
 
   /// @brief This class implements a virtual machine that can execute compiled
@@ -1464,6 +1801,30 @@ namespace rego
   /// @details
   /// For more information on the IR used by the virtual machine, see
   /// https://www.openpolicyagent.org/docs/ir.
+  ///
+  /// Once the bundle and built-ins have been set, run_entrypoint() and
+  /// run_query() may be called concurrently from several threads on the same
+  /// virtual machine (and so on the same, immutable, Bundle). Each evaluation
+  /// keeps its state, including that of built-ins (see BuiltInContext), to
+  /// itself. Setting the bundle, the built-ins or the limits while evaluations
+  /// are running is not safe. Results share nodes with the bundle and with
+  /// each other, and so must be treated as read-only; the same holds for the
+  /// arguments passed to custom built-ins, which should clone any argument
+  /// they add to a new node.
+  ///
+  /// Rules which depend only on `data` (for example, lookup tables built
+  /// from it with comprehensions) have the same value in every evaluation.
+  /// When the bundle is bound, the virtual machine finds the functions which
+  /// do not read the input, directly or through the functions they call, and
+  /// which call only deterministic built-ins (see
+  /// BuiltInsDef::is_deterministic). The result of such a function is
+  /// computed by the first evaluation which needs it and then shared by all
+  /// later evaluations, until the bundle or the built-ins are set again.
+  ///
+  /// When the bundle is bound, the virtual machine also indexes rules whose
+  /// bodies start by comparing the same path into the input with different
+  /// strings (e.g. `input.method == "GET"`), and only tries the bodies which
+  /// compare it with the string the input holds.
   class VirtualMachine
   {
   public:
@@ -1473,16 +1834,36 @@ namespace rego
     /// input.
     /// @details
     /// The entrypoint must have been specified when the bundle was built
-    /// otherwise an error node will be returned.
+    /// otherwise an error node will be returned. This method is safe to call
+    /// concurrently, from any number of threads, on the same virtual machine.
     /// @param entrypoint The name of the entrypoint plan to execute.
     /// @param input The input to the plan.
     /// @return The result of executing the plan.
     Node run_entrypoint(const Location& entrypoint, Node input) const;
 
+    /// @brief Executes the entrypoint plan in the bundle once for each of a
+    /// batch of inputs, in parallel.
+    /// @details
+    /// The inputs are shared out among the workers of the pool (see
+    /// ThreadPool), which evaluate them against the same bundle. Each worker
+    /// reuses one evaluation state for all of the inputs it evaluates. An
+    /// input which cannot be evaluated results in an error node in its
+    /// position, without affecting the rest of the batch.
+    /// @param entrypoint The name of the entrypoint plan to execute.
+    /// @param inputs The inputs to the plan (Input nodes).
+    /// @param pool The pool of threads on which to evaluate the inputs.
+    /// @return The result of executing the plan for each input, in the order
+    /// of the inputs.
+    Nodes run_entrypoint_batch(
+      const Location& entrypoint,
+      std::span<const Node> inputs,
+      ThreadPool& pool) const;
+
     /// @brief Executes the query plan in the bundle with the provided input.
     /// @details
     /// The bundle must have been built with a query plan, otherwise
-    /// an error node will be returned.
+    /// an error node will be returned. Like run_entrypoint(), this method is
+    /// safe to call concurrently.
     /// @param input The input to the query.
     /// @return The result of executing the query.
     Node run_query(Node input) const;
@@ -1497,6 +1878,11 @@ namespace rego
     BuiltIns builtins() const;
 
     /// @brief Sets the bundle to use during execution.
+    /// @details
+    /// Setting a different bundle lowers and indexes it, and discards the
+    /// results shared between evaluations. Setting the bundle which is
+    /// already in use does nothing, so a bundle must not be changed once it
+    /// has been given to a virtual machine: build a new one instead.
     /// @param bundle The bundle to use.
     /// @return A reference to this virtual machine.
     VirtualMachine& bundle(Bundle bundle);
@@ -1547,8 +1933,75 @@ namespace rego
     /// @return A reference to this virtual machine
     VirtualMachine& max_block_depth(size_t depth);
 
+    /// @brief Gets the maximum number of results of functions with arguments
+    /// which an evaluation memoizes.
+    size_t memo_limit() const;
+
+    /// @brief Sets the maximum number of results of functions with arguments
+    /// which an evaluation memoizes.
+    /// @details
+    /// A function with arguments which calls only deterministic built-ins
+    /// (see BuiltInsDef::is_deterministic) returns the same result whenever
+    /// it is called with the same arguments during an evaluation. If the
+    /// limit is not zero, each evaluation remembers the results of such
+    /// calls, including calls for which the function was undefined, keyed by
+    /// the values of the arguments, so that a function called repeatedly on
+    /// the same values (e.g. `is_allowed(resource)` from several rules) only
+    /// evaluates its body once. Once an evaluation has memoized `limit`
+    /// results it memoizes no more. Results memoized inside a `with` block
+    /// are only used within that block. Zero (the default) disables
+    /// memoization.
+    /// @param limit The maximum number of memoized results per evaluation.
+    /// @return A reference to this virtual machine
+    VirtualMachine& memo_limit(size_t limit);
+
+    /// @brief Gets the total number of statements this virtual machine has
+    /// executed, across all evaluations.
+    /// @details
+    /// Intended for profiling, e.g. to measure statements per second.
+    std::uint64_t stmts_executed() const;
+
+    /// @brief Gets whether evaluations allocate their index and cache tables
+    /// from an arena.
+    bool arena_enabled() const;
+
+    /// @brief Sets whether evaluations allocate their index and cache tables
+    /// from an arena.
+    /// @details
+    /// When enabled, the tables which the virtual machine builds during an
+    /// evaluation (the hashed indexes over the objects and sets it looks up,
+    /// and its caches of function results) are bump-allocated from an arena
+    /// which is released in one step when the evaluation ends. This does not
+    /// cover the nodes built during the evaluation (collections, built-in
+    /// results and errors), which Trieste allocates and reference-counts
+    /// itself on the heap. Off by default.
+    /// @param enabled Whether to use an arena.
+    /// @return A reference to this virtual machine
+    VirtualMachine& arena_enabled(bool enabled);
+
+    /// @brief Counts of the allocations made for the temporaries of
+    /// evaluations.
+    struct AllocationStats
+    {
+      /// @brief The number of allocations made by the temporaries.
+      std::uint64_t allocations;
+      /// @brief The number of bytes allocated by the temporaries.
+      std::uint64_t bytes;
+      /// @brief The number of those allocations which went to the heap. With
+      /// the arena enabled, these are the blocks allocated for the arena.
+      std::uint64_t heap_allocations;
+      /// @brief The number of bytes allocated from the heap.
+      std::uint64_t heap_bytes;
+    };
+
+    /// @brief Gets the allocations made for the temporaries of evaluations,
+    /// across all evaluations.
+    /// @details
+    /// Intended for profiling, e.g. to measure the effect of the arena.
+    AllocationStats allocation_stats() const;
+
   private:
-    typedef std::vector<Node> Frame;
+    typedef std::vector<Value> Frame;
 
     enum class Code
     {
@@ -1561,26 +2014,213 @@ namespace rego
       Error
     };
 
+    /// Hashed side index over the members of an Object (by key) or a Set.
+    /// Members appended to the collection after the last sync() are indexed
+    /// incrementally, so building a collection one insert at a time stays
+    /// linear overall.
+    class TermIndex
+    {
+    public:
+      explicit TermIndex(
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+      void sync(const Node& collection);
+      Node find(
+        const Node& collection, const Node& key, std::size_t key_hash) const;
+      std::size_t size() const;
+
+    private:
+      std::pmr::unordered_multimap<std::size_t, std::size_t> m_positions;
+      std::size_t m_size = 0;
+    };
+
+    // Indexes are keyed by node identity. The owning Node is held alongside
+    // the index so that the address cannot be reused while the entry lives.
+    typedef std::pmr::
+      unordered_map<const NodeDef*, std::pair<Node, TermIndex>>
+        TermIndexes;
+
+    /// Passes allocations on to an upstream resource, counting them.
+    class CountingResource : public std::pmr::memory_resource
+    {
+    public:
+      explicit CountingResource(std::pmr::memory_resource* upstream);
+      void upstream(std::pmr::memory_resource* upstream);
+      std::uint64_t allocations() const;
+      std::uint64_t bytes() const;
+      void reset_counts();
+
+    private:
+      void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+      void do_deallocate(
+        void* p, std::size_t bytes, std::size_t alignment) override;
+      bool do_is_equal(
+        const std::pmr::memory_resource& other) const noexcept override;
+
+      std::pmr::memory_resource* m_upstream;
+      std::uint64_t m_allocations;
+      std::uint64_t m_bytes;
+    };
+
+    /// A half-open range of indices into m_code or m_blocks.
+    struct Range
+    {
+      std::uint32_t begin;
+      std::uint32_t end;
+    };
+
+    /// A bundle statement lowered for execution. Every block of the bundle is
+    /// a contiguous range of m_code, and the blocks nested in a statement are
+    /// a contiguous range of m_blocks, so execution walks adjacent memory
+    /// rather than chasing statement extensions.
+    struct Instruction
+    {
+      bundle::StatementType type;
+      std::int32_t target;
+      bundle::Operand op0;
+      bundle::Operand op1;
+      /// The nested blocks of Block, Not, Scan and With statements.
+      Range blocks;
+      /// The index into m_calls of the target of a Call statement.
+      std::uint32_t call;
+      /// The index into m_rule_indexes of the index over the blocks of a
+      /// Block statement, or NoRuleIndex.
+      std::uint32_t rule_index;
+      /// The index into m_scan_keys of the equality test at the start of the
+      /// body of a Scan statement, or NoScanKey.
+      std::uint32_t scan_key;
+      /// The statement this instruction was lowered from.
+      const bundle::Statement* stmt;
+    };
+
+    /// The target of a call, resolved when the bundle (or the built-ins) are
+    /// bound rather than looked up by name on every call.
+    struct CallTarget
+    {
+      /// The name of the called function, for logging and errors.
+      Location name;
+      /// The built-in to call, or null if the target is a bundle function.
+      BuiltIn builtin;
+      /// The index of the bundle function, or NoFunction if unresolved.
+      std::uint32_t function;
+      /// Whether the target is the `internal.member_2` built-in.
+      bool is_member;
+      /// Whether the call passes the built-in the right number of arguments
+      /// and the built-in is not deprecated.
+      bool is_checked;
+    };
+
+    /// A constant string of the bundle, interned when the bundle is bound so
+    /// that reading it does not create a node or re-derive its key.
+    struct InternedString
+    {
+      /// The JSONString node shared by every read of the constant.
+      Node node;
+      /// The text of the string without its quotes, as used in paths.
+      std::string text;
+      /// The term_hash() of the node.
+      std::size_t hash;
+    };
+
+    static constexpr std::uint32_t NoFunction =
+      std::numeric_limits<std::uint32_t>::max();
+
+    /// An index over a range of sibling blocks (such as the bodies of a rule)
+    /// many of which start by comparing the same path into the input with a
+    /// constant string, e.g. `input.method == "GET"`. Only the blocks
+    /// comparing it with the string the path leads to, and those which do
+    /// not compare it, need to be run.
+    struct RuleIndex
+    {
+      /// The interned strings which are the keys of the path.
+      std::vector<std::uint32_t> path;
+      /// The blocks (as indices into m_blocks) which compare the path with
+      /// each string.
+      std::unordered_map<std::string_view, std::vector<std::uint32_t>> guarded;
+      /// The blocks which do not compare the path.
+      std::vector<std::uint32_t> unguarded;
+      /// The locals which each guarded block resets before its comparison,
+      /// and so which are reset in place of the blocks which are skipped.
+      std::vector<std::uint32_t> resets;
+    };
+
+    static constexpr std::uint32_t NoRuleIndex =
+      std::numeric_limits<std::uint32_t>::max();
+
+    /// A path of interned string keys into the value of an operand.
+    struct Probe
+    {
+      bundle::Operand operand;
+      std::vector<std::uint32_t> path;
+    };
+
+    /// A scan whose body starts by comparing a path into each item (e.g.
+    /// `u.id` in `some u in data.users; u.id == input.user_id`) with a value
+    /// which does not change during the scan. When the scanned collection is
+    /// part of the bundle data, only the items whose value at the path is
+    /// equal to it need to be visited.
+    struct ScanKey
+    {
+      /// The index into m_field_paths of the path into each item.
+      std::uint32_t path;
+      /// The value the path is compared with.
+      Probe probe;
+    };
+
+    static constexpr std::uint32_t NoScanKey =
+      std::numeric_limits<std::uint32_t>::max();
+
+    /// The positions of the items of a collection of the bundle data by their
+    /// string value at a path.
+    struct FieldIndex
+    {
+      std::unordered_map<std::string_view, std::vector<std::uint32_t>>
+        positions;
+      /// The items whose value is an escaped string, which may be equal to a
+      /// string written differently and so are always visited.
+      std::vector<std::uint32_t> escaped;
+    };
+
+    /// The memoized result of a call to a function with arguments.
+    struct FunctionMemo
+    {
+      std::uint32_t function;
+      /// The values of the arguments (after input and data), as an Array.
+      Node args;
+      /// The result, or null if the function was undefined.
+      Node result;
+    };
+
+    typedef std::pmr::unordered_multimap<std::size_t, FunctionMemo>
+      FunctionMemos;
+    typedef std::pmr::vector<std::pmr::map<Location, Node>> FunctionCaches;
+    typedef std::pmr::vector<FunctionMemos> MemoScopes;
+
     class State
     {
     public:
-      State(Node input, Node data, size_t num_locals);
-      Node read_local(size_t index) const;
-      void write_local(size_t index, Node value);
+      State(size_t num_locals, size_t num_functions, bool use_arena);
+      void begin(Node input, Node data);
+      void clear();
+      const Value& read_local(size_t index) const;
+      void write_local(size_t index, Value value);
       bool is_defined(size_t key) const;
       void reset_local(size_t key);
       void add_result(Node node);
       const Nodes& result_set() const;
-      bool is_in_call_stack(const Location& func_name) const;
+      bool is_in_call_stack(std::uint32_t function) const;
       std::string_view root_function_name() const;
-      void push_function(const Location& func_name, size_t num_args);
-      void pop_function(const Location& func_name);
+      void push_function(
+        std::uint32_t function, const Location& func_name, size_t num_args);
+      void pop_function(std::uint32_t function);
       const Nodes& errors() const;
       void add_error(Node error);
       void add_error_multiple_output(Node inst);
       void add_error_object_insert(Node inst);
       void put_function_result(const Location& func_name, Node result);
       Node get_function_result(const Location& func_name) const;
+      const FunctionMemo* find_memo(
+        std::uint32_t function, std::size_t hash, const Node& args) const;
+      void put_memo(std::size_t hash, FunctionMemo memo, size_t limit);
       bool in_with() const;
       void push_with();
       void pop_with();
@@ -1593,52 +2233,187 @@ namespace rego
       size_t block_depth() const;
       void enter_block();
       void leave_block();
+      TermIndex& term_index(const Node& collection);
+      Nodes& builtin_args();
+      BuiltInContext& builtin_context();
+      const CountingResource& temporaries() const;
+      const CountingResource& heap() const;
 
     private:
+      void touch(size_t index);
+
+      // The temporary containers of an evaluation allocate from
+      // m_temporaries, which passes the allocations on either to an arena
+      // (released in one step when the State is cleared) or to the heap.
+      CountingResource m_heap;
+      std::vector<std::byte> m_arena_buffer;
+      std::unique_ptr<std::pmr::monotonic_buffer_resource> m_arena;
+      CountingResource m_temporaries;
       Frame m_frame;
+      // The locals written since the last reset, so that resetting a State
+      // costs O(touched locals) rather than O(local_count).
+      std::vector<std::uint32_t> m_touched;
+      std::vector<bool> m_is_touched;
       Nodes m_errors;
-      BuiltIns m_builtins;
-      std::vector<Location> m_call_stack;
+      std::vector<const Location*> m_call_stack;
+      std::vector<std::uint32_t> m_call_functions;
+      std::vector<bool> m_in_call;
       std::vector<size_t> m_num_args;
-      std::map<Location, Node> m_function_cache;
+      // The cached results of functions without arguments, and the memoized
+      // calls of those with them, for each open with statement (after those
+      // for the evaluation outside of any with statement).
+      FunctionCaches m_function_caches;
+      MemoScopes m_memo_scopes;
+      size_t m_memo_count;
       Nodes m_result_set;
       size_t m_with_count;
       size_t m_break_count;
       size_t m_stmt_count;
       size_t m_block_depth;
+      TermIndexes m_term_indexes;
+      Nodes m_builtin_args;
+      BuiltInContext m_builtin_context;
+    };
+
+    /// Lends a State from the pool of the virtual machine, returning it
+    /// (cleared) to the pool when the lease ends. A lease may be used for
+    /// several evaluations in turn, each started with begin().
+    class StateLease
+    {
+    public:
+      explicit StateLease(const VirtualMachine& vm);
+      ~StateLease();
+      StateLease(const StateLease&) = delete;
+      StateLease& operator=(const StateLease&) = delete;
+      State& begin(Node input);
+
+    private:
+      const VirtualMachine& m_vm;
+      std::unique_ptr<State> m_state;
+      bool m_in_use;
     };
 
-    void run_plan(const bundle::Plan& plan, State& state) const;
-    Code run_block(State& state, const bundle::Block& block) const;
-    Code run_stmt(
-      State& state, size_t index, const bundle::Statement& stmt) const;
-    Code run_scan(State& state, const bundle::Statement& stmt) const;
-    Code run_with(State& state, const bundle::Statement& stmt) const;
+    void intern_strings();
+    void lower();
+    void link();
+    void classify_functions();
+    bool classify(
+      const Instruction& inst,
+      std::vector<std::uint32_t>& callees,
+      bool& reads_input) const;
+    Node shared_result(std::uint32_t function) const;
+    void put_shared_result(std::uint32_t function, const Node& result) const;
+    Range lower_blocks(const bundle::Block* blocks, std::size_t count);
+    Range lower_block(const bundle::Block& block);
+    void index_rules();
+    std::uint32_t index_rules(
+      const Range& blocks,
+      const std::unordered_map<std::size_t, std::uint32_t>& counts);
+    void count_locals(
+      const Range& blocks,
+      std::unordered_map<std::size_t, std::uint32_t>& counts) const;
+    const std::vector<std::uint32_t>* guarded_blocks(
+      State& state, const RuleIndex& index) const;
+    std::uint32_t index_scan(
+      const Instruction& inst,
+      const std::unordered_map<std::size_t, std::uint32_t>& counts);
+    void index_fields(const Node& collection);
+    bool scan_positions(
+      State& state,
+      const Instruction& inst,
+      const Node& source,
+      std::vector<std::uint32_t>& positions) const;
+    template <typename F>
+    void for_each_block(
+      State& state,
+      const Range& blocks,
+      std::uint32_t rule_index,
+      F&& run) const;
+    void run_plan(std::size_t plan, State& state) const;
+    Node entrypoint_results(const State& state) const;
+    Code run_block(State& state, const Range& block) const;
+    Code run_scan(State& state, const Instruction& inst) const;
+    Code run_with(State& state, const Instruction& inst) const;
+    Code run_call_dynamic(State& state, const Instruction& inst) const;
     Code run_call(
       State& state,
-      const Location& func,
+      const CallTarget& call,
+      const std::vector<bundle::Operand>& args,
+      size_t target) const;
+    Code run_builtin(
+      State& state,
+      const CallTarget& call,
       const std::vector<bundle::Operand>& args,
       size_t target) const;
-    Node dot(const Node& source, const Node& key) const;
+    Node find_member(
+      State& state,
+      const Node& collection,
+      const Node& key,
+      std::optional<std::size_t> key_hash = std::nullopt) const;
+    Node dot(
+      State& state,
+      const Node& source,
+      const Node& key,
+      std::optional<std::size_t> key_hash = std::nullopt) const;
     Node merge_objects(const Node& a, const Node& b, size_t depth = 0) const;
     Node merge_sets(const Node& a, const Node& b) const;
     bool insert_into_object(
-      const Node& a, const Node& key, const Node& value, bool once) const;
+      State& state,
+      const Node& a,
+      const Node& key,
+      const Node& value,
+      bool once) const;
     Node to_term(const Node& value) const;
-    Node unpack_operand(
+    Value unpack_operand(
       const State& state, const bundle::Operand& operand) const;
-    Node write_and_swap(
+    Value write_and_swap(
       State& state,
       size_t key,
       const std::vector<size_t>& path,
-      Node value) const;
+      const Value& value) const;
 
     Bundle m_bundle;
+    std::vector<Instruction> m_code;
+    std::vector<Range> m_blocks;
+    std::vector<Range> m_plan_blocks;
+    std::vector<Range> m_function_blocks;
+    std::vector<CallTarget> m_calls;
+    std::vector<RuleIndex> m_rule_indexes;
+    std::vector<std::uint32_t> m_function_rule_indexes;
+    std::vector<ScanKey> m_scan_keys;
+    std::vector<std::vector<std::uint32_t>> m_field_paths;
+    std::map<std::pair<const NodeDef*, std::uint32_t>, FieldIndex>
+      m_field_indexes;
+    std::vector<InternedString> m_strings;
+    // The Int or Float node of each string which a MakeNumberRef statement
+    // refers to, classified once when the bundle is bound (null otherwise).
+    std::vector<Node> m_numbers;
+    TermIndexes m_data_indexes;
+    // Whether the result of each bundle function is shared between
+    // evaluations, and the results computed so far.
+    std::vector<bool> m_shared_functions;
+    mutable std::shared_mutex m_shared_results_mutex;
+    mutable std::vector<Node> m_shared_results;
+    // Whether calls to each bundle function may be memoized by argument.
+    std::vector<bool> m_memo_functions;
     BuiltIns m_builtins;
+    // The generation of m_builtins that the bundle was last linked against.
+    std::size_t m_builtins_generation = 0;
     TRegex m_int_regex;
     size_t m_stmt_limit;
     size_t m_max_call_depth;
     size_t m_max_block_depth;
+    size_t m_memo_limit;
+    mutable std::atomic<std::uint64_t> m_stmts_executed;
+    mutable std::atomic<std::uint64_t> m_allocations;
+    mutable std::atomic<std::uint64_t> m_allocated_bytes;
+    mutable std::atomic<std::uint64_t> m_heap_allocations;
+    mutable std::atomic<std::uint64_t> m_heap_bytes;
+    bool m_arena_enabled;
+    // States which are not in use by an evaluation, kept so that each
+    // evaluation does not have to allocate a frame of local_count locals.
+    mutable std::mutex m_state_pool_mutex;
+    mutable std::vector<std::unique_ptr<State>> m_state_pool;
   };
 
   /// @brief Encapsulates the output of a Rego query.
@@ -1732,6 +2507,73 @@ namespace rego
     std::vector<std::string> errors() const;
   };
 
+  /// @brief A query (and/or set of entrypoints) compiled once, so that it can
+  /// be evaluated many times with different inputs.
+  /// @details
+  /// A prepared query captures the bundle built from the modules, data and
+  /// query of an Interpreter (see Interpreter::prepare), bound to a virtual
+  /// machine of its own. Evaluation does not modify the prepared query, so
+  /// it may be evaluated from several threads at once:
+  /// ```cpp
+  /// Interpreter rego;
+  /// rego.add_module_file("objects.rego");
+  /// rego.add_data_json_file("data0.json");
+  /// rego.set_query("[data.one, input.b, data.objects.sites[1]] = x");
+  /// PreparedQuery query = rego.prepare();
+  /// Node input = rego::object(
+  ///   {rego::object_item(rego::string("b"), rego::number(20))});
+  /// Output output = query->eval(input);
+  /// ```
+  class PreparedQueryDef
+  {
+  public:
+    /// @brief Constructor.
+    /// @param bundle The compiled bundle.
+    /// @param builtins The built-ins to use during evaluation.
+    PreparedQueryDef(Bundle bundle, BuiltIns builtins);
+
+    /// @brief Constructor for a query which could not be compiled.
+    /// @param errors The errors which occurred during compilation.
+    explicit PreparedQueryDef(Node errors);
+
+    /// @brief Whether the query was compiled successfully.
+    bool ok() const;
+
+    /// @brief Gets the errors which occurred during compilation.
+    /// @return An ErrorSeq node, or nullptr if the query is ok.
+    Node errors() const;
+
+    /// @brief Gets the compiled bundle.
+    /// @return The bundle, or nullptr if the query is not ok.
+    Bundle bundle() const;
+
+    /// @brief Evaluates the query plan with the provided input.
+    /// @param input The input, which is either an Input node or a Rego term
+    /// (as built by, e.g., rego::object()). If it is nullptr, the input will
+    /// be undefined.
+    /// @return The result of the query, which will either be a list of
+    /// bindings and terms, or an error sequence.
+    Node eval(const Node& input) const;
+
+    /// @brief Evaluates an entrypoint with the provided input.
+    /// @param entrypoint The entrypoint, which must have been added to the
+    /// interpreter before the query was prepared.
+    /// @param input The input, as for eval().
+    /// @return The result of the entrypoint.
+    Node eval(const std::string& entrypoint, const Node& input) const;
+
+  private:
+    friend class Interpreter;
+
+    Node to_input(const Node& input) const;
+
+    VirtualMachine m_vm;
+    Node m_errors;
+  };
+
+  /// @brief A pointer to a PreparedQueryDef.
+  using PreparedQuery = std::shared_ptr<PreparedQueryDef>;
+
   /// @brief This class forms the main interface to the Rego library.
   /// @details
   /// You can use it to assemble and then execute queries, for example:
@@ -1823,6 +2665,14 @@ namespace rego
     /// @param node The contents of the document.
     Node set_input(const Node& node);
 
+    /// @brief Gets the input document of the interpreter.
+    /// @details
+    /// This is the Input node which is passed to
+    /// VirtualMachine::run_entrypoint and VirtualMachine::run_query. Until an
+    /// input has been set it holds Undefined.
+    /// @return The input node.
+    const Node& input() const;
+
     /// @brief Sets the query expression of the interpreter.
     /// @details
     /// This query will be included when building a bundle.
@@ -1926,6 +2776,18 @@ namespace rego
     /// @return The bundle, or an error node.
     Node build();
 
+    /// @brief Compiles the modules, data, query and entrypoints of the
+    /// interpreter once, for repeated evaluation.
+    /// @details
+    /// Calling query_node() compiles the policy every time, even if only the
+    /// input has changed. A prepared query holds the compiled bundle, and
+    /// can be evaluated against any number of inputs (see PreparedQueryDef).
+    /// Later changes to the interpreter do not affect it. The statement,
+    /// depth and memoization limits of the interpreter are carried over.
+    /// @return The prepared query. If compilation failed, PreparedQueryDef::ok
+    /// will be false and PreparedQueryDef::errors will hold the errors.
+    PreparedQuery prepare();
+
     // clang-format on
 
     /// @brief Saves a bundle to a directory in JSON format.
@@ -1974,6 +2836,53 @@ namespace rego
     /// @return The result of the query
     Node query_bundle(const Bundle& bundle, const std::string& endpoint);
 
+    /// @brief Performs a query against the bundle which was last queried.
+    /// @details
+    /// Unlike query_bundle(const Bundle&), the bundle is not loaded into the
+    /// virtual machine again, and so results which the virtual machine shares
+    /// between evaluations are kept. If no bundle has been queried, this
+    /// will result in an error.
+    /// @return The result of the query
+    Node query_bundle();
+
+    /// @brief Performs a query against an entrypoint of the bundle which was
+    /// last queried.
+    /// @details
+    /// Unlike query_bundle(const Bundle&, const std::string&), the bundle is
+    /// not loaded into the virtual machine again. If no bundle has been
+    /// queried, this will result in an error.
+    /// @param endpoint The entrypoint to execute
+    /// @return The result of the query
+    Node query_bundle(const std::string& endpoint);
+
+    /// @brief Performs a query against a bundle for each of a batch of inputs.
+    /// @details
+    /// The interpreter will load this bundle into its virtual machine and then
+    /// execute the stored entrypoint plan once per input, in parallel on the
+    /// provided pool (see VirtualMachine::run_entrypoint_batch).
+    /// @param bundle The bundle to query
+    /// @param endpoint The entrypoint to execute
+    /// @param inputs The inputs (Input nodes, as returned by input())
+    /// @param pool The pool of threads on which to evaluate the inputs
+    /// @return The result of the query for each input, in the order of the
+    /// inputs
+    Nodes query_bundle_batch(
+      const Bundle& bundle,
+      const std::string& endpoint,
+      std::span<const Node> inputs,
+      ThreadPool& pool);
+
+    /// @brief Gets a pool of worker threads owned by the interpreter, for use
+    /// with query_bundle_batch().
+    /// @details
+    /// The pool is started on first use and kept, so that repeated batches
+    /// reuse its threads rather than starting new ones each time. It is
+    /// started again if a different number of threads is asked for.
+    /// @param num_threads The number of worker threads, or 0 for one per
+    /// hardware thread.
+    /// @return The pool.
+    ThreadPool& thread_pool(std::size_t num_threads = 0);
+
     /// @brief The path to the debug directory.
     /// @details
     /// If set, then (when in debug mode) the interpreter will output
@@ -2009,6 +2918,25 @@ namespace rego
     /// @return True if well-formedness checks are enabled, false otherwise.
     bool wf_check_enabled() const;
 
+    /// @brief Sets whether compiled and loaded bundles are optimized.
+    /// @details
+    /// If true, then the plans and functions of each bundle
+    /// are rewritten after compilation (or after loading from OPA bundle
+    /// JSON) to remove redundant statements: repeated lookups and
+    /// IsDefined checks are removed, copies between locals are propagated,
+    /// statements which only write locals that are never read are removed,
+    /// and nested blocks are flattened where this cannot change which
+    /// statements run. The number of statements in each plan (including
+    /// the functions it calls) before and after is logged at the Info
+    /// level. False by default.
+    /// @param enabled Whether bundles are optimized
+    /// @return a reference to this Interpreter
+    Interpreter& optimize_enabled(bool enabled);
+
+    /// @brief Checks if bundles are optimized.
+    /// @return True if bundles are optimized, false otherwise.
+    bool optimize_enabled() const;
+
     /// @brief The built-ins used by the interpreter.
     /// @details
     /// This object can be used to register custom built-ins created using
@@ -2082,6 +3010,18 @@ namespace rego
     /// @return A reference to this Interpreter
     Interpreter& max_block_depth(size_t depth);
 
+    /// @brief Gets the maximum number of results of functions with arguments
+    /// which an evaluation memoizes.
+    size_t memo_limit() const;
+
+    /// @brief Sets the maximum number of results of functions with arguments
+    /// which an evaluation memoizes.
+    /// @details See @ref VirtualMachine::memo_limit. Zero (the default)
+    /// disables memoization.
+    /// @param limit The maximum number of memoized results per evaluation.
+    /// @return A reference to this Interpreter
+    Interpreter& memo_limit(size_t limit);
+
   private:
     Reader& reader();
     Reader& json();
@@ -2102,6 +3042,7 @@ namespace rego
     std::filesystem::path m_debug_path;
     bool m_debug_enabled;
     bool m_wf_check_enabled;
+    bool m_optimize_enabled;
     LogLevel m_log_level;
 
     BuiltIns m_builtins;
@@ -2114,6 +3055,8 @@ namespace rego
     std::unique_ptr<Rewriter> m_write_bundle;
     std::unique_ptr<Rewriter> m_read_bundle;
     VirtualMachine m_vm;
+    std::unique_ptr<ThreadPool> m_thread_pool;
+    std::size_t m_thread_pool_threads;
     std::size_t m_data_count;
     std::map<std::string, Node> m_cache;
 
@@ -2291,11 +3234,17 @@ namespace rego
   Rewriter rego_to_yaml();
 
   /// @brief Rewrites an OPA bundle JSON to a Bundle AST.
-  Rewriter json_to_bundle();
+  /// @param optimize Whether to run the optimization passes over the plans
+  /// and functions of the bundle (see Interpreter::optimize_enabled).
+  Rewriter json_to_bundle(bool optimize = false);
 
   /// @brief Rewrites a Bundle AST to a JSON AST in OPA bundle JSON format.
   Rewriter bundle_to_json();
 
   /// @brief Rewrites a Rego AST to a Bundle AST.
-  Rewriter rego_to_bundle(BuiltIns builtins = BuiltInsDef::create());
+  /// @param builtins The built-ins available to the policy.
+  /// @param optimize Whether to run the optimization passes over the plans
+  /// and functions of the bundle (see Interpreter::optimize_enabled).
+  Rewriter rego_to_bundle(
+    BuiltIns builtins = BuiltInsDef::create(), bool optimize = false);
 }
\ No newline at end of file
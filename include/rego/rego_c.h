@@ -25,6 +25,9 @@ typedef void regoBundle;
 /// @brief Opaque input type
 typedef void regoInput;
 
+/// @brief Opaque prepared query type
+typedef void regoPreparedQuery;
+
 /// @brief Boolean type
 typedef uint_least8_t regoBoolean;
 
@@ -496,6 +499,86 @@ extern "C"
   regoBundleQueryEntrypoint(
     regoInterpreter* rego, regoBundle* bundle, const char* endpoint);
 
+  /// @brief Performs a query against the specified bundle at the specified
+  /// entrypoint for each of a batch of inputs.
+  /// @details
+  /// The inputs are evaluated in parallel on a pool of `num_threads` threads
+  /// (or one per hardware thread if `num_threads` is 0), against the same
+  /// bundle. The interpreter keeps the pool between calls, so repeated
+  /// batches with the same `num_threads` reuse its threads. The output for
+  /// each input is written to the corresponding position of `outputs`, which
+  /// must have room for `count` pointers. The output for an input which could
+  /// not be evaluated will be an error sequence.
+  /// @note The caller is responsible for freeing each output object with
+  /// ::regoFreeOutput. The inputs are not consumed.
+  /// @param rego The interpreter.
+  /// @param bundle The bundle to query.
+  /// @param endpoint The entrypoint to query.
+  /// @param inputs The inputs, each built as for ::regoSetInput.
+  /// @param count The number of inputs.
+  /// @param num_threads The number of threads to use, or 0 for the default.
+  /// @param outputs The array which will receive the outputs.
+  /// @return REGO_OK if successful, REGO_ERROR otherwise.
+  REGO_API(regoEnum)
+  regoBundleQueryEntrypointBatch(
+    regoInterpreter* rego,
+    regoBundle* bundle,
+    const char* endpoint,
+    regoInput** inputs,
+    regoSize count,
+    regoSize num_threads,
+    regoOutput** outputs);
+
+  /// @brief Compiles the modules, data, query and entrypoints of the
+  /// interpreter for repeated evaluation.
+  /// @details
+  /// The policy is compiled once, and the resulting prepared query can then
+  /// be evaluated with ::regoPreparedQueryEval or
+  /// ::regoPreparedQueryEvalEntrypoint against any number of inputs, without
+  /// recompiling. A prepared query is independent of the interpreter: later
+  /// changes to the interpreter do not affect it, and it may be evaluated
+  /// from several threads at once.
+  /// @note The caller is responsible for freeing the prepared query with
+  /// ::regoFreePreparedQuery.
+  /// @param rego The interpreter.
+  /// @return The prepared query, or NULL if there was an error (in which case
+  /// the error can be retrieved with ::regoGetError).
+  REGO_API(regoPreparedQuery*) regoPrepare(regoInterpreter* rego);
+
+  /// @brief Evaluates the query of a prepared query.
+  /// @details
+  /// The query evaluated is the one set with ::regoSetQuery when the query
+  /// was prepared. Any errors, including those caused by an invalid input,
+  /// are reported in the output.
+  /// @note The caller is responsible for freeing the output object with
+  /// ::regoFreeOutput. The input is not consumed.
+  /// @param query The prepared query.
+  /// @param input The input, or NULL for an undefined input.
+  /// @return The output of the query, or NULL if query is NULL.
+  REGO_API(regoOutput*)
+  regoPreparedQueryEval(regoPreparedQuery* query, regoInput* input);
+
+  /// @brief Evaluates an entrypoint of a prepared query.
+  /// @details
+  /// The entrypoint must be one of those added with ::regoAddEntrypoint when
+  /// the query was prepared. Otherwise this behaves as
+  /// ::regoPreparedQueryEval.
+  /// @note The caller is responsible for freeing the output object with
+  /// ::regoFreeOutput. The input is not consumed.
+  /// @param query The prepared query.
+  /// @param entrypoint The entrypoint to evaluate.
+  /// @param input The input, or NULL for an undefined input.
+  /// @return The output of the entrypoint, or NULL if query or entrypoint is
+  /// NULL.
+  REGO_API(regoOutput*)
+  regoPreparedQueryEvalEntrypoint(
+    regoPreparedQuery* query, const char* entrypoint, regoInput* input);
+
+  /// @brief Frees a prepared query.
+  /// @note This pointer must have been allocated with ::regoPrepare.
+  /// @param query The prepared query to free.
+  REGO_API(void) regoFreePreparedQuery(regoPreparedQuery* query);
+
   ////////////////////////////////////////
   // -------- Output functions -------- //
   ////////////////////////////////////////
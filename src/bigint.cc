@@ -1,578 +1,658 @@
 #include "internal.hh"
 
+#include <charconv>
 #include <stdexcept>
 
-namespace rego
+namespace
 {
-  Location BigInt::Zero = Location("0");
-  Location BigInt::One = Location("1");
+  using Limbs = std::vector<std::uint64_t>;
 
-  BigInt::BigInt() : m_loc(BigInt::Zero) {}
+  // Decimal text is converted to and from limbs nine digits at a time, as
+  // 10^9 is the largest power of ten which fits in 32 bits.
+  const std::uint32_t DecimalBase = 1000000000;
+  const std::size_t DecimalDigits = 9;
 
-  BigInt::BigInt(const Location& loc) : m_loc(loc)
-  {
-    assert(is_int(loc));
-  }
+  const std::uint64_t Low32 = 0xFFFFFFFF;
 
-  BigInt::BigInt(const std::int64_t value) : BigInt(std::to_string(value)) {}
-
-  const Location& BigInt::loc() const
+  // Multiplies two limbs, returning the low half of the product and writing
+  // the high half to high.
+  std::uint64_t multiply_limb(
+    std::uint64_t lhs, std::uint64_t rhs, std::uint64_t& high)
   {
-    return m_loc;
+    std::uint64_t lhs_lo = lhs & Low32;
+    std::uint64_t lhs_hi = lhs >> 32;
+    std::uint64_t rhs_lo = rhs & Low32;
+    std::uint64_t rhs_hi = rhs >> 32;
+
+    std::uint64_t lo_lo = lhs_lo * rhs_lo;
+    std::uint64_t lo_hi = lhs_lo * rhs_hi;
+    std::uint64_t hi_lo = lhs_hi * rhs_lo;
+    std::uint64_t hi_hi = lhs_hi * rhs_hi;
+
+    std::uint64_t middle = (lo_lo >> 32) + (lo_hi & Low32) + (hi_lo & Low32);
+    high = hi_hi + (lo_hi >> 32) + (hi_lo >> 32) + (middle >> 32);
+    return (middle << 32) | (lo_lo & Low32);
   }
 
-  bool BigInt::is_negative() const
+  void trim(Limbs& limbs)
   {
-    return m_loc.view()[0] == '-';
+    while (!limbs.empty() && limbs.back() == 0)
+    {
+      limbs.pop_back();
+    }
   }
 
-  BigInt BigInt::negate() const
+  int compare_limbs(const Limbs& lhs, const Limbs& rhs)
   {
-    if (is_negative())
+    if (lhs.size() != rhs.size())
     {
-      return BigInt(std::string(m_loc.view().substr(1)));
+      return lhs.size() < rhs.size() ? -1 : 1;
     }
 
-    return BigInt("-" + std::string(m_loc.view()));
-  }
-
-  BigInt BigInt::abs() const
-  {
-    if (is_negative())
+    for (std::size_t i = lhs.size(); i-- > 0;)
     {
-      return negate();
+      if (lhs[i] != rhs[i])
+      {
+        return lhs[i] < rhs[i] ? -1 : 1;
+      }
     }
 
-    return *this;
+    return 0;
   }
 
-  BigInt operator+(const BigInt& lhs, const BigInt& rhs)
+  Limbs add_limbs(const Limbs& lhs, const Limbs& rhs)
   {
-    bool negate = false;
-    if (lhs.is_negative())
+    const Limbs& longer = lhs.size() >= rhs.size() ? lhs : rhs;
+    const Limbs& shorter = lhs.size() >= rhs.size() ? rhs : lhs;
+
+    Limbs result;
+    result.reserve(longer.size() + 1);
+    std::uint64_t carry = 0;
+    for (std::size_t i = 0; i < longer.size(); ++i)
     {
-      if (rhs.is_negative())
-      {
-        negate = true;
-      }
-      else
-      {
-        // adding a negative number
-        return rhs - lhs.negate();
-      }
+      std::uint64_t a = longer[i];
+      std::uint64_t b = i < shorter.size() ? shorter[i] : 0;
+      std::uint64_t sum = a + b;
+      std::uint64_t overflow = sum < a;
+      sum += carry;
+      overflow |= sum < carry;
+      result.push_back(sum);
+      carry = overflow;
     }
-    else
+
+    if (carry > 0)
     {
-      if (rhs.is_negative())
-      {
-        // adding a negative number
-        return lhs - rhs.negate();
-      }
+      result.push_back(carry);
     }
 
-    std::string sum = BigInt::add(lhs.digits(), rhs.digits(), negate);
-    return BigInt(sum);
+    return result;
   }
 
-  std::string BigInt::add(
-    const std::string_view& lhs, const std::string_view& rhs, bool negative)
+  // Subtracts rhs from lhs, which must not be smaller.
+  void subtract_limbs(Limbs& lhs, const Limbs& rhs)
   {
-    if (less_than(lhs, rhs))
+    assert(compare_limbs(lhs, rhs) >= 0);
+    std::uint64_t borrow = 0;
+    for (std::size_t i = 0; i < lhs.size(); ++i)
     {
-      return BigInt::add(rhs, lhs, negative);
+      std::uint64_t a = lhs[i];
+      std::uint64_t b = i < rhs.size() ? rhs[i] : 0;
+      std::uint64_t diff = a - b;
+      std::uint64_t underflow = a < b;
+      underflow |= diff < borrow;
+      lhs[i] = diff - borrow;
+      borrow = underflow;
     }
 
-    if (rhs == "0")
+    assert(borrow == 0);
+    trim(lhs);
+  }
+
+  Limbs multiply_limbs(const Limbs& lhs, const Limbs& rhs)
+  {
+    if (lhs.empty() || rhs.empty())
     {
-      return std::string(lhs);
+      return {};
     }
 
-    std::string result;
-    auto lhs_it = lhs.rbegin();
-    auto rhs_it = rhs.rbegin();
-    int carry = 0;
-    for (; lhs_it != lhs.rend() && rhs_it != rhs.rend(); ++lhs_it, ++rhs_it)
+    Limbs result(lhs.size() + rhs.size(), 0);
+    for (std::size_t i = 0; i < lhs.size(); ++i)
     {
-      auto lhs_digit = *lhs_it - '0';
-      auto rhs_digit = *rhs_it - '0';
-      auto sum = lhs_digit + rhs_digit + carry;
-      if (sum > 9)
-      {
-        carry = 1;
-        sum -= 10;
-      }
-      else
+      std::uint64_t carry = 0;
+      for (std::size_t j = 0; j < rhs.size(); ++j)
       {
-        carry = 0;
+        // lhs * rhs + result + carry cannot exceed 128 bits
+        std::uint64_t high;
+        std::uint64_t low = multiply_limb(lhs[i], rhs[j], high);
+        low += result[i + j];
+        high += low < result[i + j];
+        low += carry;
+        high += low < carry;
+        result[i + j] = low;
+        carry = high;
       }
-      result.push_back(static_cast<char>(sum) + '0');
+
+      result[i + rhs.size()] = carry;
     }
 
-    // lhs will have the same or more digits
-    for (; lhs_it != lhs.rend(); ++lhs_it)
+    trim(result);
+    return result;
+  }
+
+  void multiply_add(Limbs& limbs, std::uint32_t factor, std::uint32_t addend)
+  {
+    std::uint64_t carry = addend;
+    for (std::uint64_t& limb : limbs)
     {
-      auto lhs_digit = *lhs_it - '0';
-      auto sum = lhs_digit + carry;
-      if (sum > 9)
-      {
-        carry = 1;
-        sum -= 10;
-      }
-      else
-      {
-        carry = 0;
-      }
-      result.push_back(static_cast<char>(sum) + '0');
+      std::uint64_t high;
+      std::uint64_t low = multiply_limb(limb, factor, high);
+      low += carry;
+      high += low < carry;
+      limb = low;
+      carry = high;
     }
 
     if (carry > 0)
     {
-      result.push_back('1');
+      limbs.push_back(carry);
     }
+  }
 
-    if (negative)
+  // Divides in place by a divisor of at most 32 bits, a half-limb at a time
+  // so that each step fits in 64 bits. Returns the remainder.
+  std::uint32_t divide_small(Limbs& limbs, std::uint32_t divisor)
+  {
+    std::uint64_t remainder = 0;
+    for (std::size_t i = limbs.size(); i-- > 0;)
     {
-      result.push_back('-');
+      std::uint64_t limb = limbs[i];
+      std::uint64_t high = (remainder << 32) | (limb >> 32);
+      std::uint64_t quotient_high = high / divisor;
+      remainder = high % divisor;
+      std::uint64_t low = (remainder << 32) | (limb & Low32);
+      std::uint64_t quotient_low = low / divisor;
+      remainder = low % divisor;
+      limbs[i] = (quotient_high << 32) | quotient_low;
     }
 
-    std::reverse(result.begin(), result.end());
-
-    return result;
+    trim(limbs);
+    return static_cast<std::uint32_t>(remainder);
   }
 
-  BigInt operator-(const BigInt& lhs, const BigInt& rhs)
+  void shift_left_one(Limbs& limbs, std::uint64_t bit)
   {
-    if (rhs.is_zero())
+    std::uint64_t carry = bit;
+    for (std::uint64_t& limb : limbs)
     {
-      return lhs;
+      std::uint64_t next = limb >> 63;
+      limb = (limb << 1) | carry;
+      carry = next;
     }
 
-    bool negate = false;
-    if (lhs.is_negative())
+    if (carry > 0)
     {
-      if (rhs.is_negative())
-      {
-        // subtracting a negative number
-        if (BigInt::greater_than(lhs.digits(), rhs.digits()))
-        {
-          // we can do the subtraction as if both numbers were positive
-          // and then negate it.
-          negate = true;
-        }
-        else
-        {
-          // reverse the order of the subtraction
-          return rhs.negate() - lhs.negate();
-        }
-      }
-      else
+      limbs.push_back(carry);
+    }
+  }
+
+  // Truncating division of magnitudes. Long division one bit at a time is
+  // quadratic, but the operands seen in policies are a few limbs at most.
+  void divide_limbs(
+    const Limbs& lhs, const Limbs& rhs, Limbs& quotient, Limbs& remainder)
+  {
+    assert(!rhs.empty());
+    if (rhs.size() == 1 && rhs[0] <= Low32)
+    {
+      quotient = lhs;
+      std::uint32_t rem =
+        divide_small(quotient, static_cast<std::uint32_t>(rhs[0]));
+      remainder.clear();
+      if (rem > 0)
       {
-        // do this as addition
-        return lhs + rhs.negate();
+        remainder.push_back(rem);
       }
+
+      return;
     }
-    else
+
+    quotient.assign(lhs.size(), 0);
+    remainder.clear();
+    for (std::size_t bit = lhs.size() * 64; bit-- > 0;)
     {
-      if (rhs.is_negative())
-      {
-        // subtracting a negative number
-        return lhs + rhs.negate();
-      }
-      else
+      shift_left_one(remainder, (lhs[bit / 64] >> (bit % 64)) & 1);
+      if (compare_limbs(remainder, rhs) >= 0)
       {
-        if (BigInt::less_than(lhs.digits(), rhs.digits()))
-        {
-          // reverse the order of the subtraction
-          return (rhs - lhs).negate();
-        }
+        subtract_limbs(remainder, rhs);
+        quotient[bit / 64] |= std::uint64_t(1) << (bit % 64);
       }
     }
 
-    std::string difference =
-      BigInt::subtract(lhs.digits(), rhs.digits(), negate);
-    return BigInt(difference);
+    trim(quotient);
   }
 
-  std::string BigInt::subtract(
-    const std::string_view& lhs, const std::string_view& rhs, bool negative)
+  Limbs parse_limbs(std::string_view digits)
   {
-    assert(!less_than(lhs, rhs));
-    std::string result;
-    auto lhs_it = lhs.rbegin();
-    auto rhs_it = rhs.rbegin();
-    bool borrow = false;
-    for (; lhs_it != lhs.rend() && rhs_it != rhs.rend(); ++lhs_it, ++rhs_it)
+    Limbs limbs;
+    std::size_t chunk = digits.size() % DecimalDigits;
+    if (chunk == 0)
     {
-      auto lhs_digit = *lhs_it - '0';
-      auto rhs_digit = *rhs_it - '0';
-      if (borrow)
-      {
-        lhs_digit -= 1;
-        borrow = false;
-      }
+      chunk = DecimalDigits;
+    }
 
-      if (lhs_digit < rhs_digit)
+    while (!digits.empty())
+    {
+      std::uint32_t value = 0;
+      std::uint32_t factor = 1;
+      for (std::size_t i = 0; i < chunk; ++i)
       {
-        lhs_digit += 10;
-        borrow = true;
+        value = value * 10 + static_cast<std::uint32_t>(digits[i] - '0');
+        factor *= 10;
       }
 
-      auto diff = lhs_digit - rhs_digit;
-      result.push_back(static_cast<char>(diff) + '0');
+      multiply_add(limbs, factor, value);
+      digits.remove_prefix(chunk);
+      chunk = DecimalDigits;
     }
 
-    // lhs will have the same or more digits
-    for (; lhs_it != lhs.rend(); ++lhs_it)
-    {
-      auto lhs_digit = *lhs_it - '0';
-      if (borrow)
-      {
-        lhs_digit -= 1;
-        borrow = false;
-      }
+    trim(limbs);
+    return limbs;
+  }
+}
 
-      if (lhs_digit < 0)
-      {
-        lhs_digit += 10;
-        borrow = true;
-      }
+namespace rego
+{
+  BigInt::BigInt() : m_small(true), m_value(0), m_negative(false) {}
+
+  BigInt::BigInt(const Location& loc) :
+    m_small(true), m_value(0), m_negative(false), m_loc(loc)
+  {
+    assert(is_int(loc));
+    std::string_view view = loc.view();
+    const char* end = view.data() + view.size();
+    auto [ptr, ec] = std::from_chars(view.data(), end, m_value);
+    if (ec == std::errc() && ptr == end)
+    {
+      return;
+    }
 
-      result.push_back(static_cast<char>(lhs_digit) + '0');
+    bool negative = view[0] == '-';
+    if (negative)
+    {
+      view.remove_prefix(1);
     }
 
-    assert(!borrow);
+    BigInt value = from_limbs(negative, parse_limbs(view));
+    m_small = value.m_small;
+    m_value = value.m_value;
+    m_negative = value.m_negative;
+    m_limbs = std::move(value.m_limbs);
+  }
 
-    while (result.size() > 1 && result.back() == '0')
+  BigInt::BigInt(const std::int64_t value) :
+    m_small(true), m_value(value), m_negative(false)
+  {}
+
+  BigInt BigInt::from_magnitude(bool negative, std::uint64_t magnitude)
+  {
+    const std::uint64_t max = std::numeric_limits<std::int64_t>::max();
+    if (!negative && magnitude <= max)
     {
-      result.pop_back();
+      return BigInt(static_cast<std::int64_t>(magnitude));
     }
 
-    if (negative && result != "0")
+    if (negative && magnitude <= max + 1)
     {
-      result.push_back('-');
+      // negated in unsigned arithmetic, as the magnitude of INT64_MIN does
+      // not fit in an int64_t
+      return BigInt(static_cast<std::int64_t>(0 - magnitude));
     }
 
-    std::reverse(result.begin(), result.end());
-
+    BigInt result;
+    result.m_small = false;
+    result.m_negative = negative;
+    result.m_limbs.push_back(magnitude);
     return result;
   }
 
-  BigInt operator*(const BigInt& lhs, const BigInt& rhs)
+  BigInt BigInt::from_limbs(bool negative, std::vector<std::uint64_t> limbs)
   {
-    std::string product = BigInt::multiply(lhs.digits(), rhs.digits());
-
-    if (product == "0")
+    trim(limbs);
+    if (limbs.empty())
     {
       return BigInt();
     }
 
-    bool negate = false;
-    if (lhs.is_negative())
+    if (limbs.size() == 1)
     {
-      negate = true;
+      return from_magnitude(negative, limbs[0]);
     }
-    if (rhs.is_negative())
+
+    BigInt result;
+    result.m_small = false;
+    result.m_negative = negative;
+    result.m_limbs = std::move(limbs);
+    return result;
+  }
+
+  std::vector<std::uint64_t> BigInt::magnitude() const
+  {
+    if (!m_small)
     {
-      negate = !negate;
+      return m_limbs;
     }
 
-    if (negate)
+    if (m_value == 0)
     {
-      product.insert(product.begin(), '-');
+      return {};
     }
 
-    return BigInt(product);
+    std::uint64_t value = static_cast<std::uint64_t>(m_value);
+    return {m_value < 0 ? 0 - value : value};
   }
 
-  std::string BigInt::multiply(
-    const std::string_view& lhs, const std::string_view& rhs)
+  std::string BigInt::to_string() const
   {
-    if (lhs == "0" || rhs == "0")
+    if (m_small)
     {
-      return "0";
+      return std::to_string(m_value);
     }
 
-    if (greater_than(lhs, rhs))
+    std::vector<std::uint32_t> chunks;
+    Limbs limbs = m_limbs;
+    while (!limbs.empty())
     {
-      return BigInt::multiply(rhs, lhs);
+      chunks.push_back(divide_small(limbs, DecimalBase));
     }
 
-    std::string result = "0";
-    std::string start = "";
-    for (auto lhs_it = lhs.rbegin(); lhs_it != lhs.rend(); lhs_it++)
+    std::string result = m_negative ? "-" : "";
+    result += std::to_string(chunks.back());
+    for (std::size_t i = chunks.size() - 1; i-- > 0;)
     {
-      auto lhs_digit = *lhs_it - '0';
-      std::string intermediate = start;
-      int carry = 0;
-      for (auto rhs_it = rhs.rbegin(); rhs_it != rhs.rend(); rhs_it++)
-      {
-        auto rhs_digit = *rhs_it - '0';
-        auto product = lhs_digit * rhs_digit + carry;
-        if (product > 9)
-        {
-          carry = product / 10;
-          product = product % 10;
-        }
-        else
-        {
-          carry = 0;
-        }
-        intermediate.push_back(static_cast<char>(product) + '0');
-      }
-
-      if (carry > 0)
-      {
-        intermediate.push_back(static_cast<char>(carry) + '0');
-      }
-
-      std::reverse(intermediate.begin(), intermediate.end());
-      start += "0";
-      result = BigInt::add(result, intermediate, false);
+      std::string chunk = std::to_string(chunks[i]);
+      result.append(DecimalDigits - chunk.size(), '0');
+      result += chunk;
     }
 
     return result;
   }
 
-  BigInt operator/(const BigInt& lhs, const BigInt& rhs)
+  const Location& BigInt::loc() const
   {
-    if (BigInt::less_than(lhs.digits(), rhs.digits()))
+    if (!m_loc.has_value())
     {
-      return BigInt();
+      m_loc = Location(to_string());
     }
 
-    if (rhs.is_zero())
-    {
-      throw std::invalid_argument("division by zero");
-    }
+    return *m_loc;
+  }
 
-    bool negate = false;
-    if (lhs.is_negative())
-    {
-      negate = true;
-    }
-    if (rhs.is_negative())
+  bool BigInt::is_negative() const
+  {
+    return m_small ? m_value < 0 : m_negative;
+  }
+
+  BigInt BigInt::negate() const
+  {
+    if (m_small)
     {
-      negate = !negate;
+      std::uint64_t value = static_cast<std::uint64_t>(m_value);
+      return m_value < 0 ? from_magnitude(false, 0 - value) :
+                           from_magnitude(true, value);
     }
 
-    auto quotient = BigInt::divide(lhs.digits(), rhs.digits()).quotient;
-    if (negate)
+    return from_limbs(!m_negative, m_limbs);
+  }
+
+  BigInt BigInt::abs() const
+  {
+    if (is_negative())
     {
-      quotient.insert(quotient.begin(), '-');
+      return negate();
     }
 
-    return BigInt(quotient);
+    return *this;
   }
 
-  BigInt operator%(const BigInt& lhs, const BigInt& rhs)
+  BigInt operator+(const BigInt& lhs, const BigInt& rhs)
   {
-    if (BigInt::less_than(lhs.digits(), rhs.digits()))
+    if (lhs.m_small && rhs.m_small)
     {
-      return lhs;
+      using Limits = std::numeric_limits<std::int64_t>;
+      std::int64_t a = lhs.m_value;
+      std::int64_t b = rhs.m_value;
+      if (
+        !(b > 0 && a > Limits::max() - b) && !(b < 0 && a < Limits::min() - b))
+      {
+        return BigInt(a + b);
+      }
     }
 
-    if (rhs.is_zero())
+    bool lhs_negative = lhs.is_negative();
+    bool rhs_negative = rhs.is_negative();
+    Limbs lhs_limbs = lhs.magnitude();
+    Limbs rhs_limbs = rhs.magnitude();
+    if (lhs_negative == rhs_negative)
     {
-      throw std::invalid_argument("modulo by zero");
+      return BigInt::from_limbs(lhs_negative, add_limbs(lhs_limbs, rhs_limbs));
     }
 
-    auto remainder = BigInt::divide(lhs.digits(), rhs.digits()).remainder;
-    if (lhs.is_negative() && remainder != "0")
+    // adding numbers of opposite signs subtracts the smaller magnitude
+    int order = compare_limbs(lhs_limbs, rhs_limbs);
+    if (order == 0)
     {
-      remainder.insert(remainder.begin(), '-');
+      return BigInt();
+    }
+
+    if (order > 0)
+    {
+      subtract_limbs(lhs_limbs, rhs_limbs);
+      return BigInt::from_limbs(lhs_negative, std::move(lhs_limbs));
     }
 
-    return BigInt(remainder);
+    subtract_limbs(rhs_limbs, lhs_limbs);
+    return BigInt::from_limbs(rhs_negative, std::move(rhs_limbs));
   }
 
-  BigInt::DivideResult BigInt::divide(
-    const std::string_view& lhs, const std::string_view& rhs)
+  BigInt operator-(const BigInt& lhs, const BigInt& rhs)
   {
-    std::string remainder;
-
-    bool leading = true;
-    std::string quotient;
-    for (auto it = lhs.begin(); it != lhs.end(); ++it)
+    if (lhs.m_small && rhs.m_small)
     {
-      int digit = 0;
-      remainder.push_back(*it);
-      while (!less_than(remainder, rhs))
+      using Limits = std::numeric_limits<std::int64_t>;
+      std::int64_t a = lhs.m_value;
+      std::int64_t b = rhs.m_value;
+      if (
+        !(b < 0 && a > Limits::max() + b) && !(b > 0 && a < Limits::min() + b))
       {
-        remainder = BigInt::subtract(remainder, rhs, false);
-        digit++;
+        return BigInt(a - b);
       }
+    }
 
-      if (digit == 0 && leading)
+    return lhs + rhs.negate();
+  }
+
+  BigInt operator*(const BigInt& lhs, const BigInt& rhs)
+  {
+    bool negative = lhs.is_negative() != rhs.is_negative();
+    if (lhs.m_small && rhs.m_small)
+    {
+      std::uint64_t a = static_cast<std::uint64_t>(lhs.m_value);
+      std::uint64_t b = static_cast<std::uint64_t>(rhs.m_value);
+      a = lhs.m_value < 0 ? 0 - a : a;
+      b = rhs.m_value < 0 ? 0 - b : b;
+      std::uint64_t high;
+      std::uint64_t low = multiply_limb(a, b, high);
+      if (high == 0)
       {
-        continue;
+        return BigInt::from_magnitude(negative, low);
       }
-
-      leading = false;
-      quotient.push_back(static_cast<char>(digit) + '0');
     }
 
-    return DivideResult{quotient, remainder};
+    return BigInt::from_limbs(
+      negative, multiply_limbs(lhs.magnitude(), rhs.magnitude()));
   }
 
-  bool BigInt::less_than(
-    const std::string_view& lhs, const std::string_view& rhs)
+  BigInt operator/(const BigInt& lhs, const BigInt& rhs)
   {
-    if (lhs.size() < rhs.size())
+    if (rhs.is_zero())
     {
-      return true;
+      throw std::invalid_argument("division by zero");
     }
 
-    if (lhs.size() > rhs.size())
+    if (
+      lhs.m_small && rhs.m_small &&
+      !(lhs.m_value == std::numeric_limits<std::int64_t>::min() &&
+        rhs.m_value == -1))
     {
-      return false;
+      return BigInt(lhs.m_value / rhs.m_value);
     }
 
-    return lhs < rhs;
+    Limbs quotient;
+    Limbs remainder;
+    divide_limbs(lhs.magnitude(), rhs.magnitude(), quotient, remainder);
+    return BigInt::from_limbs(
+      lhs.is_negative() != rhs.is_negative(), std::move(quotient));
   }
 
-  bool BigInt::greater_than(
-    const std::string_view& lhs, const std::string_view& rhs)
+  BigInt operator%(const BigInt& lhs, const BigInt& rhs)
   {
-    if (lhs.size() > rhs.size())
+    if (rhs.is_zero())
     {
-      return true;
+      throw std::invalid_argument("modulo by zero");
     }
 
-    if (lhs.size() < rhs.size())
+    if (lhs.m_small && rhs.m_small)
     {
-      return false;
+      // INT64_MIN % -1 overflows, although the result is 0
+      return BigInt(rhs.m_value == -1 ? 0 : lhs.m_value % rhs.m_value);
     }
 
-    return lhs > rhs;
+    Limbs quotient;
+    Limbs remainder;
+    divide_limbs(lhs.magnitude(), rhs.magnitude(), quotient, remainder);
+    return BigInt::from_limbs(lhs.is_negative(), std::move(remainder));
   }
 
-  bool operator<(const BigInt& lhs, const BigInt& rhs)
+  int BigInt::compare(const BigInt& lhs, const BigInt& rhs)
   {
-    if (lhs.is_negative())
+    if (lhs.m_small && rhs.m_small)
     {
-      if (rhs.is_negative())
-      {
-        return BigInt::greater_than(lhs.digits(), rhs.digits());
-      }
-      else
-      {
-        return true;
-      }
+      return (lhs.m_value > rhs.m_value) - (lhs.m_value < rhs.m_value);
     }
-    else
+
+    bool lhs_negative = lhs.is_negative();
+    if (lhs_negative != rhs.is_negative())
     {
-      if (rhs.is_negative())
-      {
-        return false;
-      }
-      else
-      {
-        return BigInt::less_than(lhs.digits(), rhs.digits());
-      }
+      return lhs_negative ? -1 : 1;
     }
-  }
 
-  bool operator>(const BigInt& lhs, const BigInt& rhs)
-  {
-    if (lhs.is_negative())
+    // a value held in limbs has a larger magnitude than any small value
+    int order;
+    if (lhs.m_small)
     {
-      if (rhs.is_negative())
-      {
-        return BigInt::less_than(lhs.digits(), rhs.digits());
-      }
-      else
-      {
-        return false;
-      }
+      order = -1;
+    }
+    else if (rhs.m_small)
+    {
+      order = 1;
     }
     else
     {
-      if (rhs.is_negative())
-      {
-        return true;
-      }
-      else
-      {
-        return BigInt::greater_than(lhs.digits(), rhs.digits());
-      }
+      order = compare_limbs(lhs.m_limbs, rhs.m_limbs);
     }
+
+    return lhs_negative ? -order : order;
   }
 
-  bool operator<=(const BigInt& lhs, const BigInt& rhs)
+  bool operator<(const BigInt& lhs, const BigInt& rhs)
   {
-    return !(lhs > rhs);
+    return BigInt::compare(lhs, rhs) < 0;
   }
 
-  bool operator>=(const BigInt& lhs, const BigInt& rhs)
+  bool operator>(const BigInt& lhs, const BigInt& rhs)
   {
-    return !(lhs < rhs);
+    return BigInt::compare(lhs, rhs) > 0;
   }
 
-  bool operator==(const BigInt& lhs, const BigInt& rhs)
+  bool operator<=(const BigInt& lhs, const BigInt& rhs)
   {
-    return lhs.m_loc == rhs.m_loc;
+    return BigInt::compare(lhs, rhs) <= 0;
   }
 
-  bool operator!=(const BigInt& lhs, const BigInt& rhs)
+  bool operator>=(const BigInt& lhs, const BigInt& rhs)
   {
-    return lhs.m_loc != rhs.m_loc;
+    return BigInt::compare(lhs, rhs) >= 0;
   }
 
-  std::string_view BigInt::digits() const
+  bool operator==(const BigInt& lhs, const BigInt& rhs)
   {
-    if (is_negative())
-    {
-      return m_loc.view().substr(1);
-    }
+    return BigInt::compare(lhs, rhs) == 0;
+  }
 
-    return m_loc.view();
+  bool operator!=(const BigInt& lhs, const BigInt& rhs)
+  {
+    return BigInt::compare(lhs, rhs) != 0;
   }
 
   bool BigInt::is_zero() const
   {
-    return m_loc.view() == "0";
+    return m_small && m_value == 0;
   }
 
   std::optional<std::int64_t> BigInt::to_int() const
   {
-    try
+    if (!m_small)
     {
-      return std::stoll(std::string(m_loc.view()));
-    }
-    catch (const std::out_of_range&)
-    {
-      logging::Error() << m_loc.view() << " is out of range for a int64_t";
+      logging::Error() << loc().view() << " is out of range for a int64_t";
       return std::nullopt;
     }
+
+    return m_value;
   }
 
   std::optional<std::size_t> BigInt::to_size() const
   {
-    try
+    // As std::stoul, negative values within range wrap around.
+    std::uint64_t value;
+    if (m_small)
     {
-      return std::stoul(std::string(m_loc.view()));
+      value = static_cast<std::uint64_t>(m_value);
     }
-    catch (const std::out_of_range&)
+    else if (m_limbs.size() == 1)
     {
-      logging::Error() << m_loc.view() << " is out of range for a size_t";
+      value = m_negative ? 0 - m_limbs[0] : m_limbs[0];
+    }
+    else
+    {
+      logging::Error() << loc().view() << " is out of range for a size_t";
       return std::nullopt;
     }
+
+    if constexpr (sizeof(std::size_t) < sizeof(std::uint64_t))
+    {
+      if (value > std::numeric_limits<std::size_t>::max())
+      {
+        logging::Error() << loc().view() << " is out of range for a size_t";
+        return std::nullopt;
+      }
+    }
+
+    return static_cast<std::size_t>(value);
   }
 
   std::ostream& operator<<(std::ostream& os, const BigInt& bigint)
   {
-    os << bigint.m_loc.view();
+    os << bigint.loc().view();
     return os;
   }
 
   BigInt BigInt::increment() const
   {
-    return *this + One;
+    return *this + BigInt(std::int64_t(1));
   }
 
   BigInt BigInt::decrement() const
   {
-    return *this - One;
+    return *this - BigInt(std::int64_t(1));
   }
 
   bool BigInt::is_int(const Location& loc)
@@ -582,7 +662,6 @@ namespace rego
       return false;
     }
 
-    std::set<char> digits = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9'};
     auto it = loc.view().begin();
     auto end = loc.view().end();
     if (*it == '-')
@@ -590,9 +669,14 @@ namespace rego
       ++it;
     }
 
+    if (it == end)
+    {
+      return false;
+    }
+
     for (; it != end; ++it)
     {
-      if (!digits.contains(*it))
+      if (*it < '0' || *it > '9')
       {
         return false;
       }
@@ -600,4 +684,4 @@ namespace rego
 
     return true;
   }
-}
\ No newline at end of file
+}
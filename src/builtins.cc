@@ -26,6 +26,8 @@ namespace
       return err(decl, message, EvalBuiltInError);
     }
   };
+
+  thread_local BuiltInContext* current_context = nullptr;
 }
 
 namespace rego
@@ -52,10 +54,48 @@ namespace rego
     decl = decl_;
     behavior = behavior_;
     available = available_;
+    deterministic = false;
   }
 
   void BuiltInDef::clear() {}
 
+  BuiltInContext* BuiltInContext::current()
+  {
+    return current_context;
+  }
+
+  Node BuiltInContext::get(const std::string& key) const
+  {
+    auto it = m_values.find(key);
+    if (it == m_values.end())
+    {
+      return nullptr;
+    }
+
+    return it->second;
+  }
+
+  void BuiltInContext::put(const std::string& key, Node value)
+  {
+    m_values[key] = value;
+  }
+
+  void BuiltInContext::clear()
+  {
+    m_values.clear();
+  }
+
+  BuiltInContext::Scope::Scope(BuiltInContext& context) :
+    m_previous(current_context)
+  {
+    current_context = &context;
+  }
+
+  BuiltInContext::Scope::~Scope()
+  {
+    current_context = m_previous;
+  }
+
   BuiltIn BuiltInDef::create(
     const Location& name, Node decl, BuiltInBehavior behavior)
   {
@@ -77,6 +117,14 @@ namespace rego
     return std::make_shared<BuiltInDef>(name, decl, behavior, true);
   }
 
+  BuiltIn builtins::pure(
+    const Location& name, Node decl, BuiltInBehavior behavior)
+  {
+    BuiltIn builtin = BuiltInDef::create(name, decl, behavior);
+    builtin->deterministic = true;
+    return builtin;
+  }
+
   BuiltIn BuiltInDef::placeholder(
     const Location& name, Node decl, const std::string& message)
   {
@@ -148,6 +196,13 @@ namespace rego
       deprecated.end();
   }
 
+  bool BuiltInsDef::is_deterministic(const Location& name) const
+  {
+    auto it = m_builtins.find(name);
+    BuiltIn builtin = it != m_builtins.end() ? it->second : lookup(name);
+    return builtin != nullptr && builtin->deterministic;
+  }
+
   Node BuiltInsDef::call(
     const Location& name, const Location& version, const Nodes& args)
   {
@@ -170,6 +225,11 @@ namespace rego
       return err(args[0], "wrong number of arguments");
     }
 
+    return call(builtin, args);
+  }
+
+  Node BuiltInsDef::call(const BuiltIn& builtin, const Nodes& args) const
+  {
     for (auto& arg : args)
     {
       if (arg->type() == Error)
@@ -197,6 +257,7 @@ namespace rego
   BuiltInsDef& BuiltInsDef::register_builtin(const BuiltIn& built_in)
   {
     m_builtins[built_in->name] = built_in;
+    m_generation++;
     return *this;
   }
 
@@ -256,9 +317,15 @@ namespace rego
   {
     m_lookup_behavior = BuiltInsDef::LookupBehavior::AllowAll;
     m_builtins.clear();
+    m_generation++;
     return *this;
   }
 
+  std::size_t BuiltInsDef::generation() const
+  {
+    return m_generation;
+  }
+
   BuiltIn BuiltInsDef::lookup(const Location& name)
   {
     std::string_view view = name.view();
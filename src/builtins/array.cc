@@ -43,7 +43,7 @@ namespace
                      << (bi::Description ^ "the concatenation of `x` and `y`")
                      << (bi::Type
                          << (bi::DynamicArray << (bi::Type << bi::Any))));
-    return BuiltInDef::create({"array.concat"}, concat_decl, concat);
+    return bi::pure({"array.concat"}, concat_decl, concat);
   }
 
   Node reverse(const Nodes& args)
@@ -82,7 +82,7 @@ namespace
           << (bi::Description ^
               "an array containing the elements of `arr` in reverse order")
           << (bi::Type << (bi::DynamicArray << (bi::Type << bi::Any))));
-    return BuiltInDef::create({"array.reverse"}, reverse_decl, reverse);
+    return bi::pure({"array.reverse"}, reverse_decl, reverse);
   }
 
   Node slice(const Nodes& args)
@@ -174,7 +174,7 @@ namespace
                          "including `arr[start]`, but excluding `arr[end]`")
                      << (bi::Type
                          << (bi::DynamicArray << (bi::Type << bi::Any))));
-    return BuiltInDef::create({"array.slice"}, slice_decl, slice);
+    return bi::pure({"array.slice"}, slice_decl, slice);
   }
 
   Node flatten(const Nodes& args)
@@ -219,7 +219,7 @@ namespace
                        "the flattened array, with all nested arrays inlined")
                    << (bi::Type
                        << (bi::DynamicArray << (bi::Type << bi::Any))));
-    return BuiltInDef::create({"array.flatten"}, flatten_decl, flatten);
+    return bi::pure({"array.flatten"}, flatten_decl, flatten);
   }
 }
 
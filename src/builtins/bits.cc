@@ -52,7 +52,7 @@ namespace
       << (bi::Result << (bi::Name ^ "z")
                      << (bi::Description ^ "the bitwise AND of `x` and `y`")
                      << (bi::Type << bi::Number));
-    return BuiltInDef::create({"bits.and"}, and_decl, and_);
+    return bi::pure({"bits.and"}, and_decl, and_);
   }
 
   Node lsh(const Nodes& args)
@@ -109,7 +109,7 @@ namespace
                      << (bi::Description ^
                          "the result of shifting `x` `s` bits to the left")
                      << (bi::Type << bi::Number));
-    return BuiltInDef::create({"bits.lsh"}, lsh_decl, lsh);
+    return bi::pure({"bits.lsh"}, lsh_decl, lsh);
   }
 
   Node negate(const Nodes& args)
@@ -143,7 +143,7 @@ namespace
                    << (bi::Name ^ "z")
                    << (bi::Description ^ "the bitwise negation of `x`")
                    << (bi::Type << bi::Number));
-    return BuiltInDef::create({"bits.negate"}, negate_decl, negate);
+    return bi::pure({"bits.negate"}, negate_decl, negate);
   }
 
   Node or_(const Nodes& args)
@@ -193,7 +193,7 @@ namespace
       << (bi::Result << (bi::Name ^ "z")
                      << (bi::Description ^ "the bitwise OR of `x` and `y`")
                      << (bi::Type << bi::Number));
-    return BuiltInDef::create({"bits.or"}, or_decl, or_);
+    return bi::pure({"bits.or"}, or_decl, or_);
   }
 
   Node rsh(const Nodes& args)
@@ -254,7 +254,7 @@ namespace
                      << (bi::Description ^
                          "the result of shifting `x` `s` bits to the right")
                      << (bi::Type << bi::Number));
-    return BuiltInDef::create({"bits.rsh"}, rsh_decl, rsh);
+    return bi::pure({"bits.rsh"}, rsh_decl, rsh);
   }
 
   Node xor_(const Nodes& args)
@@ -304,7 +304,7 @@ namespace
       << (bi::Result << (bi::Name ^ "z")
                      << (bi::Description ^ "the bitwise XOR of `x` and `y`")
                      << (bi::Type << bi::Number));
-    return BuiltInDef::create({"bits.xor"}, xor_decl, xor_);
+    return bi::pure({"bits.xor"}, xor_decl, xor_);
   }
 }
 
@@ -37,5 +37,10 @@ namespace rego
     BuiltIn urlquery(const Location& name);
     BuiltIn uuid(const Location& name);
     BuiltIn yaml(const Location& name);
+
+    /// Creates a standard library built-in which always returns the same
+    /// result for the same arguments and has no side effects (see
+    /// BuiltInDef::deterministic).
+    BuiltIn pure(const Location& name, Node decl, BuiltInBehavior behavior);
   }
 }
\ No newline at end of file
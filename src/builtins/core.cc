@@ -47,7 +47,7 @@ namespace
                          "the count of elements, key/val pairs, or characters, "
                          "respectively.")
                      << (bi::Type << bi::Number));
-    return BuiltInDef::create({"count"}, count_decl, count);
+    return bi::pure({"count"}, count_decl, count);
   }
 
   Node max(const Nodes& args)
@@ -66,7 +66,7 @@ namespace
 
     auto it = std::max_element(
       collection->begin(), collection->end(), [](const Node& a, const Node& b) {
-        return to_key(a) < to_key(b);
+        return term_compare(a, b) < 0;
       });
 
     return *it;
@@ -91,7 +91,7 @@ namespace
                    << (bi::Description ^ "the maximum of all elements")
                    << (bi::Type << bi::Any));
 
-    return BuiltInDef::create({"max"}, max_decl, max);
+    return bi::pure({"max"}, max_decl, max);
   }
 
   Node min(const Nodes& args)
@@ -110,7 +110,7 @@ namespace
 
     auto it = std::min_element(
       collection->begin(), collection->end(), [](const Node& a, const Node& b) {
-        return to_key(a) < to_key(b);
+        return term_compare(a, b) < 0;
       });
 
     return *it;
@@ -135,7 +135,7 @@ namespace
                    << (bi::Description ^ "the minimum of all elements")
                    << (bi::Type << bi::Any));
 
-    return BuiltInDef::create({"min"}, min_decl, min);
+    return bi::pure({"min"}, min_decl, min);
   }
 
   Node sort(const Nodes& args)
@@ -154,7 +154,7 @@ namespace
     }
 
     std::sort(items.begin(), items.end(), [](const Node& a, const Node& b) {
-      return to_key(a) < to_key(b);
+      return term_compare(a, b) < 0;
     });
 
     return collection->type() << NodeRange{items.begin(), items.end()};
@@ -179,7 +179,7 @@ namespace
                    << (bi::Type
                        << (bi::DynamicArray << (bi::Type << bi::Any))));
 
-    return BuiltInDef::create({"sort"}, sort_decl, sort);
+    return bi::pure({"sort"}, sort_decl, sort);
   }
 
   Node sum(const Nodes& args)
@@ -216,7 +216,7 @@ namespace
                      << (bi::Description ^ "the sum of all elements")
                      << (bi::Type << bi::Number));
 
-    return BuiltInDef::create({"sum"}, sum_decl, sum);
+    return bi::pure({"sum"}, sum_decl, sum);
   }
 
   Node product(const Nodes& args)
@@ -254,7 +254,7 @@ namespace
       << (bi::Result << (bi::Name ^ "n")
                      << (bi::Description ^ "the product of all elements")
                      << (bi::Type << bi::Number));
-    return BuiltInDef::create({"product"}, product_decl, product);
+    return bi::pure({"product"}, product_decl, product);
   }
 
   Node equal(const Nodes& args)
@@ -275,7 +275,7 @@ namespace
                      << (bi::Description ^
                          "true if `x` equals `y`; false otherwise")
                      << (bi::Type << bi::Boolean));
-    return BuiltInDef::create({"equal"}, equal_decl, equal);
+    return bi::pure({"equal"}, equal_decl, equal);
   }
 
   Node gt(const Nodes& args)
@@ -296,7 +296,7 @@ namespace
                      << (bi::Description ^
                          "true if `x` is greater than `y`; false otherwise")
                      << (bi::Type << bi::Boolean));
-    return BuiltInDef::create({"gt"}, gt_decl, gt);
+    return bi::pure({"gt"}, gt_decl, gt);
   }
 
   Node gte(const Nodes& args)
@@ -318,7 +318,7 @@ namespace
           << (bi::Description ^
               "true if `x` is greater than or equal to `y`; false otherwise")
           << (bi::Type << bi::Boolean));
-    return BuiltInDef::create({"gte"}, gte_decl, gte);
+    return bi::pure({"gte"}, gte_decl, gte);
   }
 
   Node lt(const Nodes& args)
@@ -339,7 +339,7 @@ namespace
                      << (bi::Description ^
                          "true if `x` is less than `y`; false otherwise")
                      << (bi::Type << bi::Boolean));
-    return BuiltInDef::create({"lt"}, lt_decl, lt);
+    return bi::pure({"lt"}, lt_decl, lt);
   }
 
   Node lte(const Nodes& args)
@@ -361,7 +361,7 @@ namespace
           << (bi::Description ^
               "true if `x` is less than or equal to `y`; false otherwise")
           << (bi::Type << bi::Boolean));
-    return BuiltInDef::create({"lte"}, lte_decl, lte);
+    return bi::pure({"lte"}, lte_decl, lte);
   }
 
   Node neq(const Nodes& args)
@@ -382,7 +382,7 @@ namespace
                      << (bi::Description ^
                          "true if `x` is not equal to `y`; false otherwise")
                      << (bi::Type << bi::Boolean));
-    return BuiltInDef::create({"neq"}, neq_decl, neq);
+    return bi::pure({"neq"}, neq_decl, neq);
   }
 
   Node to_number(const Nodes& args)
@@ -458,7 +458,7 @@ namespace
                    << (bi::Name ^ "num")
                    << (bi::Description ^ "the numeric representation of `x`")
                    << (bi::Type << bi::Number));
-    return BuiltInDef::create({"to_number"}, to_number_decl, to_number);
+    return bi::pure({"to_number"}, to_number_decl, to_number);
   }
 
   Node walk(const Nodes& args)
@@ -544,7 +544,7 @@ namespace
                           << (bi::Type
                               << (bi::DynamicArray << (bi::Type << bi::Any)))
                           << (bi::Type << bi::Any))))));
-    return BuiltInDef::create({"walk"}, walk_decl, walk);
+    return bi::pure({"walk"}, walk_decl, walk);
   }
 
   Node print(const Nodes& args)
@@ -613,7 +613,7 @@ namespace
                               << (bi::Description ^ "the absolute value of `x`")
                               << (bi::Type << bi::Number));
 
-    return BuiltInDef::create({"abs"}, abs_decl, abs_);
+    return bi::pure({"abs"}, abs_decl, abs_);
   }
 
   Node ceil_(const Nodes& args)
@@ -648,7 +648,7 @@ namespace
                    << (bi::Description ^ "the result of rounding `x` _up_")
                    << (bi::Type << bi::Number));
 
-    return BuiltInDef::create({"ceil"}, ceil_decl, ceil_);
+    return bi::pure({"ceil"}, ceil_decl, ceil_);
   }
 
   Node floor_(const Nodes& args)
@@ -683,7 +683,7 @@ namespace
                    << (bi::Description ^ "the result of rounding `x` _down_")
                    << (bi::Type << bi::Number));
 
-    return BuiltInDef::create({"floor"}, floor_decl, floor_);
+    return bi::pure({"floor"}, floor_decl, floor_);
   }
 
   Node round_(const Nodes& args)
@@ -718,7 +718,7 @@ namespace
                    << (bi::Description ^ "the result of rounding `x`")
                    << (bi::Type << bi::Number));
 
-    return BuiltInDef::create({"round"}, round_decl, round_);
+    return bi::pure({"round"}, round_decl, round_);
   }
 
   Node plus_(const Nodes& args)
@@ -740,7 +740,7 @@ namespace
       << (bi::Result << (bi::Name ^ "z")
                      << (bi::Description ^ "the sum of `x` and `y`")
                      << (bi::Type << bi::Number));
-    return BuiltInDef::create({"plus"}, plus_decl, plus_);
+    return bi::pure({"plus"}, plus_decl, plus_);
   }
 
   Node minus_(const Nodes& args)
@@ -777,7 +777,7 @@ namespace
                              << (bi::Type
                                  << (bi::Set << (bi::Type << bi::Any))))));
 
-    return BuiltInDef::create({"minus"}, minus_decl, minus_);
+    return bi::pure({"minus"}, minus_decl, minus_);
   }
 
   Node mul_(const Nodes& args)
@@ -799,7 +799,7 @@ namespace
       << (bi::Result << (bi::Name ^ "z")
                      << (bi::Description ^ "the product of `x` and `y`")
                      << (bi::Type << bi::Number));
-    return BuiltInDef::create({"mul"}, mul_decl, mul_);
+    return bi::pure({"mul"}, mul_decl, mul_);
   }
 
   Node div_(const Nodes& args)
@@ -821,7 +821,7 @@ namespace
       << (bi::Result << (bi::Name ^ "z")
                      << (bi::Description ^ "the result of `x` divided by `y`")
                      << (bi::Type << bi::Number));
-    return BuiltInDef::create({"div"}, div_decl, div_);
+    return bi::pure({"div"}, div_decl, div_);
   }
 
   Node rem_(const Nodes& args)
@@ -842,7 +842,7 @@ namespace
                                  << (bi::Type << bi::Number)))
       << (bi::Result << (bi::Name ^ "z") << (bi::Description ^ "the remainder")
                      << (bi::Type << bi::Number));
-    return BuiltInDef::create({"rem"}, rem_decl, rem_);
+    return bi::pure({"rem"}, rem_decl, rem_);
   }
 
   Node and_(const Nodes& args)
@@ -862,7 +862,7 @@ namespace
       << (bi::Result << (bi::Name ^ "z")
                      << (bi::Description ^ "the intersection of `x` and `y`")
                      << (bi::Type << (bi::Set << (bi::Type << bi::Any))));
-    return BuiltInDef::create({"and"}, and_decl, and_);
+    return bi::pure({"and"}, and_decl, and_);
   }
 
   Node or_(const Nodes& args)
@@ -882,7 +882,7 @@ namespace
       << (bi::Result << (bi::Name ^ "z")
                      << (bi::Description ^ "the union of `x` and `y`")
                      << (bi::Type << (bi::Set << (bi::Type << bi::Any))));
-    return BuiltInDef::create({"or"}, or_decl, or_);
+    return bi::pure({"or"}, or_decl, or_);
   }
 
   Node intersection(const Nodes& args)
@@ -934,8 +934,7 @@ namespace
                    << (bi::Name ^ "y")
                    << (bi::Description ^ "the intersection of all `xs` sets")
                    << (bi::Type << (bi::Set << (bi::Type << bi::Any))));
-    return BuiltInDef::create(
-      {"intersection"}, intersection_decl, intersection);
+    return bi::pure({"intersection"}, intersection_decl, intersection);
   }
 
   Node union_(const Nodes& args)
@@ -975,7 +974,7 @@ namespace
                    << (bi::Name ^ "y")
                    << (bi::Description ^ "the union of all `xs` sets")
                    << (bi::Type << (bi::Set << (bi::Type << bi::Any))));
-    return BuiltInDef::create({"union"}, union_decl, union_);
+    return bi::pure({"union"}, union_decl, union_);
   }
 
   Node unwrap_strings(const Node& collection, std::vector<std::string>& items)
@@ -1055,7 +1054,7 @@ namespace
                      << (bi::Description ^ "the joined string")
                      << (bi::Type << bi::Boolean));
 
-    return BuiltInDef::create({"concat"}, concat_decl, concat);
+    return bi::pure({"concat"}, concat_decl, concat);
   }
 
   Node startswith(const Nodes& args)
@@ -1092,7 +1091,7 @@ namespace
                      << (bi::Description ^ "result of the prefix check")
                      << (bi::Type << bi::Boolean));
 
-    return BuiltInDef::create({"startswith"}, startswith_decl, startswith);
+    return bi::pure({"startswith"}, startswith_decl, startswith);
   }
 
   Node endswith(const Nodes& args)
@@ -1129,7 +1128,7 @@ namespace
       << (bi::Result << (bi::Name ^ "result")
                      << (bi::Description ^ "result of the suffix check")
                      << (bi::Type << bi::Boolean));
-    return BuiltInDef::create({"endswith"}, endswith_decl, endswith);
+    return bi::pure({"endswith"}, endswith_decl, endswith);
   }
 
   Node contains(const Nodes& args)
@@ -1165,7 +1164,7 @@ namespace
       << (bi::Result << (bi::Name ^ "result")
                      << (bi::Description ^ "result of the containment check")
                      << (bi::Type << bi::Boolean));
-    return BuiltInDef::create({"contains"}, contains_decl, contains);
+    return bi::pure({"contains"}, contains_decl, contains);
   }
 
   Node format_int(const Nodes& args)
@@ -1241,7 +1240,7 @@ namespace
                      << (bi::Description ^ "formatted number")
                      << (bi::Type << bi::String));
 
-    return BuiltInDef::create({"format_int"}, format_int_decl, format_int);
+    return bi::pure({"format_int"}, format_int_decl, format_int);
   }
 
   Node indexof(const Nodes& args)
@@ -1285,7 +1284,7 @@ namespace
                          "index of first occurrence, `-1` if not found")
                      << (bi::Type << bi::Number));
 
-    return BuiltInDef::create({"indexof"}, indexof_decl, indexof);
+    return bi::pure({"indexof"}, indexof_decl, indexof);
   }
 
   Node indexof_n(const Nodes& args)
@@ -1333,7 +1332,7 @@ namespace
                      << (bi::Type
                          << (bi::DynamicArray << (bi::Type << bi::Number))));
 
-    return BuiltInDef::create({"indexof_n"}, indexof_n_decl, indexof_n);
+    return bi::pure({"indexof_n"}, indexof_n_decl, indexof_n);
   }
 
   Node lower(const Nodes& args)
@@ -1364,7 +1363,7 @@ namespace
                               << (bi::Description ^ "lower-case of x")
                               << (bi::Type << bi::String));
 
-    return BuiltInDef::create({"lower"}, lower_decl, lower);
+    return bi::pure({"lower"}, lower_decl, lower);
   }
 
   Node upper(const Nodes& args)
@@ -1394,7 +1393,7 @@ namespace
                << (bi::Result << (bi::Name ^ "y")
                               << (bi::Description ^ "upper-case of x")
                               << (bi::Type << bi::String));
-    return BuiltInDef::create({"upper"}, upper_decl, upper);
+    return bi::pure({"upper"}, upper_decl, upper);
   }
 
   void do_replace(
@@ -1454,7 +1453,7 @@ namespace
                      << (bi::Description ^ "string with replaced substrings")
                      << (bi::Type << bi::String));
 
-    return BuiltInDef::create({"replace"}, replace_decl, replace);
+    return bi::pure({"replace"}, replace_decl, replace);
   }
 
   Node split(const Nodes& args)
@@ -1515,7 +1514,7 @@ namespace
                      << (bi::Type
                          << (bi::DynamicArray << (bi::Type << bi::String))));
 
-    return BuiltInDef::create({"split"}, split_decl, split);
+    return bi::pure({"split"}, split_decl, split);
   }
 
   enum class PrintVerbType
@@ -1765,7 +1764,7 @@ namespace
                          "`format` formatted by the values in `values`")
                      << (bi::Type << bi::String));
 
-    return BuiltInDef::create({"sprintf"}, sprintf_decl, sprintf_);
+    return bi::pure({"sprintf"}, sprintf_decl, sprintf_);
   }
 
   Node substring(const Nodes& args)
@@ -1855,7 +1854,7 @@ namespace
                    << (bi::Description ^
                        "substring of `value` from `offset`, of length `length`")
                    << (bi::Type << bi::String));
-    return BuiltInDef::create({"substring"}, substring_decl, substring);
+    return bi::pure({"substring"}, substring_decl, substring);
   }
 
   std::string do_trim(
@@ -1925,7 +1924,7 @@ namespace
                          "string trimmed of `cutset` characters")
                      << (bi::Type << bi::String));
 
-    return BuiltInDef::create({"trim"}, trim_decl, trim);
+    return bi::pure({"trim"}, trim_decl, trim);
   }
 
   Node trim_left(const Nodes& args)
@@ -1964,7 +1963,7 @@ namespace
                                   "string left-trimmed of `cutset` characters")
                               << (bi::Type << bi::String));
 
-    return BuiltInDef::create({"trim_left"}, trim_left_decl, trim_left);
+    return bi::pure({"trim_left"}, trim_left_decl, trim_left);
   }
 
   Node trim_right(const Nodes& args)
@@ -2003,7 +2002,7 @@ namespace
                                   "string right-trimmed of `cutset` characters")
                               << (bi::Type << bi::String));
 
-    return BuiltInDef::create({"trim_right"}, trim_right_decl, trim_right);
+    return bi::pure({"trim_right"}, trim_right_decl, trim_right);
   }
 
   Node trim_space(const Nodes& args)
@@ -2031,7 +2030,7 @@ namespace
                        "string leading and trailing white space cut off")
                    << (bi::Type << bi::String));
 
-    return BuiltInDef::create({"trim_space"}, trim_space_decl, trim_space);
+    return bi::pure({"trim_space"}, trim_space_decl, trim_space);
   }
 
   Node trim_prefix(const Nodes& args)
@@ -2071,7 +2070,7 @@ namespace
       << (bi::Result << (bi::Name ^ "output")
                      << (bi::Description ^ "string with `prefix` cut off")
                      << (bi::Type << bi::String));
-    return BuiltInDef::create({"trim_prefix"}, trim_prefix_decl, trim_prefix);
+    return bi::pure({"trim_prefix"}, trim_prefix_decl, trim_prefix);
   }
 
   Node trim_suffix(const Nodes& args)
@@ -2112,7 +2111,7 @@ namespace
       << (bi::Result << (bi::Name ^ "output")
                      << (bi::Description ^ "string with `suffix` cut off")
                      << (bi::Type << bi::String));
-    return BuiltInDef::create({"trim_suffix"}, trim_suffix_decl, trim_suffix);
+    return bi::pure({"trim_suffix"}, trim_suffix_decl, trim_suffix);
   }
 
   Node is_array(const Nodes& args)
@@ -2133,7 +2132,7 @@ namespace
                        "`true` if `x` is an array, `false` otherwise")
                    << (bi::Type << bi::Boolean));
 
-    return BuiltInDef::create({"is_array"}, is_array_decl, is_array);
+    return bi::pure({"is_array"}, is_array_decl, is_array);
   }
 
   Node is_boolean(const Nodes& args)
@@ -2154,7 +2153,7 @@ namespace
                        "`true` if `x` is a boolean, `false` otherwise")
                    << (bi::Type << bi::Boolean));
 
-    return BuiltInDef::create({"is_boolean"}, is_boolean_decl, is_boolean);
+    return bi::pure({"is_boolean"}, is_boolean_decl, is_boolean);
   }
 
   Node is_null(const Nodes& args)
@@ -2174,7 +2173,7 @@ namespace
                                   "`true` if `x` is null, `false` otherwise")
                               << (bi::Type << bi::Boolean));
 
-    return BuiltInDef::create({"is_null"}, is_null_decl, is_null);
+    return bi::pure({"is_null"}, is_null_decl, is_null);
   }
 
   Node is_number(const Nodes& args)
@@ -2195,7 +2194,7 @@ namespace
                        "`true` if `x` is a number, `false` otherwise")
                    << (bi::Type << bi::Boolean));
 
-    return BuiltInDef::create({"is_number"}, is_number_decl, is_number);
+    return bi::pure({"is_number"}, is_number_decl, is_number);
   }
 
   Node is_object(const Nodes& args)
@@ -2216,7 +2215,7 @@ namespace
                        "`true` if `x` is an object, `false` otherwise")
                    << (bi::Type << bi::Boolean));
 
-    return BuiltInDef::create({"is_object"}, is_object_decl, is_object);
+    return bi::pure({"is_object"}, is_object_decl, is_object);
   }
 
   Node is_set(const Nodes& args)
@@ -2236,7 +2235,7 @@ namespace
                                   "`true` if `x` is a set, `false` otherwise")
                               << (bi::Type << bi::Boolean));
 
-    return BuiltInDef::create({"is_set"}, is_set_decl, is_set);
+    return bi::pure({"is_set"}, is_set_decl, is_set);
   }
 
   Node is_string(const Nodes& args)
@@ -2257,7 +2256,7 @@ namespace
                        "`true` if `x` is a string, `false` otherwise")
                    << (bi::Type << bi::Boolean));
 
-    return BuiltInDef::create({"is_string"}, is_string_decl, is_string);
+    return bi::pure({"is_string"}, is_string_decl, is_string);
   }
 
   Node type_name_(const Nodes& args)
@@ -2277,7 +2276,7 @@ namespace
               R"(one of "null", "boolean", "number", "string", "array", "object", "set")")
           << (bi::Type << bi::String));
 
-    return BuiltInDef::create({"type_name"}, type_name_decl, type_name_);
+    return bi::pure({"type_name"}, type_name_decl, type_name_);
   }
 
   namespace strings
@@ -2338,7 +2337,7 @@ namespace
                                 << (bi::Description ^
                                     "count of occurrences, `0` if not found")
                                 << (bi::Type << bi::Number));
-      return BuiltInDef::create({"strings.count"}, count_decl, count);
+      return bi::pure({"strings.count"}, count_decl, count);
     }
 
     Node any_prefix_match(const Nodes& args)
@@ -2438,7 +2437,7 @@ namespace
                        << (bi::Description ^ "result of the prefix check")
                        << (bi::Type << bi::String));
 
-      return BuiltInDef::create(
+      return bi::pure(
         {"strings.any_prefix_match"}, any_prefix_match_decl, any_prefix_match);
     }
 
@@ -2539,7 +2538,7 @@ namespace
                        << (bi::Description ^ "result of the suffix check")
                        << (bi::Type << bi::String));
 
-      return BuiltInDef::create(
+      return bi::pure(
         {"strings.any_suffix_match"}, any_suffix_match_decl, any_suffix_match);
     }
 
@@ -2643,8 +2642,7 @@ namespace
                        << (bi::Description ^ "string with replaced substrings")
                        << (bi::Type << bi::String));
 
-      return BuiltInDef::create(
-        {"strings.replace_n"}, replace_n_decl, replace_n);
+      return bi::pure({"strings.replace_n"}, replace_n_decl, replace_n);
     }
 
     Node reverse(const Nodes& args)
@@ -2674,7 +2672,7 @@ namespace
                                 << (bi::Description ^ "reversed string")
                                 << (bi::Type << bi::Number));
 
-      return BuiltInDef::create({"reverse"}, reverse_decl, reverse);
+      return bi::pure({"reverse"}, reverse_decl, reverse);
     }
   }
 }
@@ -378,8 +378,7 @@ namespace
       return BuiltInDef::placeholder(
         {"crypto.hmac.equal"}, equal_decl, Message);
 #else
-      return BuiltInDef::create(
-        {"crypto.hmac.equal"}, equal_decl, hmac_equal_impl);
+      return bi::pure({"crypto.hmac.equal"}, equal_decl, hmac_equal_impl);
 #endif
     }
 
@@ -398,7 +397,7 @@ namespace
 #ifndef REGOCPP_HAS_CRYPTO
       return BuiltInDef::placeholder({"crypto.hmac.md5"}, md5_decl, Message);
 #else
-      return BuiltInDef::create({"crypto.hmac.md5"}, md5_decl, hmac_md5_impl);
+      return bi::pure({"crypto.hmac.md5"}, md5_decl, hmac_md5_impl);
 #endif
     }
 
@@ -417,8 +416,7 @@ namespace
 #ifndef REGOCPP_HAS_CRYPTO
       return BuiltInDef::placeholder({"crypto.hmac.sha1"}, sha1_decl, Message);
 #else
-      return BuiltInDef::create(
-        {"crypto.hmac.sha1"}, sha1_decl, hmac_sha1_impl);
+      return bi::pure({"crypto.hmac.sha1"}, sha1_decl, hmac_sha1_impl);
 #endif
     }
 
@@ -438,8 +436,7 @@ namespace
       return BuiltInDef::placeholder(
         {"crypto.hmac.sha256"}, sha256_decl, Message);
 #else
-      return BuiltInDef::create(
-        {"crypto.hmac.sha256"}, sha256_decl, hmac_sha256_impl);
+      return bi::pure({"crypto.hmac.sha256"}, sha256_decl, hmac_sha256_impl);
 #endif
     }
 
@@ -459,8 +456,7 @@ namespace
       return BuiltInDef::placeholder(
         {"crypto.hmac.sha512"}, sha512_decl, Message);
 #else
-      return BuiltInDef::create(
-        {"crypto.hmac.sha512"}, sha512_decl, hmac_sha512_impl);
+      return bi::pure({"crypto.hmac.sha512"}, sha512_decl, hmac_sha512_impl);
 #endif
     }
   } // namespace hmac
@@ -478,7 +474,7 @@ namespace
 #ifndef REGOCPP_HAS_CRYPTO
     return BuiltInDef::placeholder({"crypto.md5"}, md5_decl, Message);
 #else
-    return BuiltInDef::create({"crypto.md5"}, md5_decl, md5_impl);
+    return bi::pure({"crypto.md5"}, md5_decl, md5_impl);
 #endif
   }
 
@@ -505,7 +501,7 @@ namespace
     return BuiltInDef::placeholder(
       {"crypto.parse_private_keys"}, parse_private_keys_decl, Message);
 #else
-    return BuiltInDef::create(
+    return bi::pure(
       {"crypto.parse_private_keys"},
       parse_private_keys_decl,
       parse_private_keys_impl);
@@ -525,7 +521,7 @@ namespace
 #ifndef REGOCPP_HAS_CRYPTO
     return BuiltInDef::placeholder({"crypto.sha1"}, sha1_decl, Message);
 #else
-    return BuiltInDef::create({"crypto.sha1"}, sha1_decl, sha1_impl);
+    return bi::pure({"crypto.sha1"}, sha1_decl, sha1_impl);
 #endif
   }
 
@@ -542,7 +538,7 @@ namespace
 #ifndef REGOCPP_HAS_CRYPTO
     return BuiltInDef::placeholder({"crypto.sha256"}, sha256_decl, Message);
 #else
-    return BuiltInDef::create({"crypto.sha256"}, sha256_decl, sha256_impl);
+    return bi::pure({"crypto.sha256"}, sha256_decl, sha256_impl);
 #endif
   }
 
@@ -674,7 +670,7 @@ namespace
         parse_certificate_request_decl,
         Message);
 #else
-      return BuiltInDef::create(
+      return bi::pure(
         {"crypto.x509.parse_certificate_request"},
         parse_certificate_request_decl,
         parse_certificate_request_impl);
@@ -704,7 +700,7 @@ namespace
       return BuiltInDef::placeholder(
         {"crypto.x509.parse_certificates"}, parse_certificates_decl, Message);
 #else
-      return BuiltInDef::create(
+      return bi::pure(
         {"crypto.x509.parse_certificates"},
         parse_certificates_decl,
         parse_certificates_impl);
@@ -737,7 +733,7 @@ namespace
       return BuiltInDef::placeholder(
         {"crypto.x509.parse_keypair"}, parse_keypair_decl, Message);
 #else
-      return BuiltInDef::create(
+      return bi::pure(
         {"crypto.x509.parse_keypair"}, parse_keypair_decl, parse_keypair_impl);
 #endif
     }
@@ -762,7 +758,7 @@ namespace
         parse_rsa_private_key_decl,
         Message);
 #else
-      return BuiltInDef::create(
+      return bi::pure(
         {"crypto.x509.parse_rsa_private_key"},
         parse_rsa_private_key_decl,
         parse_rsa_private_key_impl);
@@ -36,7 +36,7 @@ namespace
                      << (bi::Name ^ "y")
                      << (bi::Description ^ "base64 serialization of `x`")
                      << (bi::Type << bi::String));
-      return BuiltInDef::create({"base64.encode"}, encode_decl, encode);
+      return bi::pure({"base64.encode"}, encode_decl, encode);
     }
 
     Node decode(const Nodes& args)
@@ -63,7 +63,7 @@ namespace
                      << (bi::Name ^ "y")
                      << (bi::Description ^ "base64 deserialization of `x`")
                      << (bi::Type << bi::String));
-      return BuiltInDef::create({"base64.decode"}, decode_decl, decode);
+      return bi::pure({"base64.decode"}, decode_decl, decode);
     }
 
     Node is_valid(const Nodes& args)
@@ -96,8 +96,7 @@ namespace
                                     "`true` if `x` is valid base64 encoded "
                                     "value, `false` otherwise")
                                 << (bi::Type << bi::Boolean));
-      return BuiltInDef::create(
-        {"base64.is_valid"}, base64_is_valid_decl, is_valid);
+      return bi::pure({"base64.is_valid"}, base64_is_valid_decl, is_valid);
     }
   } // namespace base64
 
@@ -127,7 +126,7 @@ namespace
                      << (bi::Name ^ "y")
                      << (bi::Description ^ "base64url serialization of `x`")
                      << (bi::Type << bi::String));
-      return BuiltInDef::create({"base64url.encode"}, encode_decl, encode);
+      return bi::pure({"base64url.encode"}, encode_decl, encode);
     }
 
     Node encode_no_pad(const Nodes& args)
@@ -158,7 +157,7 @@ namespace
                      << (bi::Name ^ "y")
                      << (bi::Description ^ "base64url serialization of `x`")
                      << (bi::Type << bi::String));
-      return BuiltInDef::create(
+      return bi::pure(
         {"base64url.encode_no_pad"}, encode_no_pad_decl, encode_no_pad);
     }
 
@@ -186,7 +185,7 @@ namespace
                      << (bi::Name ^ "y")
                      << (bi::Description ^ "base64url deserialization of `x`")
                      << (bi::Type << bi::String));
-      return BuiltInDef::create({"base64url.decode"}, decode_decl, decode);
+      return bi::pure({"base64url.decode"}, decode_decl, decode);
     }
   } // namespace base64url
 
@@ -240,7 +239,7 @@ namespace
                                 << (bi::Description ^
                                     "serialization of `x` using hex-encoding")
                                 << (bi::Type << bi::String));
-      return BuiltInDef::create({"hex.encode"}, encode_decl, encode);
+      return bi::pure({"hex.encode"}, encode_decl, encode);
     }
 
     Node decode(const Nodes& args)
@@ -286,7 +285,7 @@ namespace
                  << (bi::Result << (bi::Name ^ "y")
                                 << (bi::Description ^ "deserialized from `x`")
                                 << (bi::Type << bi::String));
-      return BuiltInDef::create({"hex.decode"}, decode_decl, decode);
+      return bi::pure({"hex.decode"}, decode_decl, decode);
     }
   } // namespace hex
 
@@ -334,7 +333,7 @@ namespace
                                 << (bi::Description ^
                                     "the YAML string representation of `x`")
                                 << (bi::Type << bi::String));
-      return BuiltInDef::create({"yaml.marshal"}, marshal_decl, marshal);
+      return bi::pure({"yaml.marshal"}, marshal_decl, marshal);
     }
 
     Node unmarshal(const Nodes& args)
@@ -370,7 +369,7 @@ namespace
                      << (bi::Name ^ "y")
                      << (bi::Description ^ "the term deserialized from `x`")
                      << (bi::Type << bi::Any));
-      return BuiltInDef::create({"yaml.unmarshal"}, unmarshal_decl, unmarshal);
+      return bi::pure({"yaml.unmarshal"}, unmarshal_decl, unmarshal);
     }
 
     Node is_valid(const Nodes& args)
@@ -400,7 +399,7 @@ namespace
                      << (bi::Description ^
                          "`true` if `x` is valid YAML, `false` otherwise")
                      << (bi::Type << bi::Boolean));
-      return BuiltInDef::create({"yaml.is_valid"}, is_valid_decl, is_valid);
+      return bi::pure({"yaml.is_valid"}, is_valid_decl, is_valid);
     }
   } // namespace yaml_
 
@@ -449,7 +448,7 @@ namespace
                      << (bi::Name ^ "y")
                      << (bi::Description ^ "URL-encoding serialization of `x`")
                      << (bi::Type << bi::String));
-      return BuiltInDef::create({"urlquery.encode"}, encode_decl, encode);
+      return bi::pure({"urlquery.encode"}, encode_decl, encode);
     }
 
     Node encode_object(const Nodes& args)
@@ -542,7 +541,7 @@ namespace
                                 << (bi::Description ^
                                     "URL-encoding serialization of `object`")
                                 << (bi::Type << bi::String));
-      return BuiltInDef::create(
+      return bi::pure(
         {"urlquery.encode_object"}, encode_object_decl, encode_object);
     }
 
@@ -609,7 +608,7 @@ namespace
                                 << (bi::Description ^
                                     "URL-encoding deserialization of `x`")
                                 << (bi::Type << bi::String));
-      return BuiltInDef::create({"urlquery.decode"}, decode_decl, decode);
+      return bi::pure({"urlquery.decode"}, decode_decl, decode);
     }
 
     Node decode_object(const Nodes& args)
@@ -693,7 +692,7 @@ namespace
                              << (bi::Type
                                  << (bi::DynamicArray
                                      << (bi::Type << bi::String))))));
-      return BuiltInDef::create(
+      return bi::pure(
         {"urlquery.decode_object"}, decode_object_decl, decode_object);
     }
   } // namespace urlquery
@@ -648,7 +648,7 @@ namespace
                          "true if `match` can be found in `pattern` which is "
                          "separated by `delimiters`")
                      << (bi::Type << bi::Boolean));
-    return BuiltInDef::create({"glob.match"}, match_decl, match_impl);
+    return bi::pure({"glob.match"}, match_decl, match_impl);
   }
 
   BuiltIn quote_meta_factory()
@@ -662,8 +662,7 @@ namespace
                    << (bi::Name ^ "output")
                    << (bi::Description ^ "the escaped string of `pattern`")
                    << (bi::Type << bi::String));
-    return BuiltInDef::create(
-      {"glob.quote_meta"}, quote_meta_decl, quote_meta_impl);
+    return bi::pure({"glob.quote_meta"}, quote_meta_decl, quote_meta_impl);
   }
 }
 
@@ -1,30 +1,38 @@
 #include "builtins.hh"
 
+#include <numeric>
+
 namespace
 {
   using namespace rego;
   namespace bi = rego::builtins;
 
-  using NodeIndex = std::map<std::string, Node>;
-  using Graph = std::map<std::string_view, std::set<std::string_view>>;
+  // Vertices are interned by value, so the graph itself can be expressed
+  // over dense ids rather than serialised keys.
+  struct NodeIndex
+  {
+    TermMap<std::size_t> ids;
+    Nodes nodes;
+  };
+
+  using Graph = std::map<std::size_t, std::set<std::size_t>>;
 
-  std::string_view lookup(NodeIndex& index, Node node)
+  std::size_t lookup(NodeIndex& index, Node node)
   {
-    std::string key = to_key(node);
-    if (!index.contains(key))
+    auto [it, inserted] = index.ids.try_emplace(node, index.nodes.size());
+    if (inserted)
     {
-      index[key] = node;
+      index.nodes.push_back(node);
     }
 
-    return index.find(key)->first;
+    return it->second;
   }
 
   void index_nodes(NodeIndex& index, Node array)
   {
     for (auto& node : *array)
     {
-      std::string key = to_key(node);
-      index[key] = node;
+      lookup(index, node);
     }
   }
 
@@ -32,7 +40,7 @@ namespace
   {
     for (auto& edge : *edges)
     {
-      std::string_view src = lookup(index, edge / Key);
+      std::size_t src = lookup(index, edge / Key);
 
       auto maybe_dst = unwrap(edge / Val, {Set, Array, Null});
       if (!maybe_dst.success)
@@ -46,7 +54,7 @@ namespace
         continue;
       }
 
-      std::set<std::string_view> dsts = {};
+      std::set<std::size_t> dsts = {};
       for (auto& node : *maybe_dst.node)
       {
         dsts.insert(lookup(index, node));
@@ -77,11 +85,8 @@ namespace
     NodeIndex nodes;
     index_nodes(nodes, initial_nodes);
 
-    std::vector<std::string_view> initial_set;
-    for (auto& [key, _] : nodes)
-    {
-      initial_set.push_back(key);
-    }
+    std::vector<std::size_t> initial_set(nodes.nodes.size());
+    std::iota(initial_set.begin(), initial_set.end(), 0);
 
     Graph graph;
     Node err = build_graph(graph, graph_object, nodes);
@@ -90,13 +95,13 @@ namespace
       return err;
     }
 
-    std::set<std::string_view> visited;
-    std::vector<std::string_view> frontier;
+    std::set<std::size_t> visited;
+    std::vector<std::size_t> frontier;
     frontier.insert(frontier.end(), initial_set.begin(), initial_set.end());
 
     while (!frontier.empty())
     {
-      std::string_view current = frontier.back();
+      std::size_t current = frontier.back();
       frontier.pop_back();
       if (visited.contains(current))
       {
@@ -114,9 +119,9 @@ namespace
     }
 
     Node argseq = NodeDef::create(Seq);
-    for (auto& key : visited)
+    for (auto& id : visited)
     {
-      argseq->push_back(nodes[std::string(key)]);
+      argseq->push_back(nodes.nodes[id]);
     }
 
     return Resolver::set(argseq);
@@ -154,14 +159,14 @@ namespace
                          "set of vertices from the `initial` vertices in the "
                          "directed `graph`")
                      << (bi::Type << (bi::Set << (bi::Type << bi::Any))));
-    return BuiltInDef::create({"graph.reachable"}, reachable_decl, reachable);
+    return bi::pure({"graph.reachable"}, reachable_decl, reachable);
   }
 
   class Path
   {
   private:
-    std::vector<std::string_view> m_order;
-    std::set<std::string_view> m_visited;
+    std::vector<std::size_t> m_order;
+    std::set<std::size_t> m_visited;
 
   public:
     Path(const Path& path) :
@@ -173,26 +178,26 @@ namespace
       m_order(std::move(other.m_order)), m_visited(std::move(other.m_visited))
     {}
 
-    Path(std::string_view key)
+    Path(std::size_t id)
     {
-      m_order.push_back(key);
-      m_visited.insert(key);
+      m_order.push_back(id);
+      m_visited.insert(id);
     }
 
-    Path operator+(std::string_view key)
+    Path operator+(std::size_t id)
     {
       Path new_path = *this;
-      new_path.m_order.push_back(key);
-      new_path.m_visited.insert(key);
+      new_path.m_order.push_back(id);
+      new_path.m_visited.insert(id);
       return new_path;
     }
 
     Path& operator=(const Path& path)
     {
       m_order =
-        std::vector<std::string_view>(path.m_order.begin(), path.m_order.end());
-      m_visited = std::set<std::string_view>(
-        path.m_visited.begin(), path.m_visited.end());
+        std::vector<std::size_t>(path.m_order.begin(), path.m_order.end());
+      m_visited =
+        std::set<std::size_t>(path.m_visited.begin(), path.m_visited.end());
       return *this;
     }
 
@@ -203,12 +208,12 @@ namespace
       return *this;
     }
 
-    std::string_view back() const
+    std::size_t back() const
     {
       return m_order.back();
     }
 
-    const std::set<std::string_view>& visited() const
+    const std::set<std::size_t>& visited() const
     {
       return m_visited;
     }
@@ -216,10 +221,9 @@ namespace
     Node to_node(const NodeIndex& index) const
     {
       Node argseq = NodeDef::create(Seq);
-      for (auto& key : m_order)
+      for (auto& id : m_order)
       {
-        std::string key_str(key);
-        argseq->push_back(index.at(key_str));
+        argseq->push_back(index.nodes[id]);
       }
 
       return Resolver::array(argseq);
@@ -245,11 +249,8 @@ namespace
     NodeIndex nodes;
     index_nodes(nodes, initial_nodes);
 
-    std::vector<std::string_view> initial_set;
-    for (auto& [key, _] : nodes)
-    {
-      initial_set.push_back(key);
-    }
+    std::vector<std::size_t> initial_set(nodes.nodes.size());
+    std::iota(initial_set.begin(), initial_set.end(), 0);
 
     Graph graph;
     Node err = build_graph(graph, graph_object, nodes);
@@ -264,7 +265,7 @@ namespace
       initial_set.begin(),
       initial_set.end(),
       std::back_inserter(frontier),
-      [](std::string_view key) { return Path{key}; });
+      [](std::size_t id) { return Path{id}; });
 
     while (!frontier.empty())
     {
@@ -278,7 +279,7 @@ namespace
         continue;
       }
 
-      std::vector<std::string_view> unvisited;
+      std::vector<std::size_t> unvisited;
       std::set_difference(
         graph[current].begin(),
         graph[current].end(),
@@ -286,12 +287,12 @@ namespace
         path.visited().end(),
         std::back_inserter(unvisited));
 
-      std::vector<std::string_view> neighbors;
+      std::vector<std::size_t> neighbors;
       std::copy_if(
         unvisited.begin(),
         unvisited.end(),
         std::back_inserter(neighbors),
-        [&graph](std::string_view key) { return graph.contains(key); });
+        [&graph](std::size_t id) { return graph.contains(id); });
 
       if (neighbors.empty())
       {
@@ -303,7 +304,7 @@ namespace
           neighbors.begin(),
           neighbors.end(),
           std::back_inserter(frontier),
-          [&path](std::string_view key) { return path + key; });
+          [&path](std::size_t id) { return path + id; });
       }
     }
 
@@ -352,7 +353,7 @@ namespace
                              << (bi::Type
                                  << (bi::DynamicArray
                                      << (bi::Type << bi::Any))))));
-    return BuiltInDef::create(
+    return bi::pure(
       {"graph.reachable_paths"}, reachable_paths_decl, reachable_paths);
   }
 }
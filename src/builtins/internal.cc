@@ -24,7 +24,7 @@ namespace
                      << (bi::Description ^
                          "true if `item` is a member of `itemseq`")
                      << (bi::Type << bi::Boolean));
-    return BuiltInDef::create({"internal.member_2"}, member_2_decl, member_2);
+    return bi::pure({"internal.member_2"}, member_2_decl, member_2);
   }
 
   Node member_3(const Nodes& args)
@@ -48,7 +48,7 @@ namespace
                      << (bi::Description ^
                          "true if (`index`, `item`) is a member of `itemseq`")
                      << (bi::Type << bi::Boolean));
-    return BuiltInDef::create({"internal.member_3"}, member_3_decl, member_3);
+    return bi::pure({"internal.member_3"}, member_3_decl, member_3);
   }
 
   std::string print_value(const Node& node)
@@ -290,7 +290,7 @@ namespace
                << (bi::Result << (bi::Name ^ "output")
                               << (bi::Description ^ "composed template string")
                               << (bi::Type << bi::String));
-    return BuiltInDef::create(
+    return bi::pure(
       {"internal.template_string"}, template_string_decl, template_string);
   }
 }
@@ -38,7 +38,7 @@ namespace
                               << (bi::Description ^
                                   "the JSON string representation of `x`")
                               << (bi::Type << bi::String));
-    return BuiltInDef::create({"json.marshal"}, marshal_decl, marshal);
+    return bi::pure({"json.marshal"}, marshal_decl, marshal);
   }
 
   Node marshal_with_options(const Nodes& args)
@@ -170,7 +170,7 @@ namespace
               "the JSON string representation of `x`, with configured "
               "prefix/indent string(s) as appropriate")
           << (bi::Type << bi::String));
-    return BuiltInDef::create(
+    return bi::pure(
       {"json.marshal_with_options"},
       marshal_with_options_decl,
       marshal_with_options);
@@ -209,7 +209,7 @@ namespace
                    << (bi::Name ^ "y")
                    << (bi::Description ^ "the term deserialized from `x`")
                    << (bi::Type << bi::Any));
-    return BuiltInDef::create({"json.unmarshal"}, unmarshal_decl, unmarshal);
+    return bi::pure({"json.unmarshal"}, unmarshal_decl, unmarshal);
   }
 
   Node is_valid(const Nodes& args)
@@ -238,7 +238,7 @@ namespace
                    << (bi::Description ^
                        "`true` if `x` is valid JSON, `false` otherwise")
                    << (bi::Type << bi::Boolean));
-    return BuiltInDef::create({"json.is_valid"}, is_valid_decl, is_valid);
+    return bi::pure({"json.is_valid"}, is_valid_decl, is_valid);
   }
 
   namespace pointer
@@ -1401,7 +1401,7 @@ namespace
                          "remaining data from `object` with only keys "
                          "specified in `paths`")
                      << (bi::Type << bi::Any));
-    return BuiltInDef::create({"json.filter"}, filter_decl, filter);
+    return bi::pure({"json.filter"}, filter_decl, filter);
   }
 
   Node remove_(Nodes args)
@@ -1595,7 +1595,7 @@ namespace
                      << (bi::Description ^
                          "result of removing all keys specified in `paths`")
                      << (bi::Type << bi::Any));
-    return BuiltInDef::create({"json.remove"}, remove_decl, remove_);
+    return bi::pure({"json.remove"}, remove_decl, remove_);
   }
 
   BuiltIn match_schema_factory()
@@ -1766,7 +1766,7 @@ namespace
                          "result obtained after consecutively applying "
                          "all patch operations in `patches`")
                      << (bi::Type << bi::Any));
-    return BuiltInDef::create({"json.patch"}, patch_decl, patch_);
+    return bi::pure({"json.patch"}, patch_decl, patch_);
   }
 }
 
@@ -918,7 +918,7 @@ namespace
 #ifndef REGOCPP_HAS_CRYPTO
     return BuiltInDef::placeholder({"io.jwt.decode"}, decode_decl, Message);
 #else
-    return BuiltInDef::create(
+    return bi::pure(
       {"io.jwt.decode"}, decode_decl, [](const Nodes& args) {
         return decode_impl(args);
       });
@@ -1071,7 +1071,7 @@ namespace rego
 #ifndef REGOCPP_HAS_CRYPTO
         return BuiltInDef::placeholder(name, verify_decl, Message);
 #else
-        return BuiltInDef::create(
+        return bi::pure(
           name, verify_decl, [view = std::string(view)](const Nodes& args) {
             return verify_impl(view, args);
           });
@@ -21,6 +21,26 @@ namespace
       return rhs_number;
     }
 
+    auto lhs_int64 = try_get_int64(lhs_number);
+    auto rhs_int64 = try_get_int64(rhs_number);
+    if (lhs_int64.has_value() && rhs_int64.has_value())
+    {
+      // the bounds fit in 64 bits, and so (being inclusive) does every value
+      // in between
+      std::int64_t step = *lhs_int64 < *rhs_int64 ? 1 : -1;
+      Node array = Array ^ args[0];
+      for (std::int64_t curr = *lhs_int64;; curr += step)
+      {
+        array->push_back(Term << (Scalar << (Int ^ std::to_string(curr))));
+        if (curr == *rhs_int64)
+        {
+          break;
+        }
+      }
+
+      return array;
+    }
+
     BigInt lhs = get_int(lhs_number);
     BigInt rhs = get_int(rhs_number);
     Node array = Array ^ args[0];
@@ -62,7 +82,7 @@ namespace
                      << (bi::Description ^ "the range between `a` and `b`")
                      << (bi::Type
                          << (bi::DynamicArray << (bi::Type << bi::Number))));
-    return BuiltInDef::create({"numbers.range"}, range_decl, range);
+    return bi::pure({"numbers.range"}, range_decl, range);
   }
 
   Node range_step(const Nodes& args)
@@ -154,8 +174,7 @@ namespace
                      << (bi::Description ^ "the range between `a` and `b`")
                      << (bi::Type
                          << (bi::DynamicArray << (bi::Type << bi::Number))));
-    return BuiltInDef::create(
-      {"numbers.range_step"}, range_step_decl, range_step);
+    return bi::pure({"numbers.range_step"}, range_step_decl, range_step);
   }
 
   namespace rand
@@ -6,21 +6,18 @@ namespace
   using namespace rego;
   namespace bi = rego::builtins;
 
-  std::vector<std::string> get_keys(const Node& collection)
+  Nodes get_keys(const Node& collection)
   {
-    std::vector<std::string> keys;
+    Nodes keys;
     if (collection->type() == Array || collection->type() == Set)
     {
-      for (auto& item : *collection)
-      {
-        keys.push_back(to_key(item));
-      }
+      keys.insert(keys.end(), collection->begin(), collection->end());
     }
     else if (collection->type() == Object)
     {
       for (auto& item : *collection)
       {
-        keys.push_back(to_key(item / Key));
+        keys.push_back(item / Key);
       }
     }
     else
@@ -31,10 +28,10 @@ namespace
     return keys;
   }
 
-  std::set<std::string> get_key_set(const Node& collection)
+  TermSet get_key_set(const Node& collection)
   {
-    std::vector<std::string> keys = get_keys(collection);
-    return std::set<std::string>(keys.begin(), keys.end());
+    Nodes keys = get_keys(collection);
+    return TermSet(keys.begin(), keys.end());
   }
 
   Node filter(const Nodes& args)
@@ -57,8 +54,7 @@ namespace
     Node filtered = NodeDef::create(Object);
     for (auto& item : *object)
     {
-      std::string key_str = to_key(item / Key);
-      if (keys.contains(key_str))
+      if (keys.contains(item / Key))
       {
         filtered->push_back(item->clone());
       }
@@ -92,7 +88,7 @@ namespace
           << (bi::Description ^
               "remaining data from `object` with only keys specified in `keys`")
           << (bi::Type << bi::Any));
-    return BuiltInDef::create({"object.filter"}, filter_decl, filter);
+    return bi::pure({"object.filter"}, filter_decl, filter);
   }
 
   std::optional<Node> get_key(
@@ -113,10 +109,9 @@ namespace
     if (collection->type() == Object)
     {
       Node key = keys->at(index);
-      std::string key_str = to_key(key);
       for (auto& item : *collection)
       {
-        if (to_key(item / Key) == key_str)
+        if (term_equal(item / Key, key))
         {
           return get_key(item / Val, keys, index + 1);
         }
@@ -186,7 +181,7 @@ namespace
                      << (bi::Description ^
                          "`object[key]` if present, otherwise `default`")
                      << (bi::Type << bi::Any));
-    return BuiltInDef::create({"object.get"}, get_decl, get);
+    return bi::pure({"object.get"}, get_decl, get);
   }
 
   Node keys(const Nodes& args)
@@ -221,7 +216,7 @@ namespace
                    << (bi::Name ^ "value")
                    << (bi::Description ^ "set of `object`'s keys")
                    << (bi::Type << (bi::Set << (bi::Type << bi::Any))));
-    return BuiltInDef::create({"object.keys"}, keys_decl, keys);
+    return bi::pure({"object.keys"}, keys_decl, keys);
   }
 
   Node remove_(const Nodes& args)
@@ -244,8 +239,7 @@ namespace
     Node output = NodeDef::create(Object);
     for (auto& item : *object)
     {
-      std::string key_str = to_key(item / Key);
-      if (!keys.contains(key_str))
+      if (!keys.contains(item / Key))
       {
         output->push_back(item->clone());
       }
@@ -279,15 +273,15 @@ namespace
           << (bi::Description ^
               "result of removing the specified `keys` from `object`")
           << (bi::Type << bi::Any));
-    return BuiltInDef::create({"object.remove"}, remove_decl, remove_);
+    return bi::pure({"object.remove"}, remove_decl, remove_);
   }
 
-  std::map<std::string, Node> to_map(Node object)
+  TermMap<Node> to_map(Node object)
   {
-    std::map<std::string, Node> map;
+    TermMap<Node> map;
     for (auto& item : *object)
     {
-      map[to_key(item / Key)] = (item / Val)->front();
+      map[item / Key] = (item / Val)->front();
     }
 
     return map;
@@ -304,8 +298,12 @@ namespace
 
     auto super_keys = get_keys(super);
     auto sub_keys = get_keys(sub);
-    std::string first = sub_keys[0];
-    auto pos = std::find(super_keys.begin(), super_keys.end(), first);
+    Node first = sub_keys[0];
+    auto matches_first = [&first](const Node& key) {
+      return term_equal(key, first);
+    };
+    auto pos =
+      std::find_if(super_keys.begin(), super_keys.end(), matches_first);
     while (pos != super_keys.end())
     {
       auto remaining = std::distance(pos, super_keys.end());
@@ -317,7 +315,7 @@ namespace
       bool is_subset = true;
       for (std::size_t i = 0; i < sub_keys.size(); i++)
       {
-        if (sub_keys[i] != pos[i])
+        if (!term_equal(sub_keys[i], pos[i]))
         {
           is_subset = false;
           break;
@@ -329,7 +327,7 @@ namespace
         return true;
       }
 
-      pos = std::find(pos + 1, super_keys.end(), first);
+      pos = std::find_if(pos + 1, super_keys.end(), matches_first);
     }
 
     return false;
@@ -344,8 +342,7 @@ namespace
       return false;
     }
     auto super_keys = get_key_set(super);
-    auto sub_keys = get_key_set(sub);
-    for (auto& key : sub_keys)
+    for (auto& key : *sub)
     {
       if (!super_keys.contains(key))
       {
@@ -365,8 +362,7 @@ namespace
       return false;
     }
     auto super_keys = get_key_set(super);
-    auto sub_keys = get_key_set(sub);
-    for (auto& key : sub_keys)
+    for (auto& key : *sub)
     {
       if (!super_keys.contains(key))
       {
@@ -409,7 +405,7 @@ namespace
 
     if (super->type() == sub->type())
     {
-      return to_key(super) == to_key(sub);
+      return term_equal(super, sub);
     }
 
     return false;
@@ -432,12 +428,13 @@ namespace
 
     for (auto& [key, value] : sub_map)
     {
-      if (!super_map.contains(key))
+      auto it = super_map.find(key);
+      if (it == super_map.end())
       {
         return false;
       }
 
-      Node super_value = super_map[key];
+      Node super_value = it->second;
       if (!is_subset(super_value, value))
       {
         return false;
@@ -501,7 +498,7 @@ namespace
                      << (bi::Description ^
                          "`true` if `sub` is a subset of `super`")
                      << (bi::Type << bi::Boolean));
-    return BuiltInDef::create({"object.subset"}, subset_decl, subset);
+    return bi::pure({"object.subset"}, subset_decl, subset);
   }
 
   Node object_union(const Node& lhs, const Node& rhs)
@@ -510,8 +507,7 @@ namespace
     auto rhs_keys = get_key_set(rhs);
     for (auto& item : *lhs)
     {
-      std::string key_str = to_key(item / Key);
-      if (!rhs_keys.contains(key_str))
+      if (!rhs_keys.contains(item / Key))
       {
         output->push_back(item->clone());
       }
@@ -560,7 +556,7 @@ namespace
                      << (bi::Type
                          << (bi::DynamicObject << (bi::Type << bi::Any)
                                                << (bi::Type << bi::Any))));
-    return BuiltInDef::create({"object.union"}, union_decl, union_);
+    return bi::pure({"object.union"}, union_decl, union_);
   }
 
   Node union_n(const Nodes& args)
@@ -609,7 +605,7 @@ namespace
           << (bi::Type
               << (bi::DynamicObject << (bi::Type << bi::Any)
                                     << (bi::Type << bi::Any))));
-    return BuiltInDef::create({"object.union_n"}, union_n_decl, union_n);
+    return bi::pure({"object.union_n"}, union_n_decl, union_n);
   }
 }
 
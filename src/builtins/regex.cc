@@ -166,7 +166,7 @@ namespace
       << (bi::Result << (bi::Name ^ "result")
                      << (bi::Description ^ "true of `value` matches `pattern`")
                      << (bi::Type << bi::Boolean));
-    return BuiltInDef::create({"regex.match"}, match_decl, match);
+    return bi::pure({"regex.match"}, match_decl, match);
   }
 
   Node is_valid(const Nodes& args)
@@ -203,7 +203,7 @@ namespace
                    << (bi::Description ^
                        "`true` if `pattern` is a valid regular expression")
                    << (bi::Type << bi::Boolean));
-    return BuiltInDef::create({"regex.is_valid"}, is_valid_decl, is_valid);
+    return bi::pure({"regex.is_valid"}, is_valid_decl, is_valid);
   }
 
   Node replace(const Nodes& args)
@@ -263,7 +263,7 @@ namespace
       << (bi::Result << (bi::Name ^ "output")
                      << (bi::Description ^ "string with replaced substrings")
                      << (bi::Type << bi::String));
-    return BuiltInDef::create({"regex.replace"}, replace_decl, replace);
+    return bi::pure({"regex.replace"}, replace_decl, replace);
   }
 
   Node find_n(const Nodes& args)
@@ -340,7 +340,7 @@ namespace
                      << (bi::Description ^ "collected matches")
                      << (bi::Type
                          << (bi::DynamicArray << (bi::Type << bi::String))));
-    return BuiltInDef::create({"regex.find_n"}, find_n_decl, find_n);
+    return bi::pure({"regex.find_n"}, find_n_decl, find_n);
   }
 
   Node find_all_string_submatch_n(const Nodes& args)
@@ -449,7 +449,7 @@ namespace
                              << (bi::Type
                                  << (bi::DynamicArray
                                      << (bi::Type << bi::String))))));
-    return BuiltInDef::create(
+    return bi::pure(
       {"regex.find_all_string_submatch_n"},
       find_all_string_submatch_n_decl,
       find_all_string_submatch_n);
@@ -518,7 +518,7 @@ namespace
                          "the parts obtained by splitting `value`")
                      << (bi::Type
                          << (bi::DynamicArray << (bi::Type << bi::String))));
-    return BuiltInDef::create({"regex.split"}, split_decl, split);
+    return bi::pure({"regex.split"}, split_decl, split);
   }
 
   enum class SectionType
@@ -670,7 +670,7 @@ namespace
                      << (bi::Description ^
                          "true of `value` matches the `template`")
                      << (bi::Type << bi::Boolean));
-    return BuiltInDef::create(
+    return bi::pure(
       {"regex.template_match"}, template_match_decl, template_match);
   }
 
@@ -1396,8 +1396,7 @@ namespace
                          "`true` if the intersection of `glob1` and `glob2` "
                          "matches a non-empty set of non-empty strings.")
                      << (bi::Type << bi::Boolean));
-    return BuiltInDef::create(
-      {"regex.globs_match"}, globs_match_decl, globs_match);
+    return bi::pure({"regex.globs_match"}, globs_match_decl, globs_match);
   }
 }
 
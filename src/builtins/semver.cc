@@ -184,7 +184,7 @@ namespace
                      << (bi::Description ^
                          "`-1` if `a < b`; `1` if `a > b`; `0` if `a == b`")
                      << (bi::Type << bi::Number));
-    return BuiltInDef::create({"semver.compare"}, compare_decl, compare);
+    return bi::pure({"semver.compare"}, compare_decl, compare);
   }
 
   Node is_valid(const Nodes& args)
@@ -217,7 +217,7 @@ namespace
                    << (bi::Description ^
                        "`true` if `vsn` is a valid SemVer; `false` otherwise")
                    << (bi::Type << bi::Boolean));
-    return BuiltInDef::create({"semver.is_valid"}, is_valid_decl, is_valid);
+    return bi::pure({"semver.is_valid"}, is_valid_decl, is_valid);
   }
 }
 
@@ -19,7 +19,6 @@ namespace
   const std::size_t minute_ns = 60UL * second_ns;
   const std::size_t hour_ns = 60UL * minute_ns;
 
-  static thread_local Node cached = nullptr;
   struct NowNS : public BuiltInDef
   {
     NowNS() :
@@ -29,26 +28,33 @@ namespace
                  << (bi::Result << (bi::Name ^ "now")
                                 << (bi::Description ^ "nanoseconds since epoch")
                                 << (bi::Type << bi::Number)),
-        [this](const Nodes&) { return call(); },
+        [](const Nodes&) { return call(); },
         true)
     {}
 
-    Node call()
+    // The time is read once per evaluation, so that every call within the
+    // evaluation sees the same value.
+    static Node call()
     {
-      if (cached != nullptr)
+      BuiltInContext* context = BuiltInContext::current();
+      if (context != nullptr)
       {
-        return cached->clone();
+        Node cached = context->get("time.now_ns");
+        if (cached != nullptr)
+        {
+          return cached->clone();
+        }
       }
 
       auto now = system_clock::now().time_since_epoch();
       auto now_ns = duration_cast<nanoseconds>(now).count();
-      cached = Int ^ std::to_string(now_ns);
-      return cached;
-    }
+      Node result = Int ^ std::to_string(now_ns);
+      if (context != nullptr)
+      {
+        context->put("time.now_ns", result->clone());
+      }
 
-    void clear() override
-    {
-      cached = nullptr;
+      return result;
     }
   };
 
@@ -199,7 +205,7 @@ namespace
                    << (bi::Name ^ "ns")
                    << (bi::Description ^ "the `duration` in nanoseconds")
                    << (bi::Type << bi::Number));
-    return BuiltInDef::create(
+    return bi::pure(
       {"time.parse_duration_ns"}, parse_duration_ns_decl, parse_duration_ns);
   }
 
@@ -577,7 +583,7 @@ namespace
 
   BuiltIn add_date_factory()
   {
-    return BuiltInDef::create({"time.add_date"}, add_date_decl(), add_date);
+    return bi::pure({"time.add_date"}, add_date_decl(), add_date);
   }
 
   std::optional<nanoseconds> get_timestamp(Node x)
@@ -881,7 +887,7 @@ namespace
 
   BuiltIn clock_factory()
   {
-    return BuiltInDef::create({"time.clock"}, clock_decl(), clock_);
+    return bi::pure({"time.clock"}, clock_decl(), clock_);
   }
 
   Node date_(const Nodes& args)
@@ -916,7 +922,7 @@ namespace
 
   BuiltIn date_factory()
   {
-    return BuiltInDef::create({"time.date"}, date_decl(), date_);
+    return bi::pure({"time.date"}, date_decl(), date_);
   }
 
   Node diff(const Nodes& args)
@@ -986,7 +992,7 @@ namespace
 
   BuiltIn diff_factory()
   {
-    return BuiltInDef::create({"time.diff"}, diff_decl(), diff);
+    return bi::pure({"time.diff"}, diff_decl(), diff);
   }
 
   Node format(const Nodes& args)
@@ -1002,7 +1008,7 @@ namespace
 
   BuiltIn format_factory()
   {
-    return BuiltInDef::create({"time.format"}, format_decl(), format);
+    return bi::pure({"time.format"}, format_decl(), format);
   }
 
   Node do_parse(const std::string& layout, const Node& value)
@@ -1089,7 +1095,7 @@ namespace
 
   BuiltIn parse_ns_factory()
   {
-    return BuiltInDef::create({"time.parse_ns"}, parse_ns_decl(), parse_ns);
+    return bi::pure({"time.parse_ns"}, parse_ns_decl(), parse_ns);
   }
 
   Node parse_rfc3339_ns(const Nodes& args)
@@ -1106,7 +1112,7 @@ namespace
 
   BuiltIn parse_rfc3339_ns_factory()
   {
-    return BuiltInDef::create(
+    return bi::pure(
       {"time.parse_rfc3339_ns"}, parse_rfc3339_ns_decl(), parse_rfc3339_ns);
   }
 
@@ -1130,7 +1136,7 @@ namespace
 
   BuiltIn weekday_factory()
   {
-    return BuiltInDef::create({"time.weekday"}, weekday_decl(), weekday);
+    return bi::pure({"time.weekday"}, weekday_decl(), weekday);
   }
 
 #else
@@ -267,7 +267,7 @@ namespace
                << (bi::Result << (bi::Name ^ "y")
                               << (bi::Description ^ "the parsed number")
                               << (bi::Type << bi::Number));
-    return BuiltInDef::create({"units.parse"}, parse_decl, parse);
+    return bi::pure({"units.parse"}, parse_decl, parse);
   }
 
   Node parse_bytes(const Nodes& args)
@@ -297,8 +297,7 @@ namespace
                << (bi::Result << (bi::Name ^ "y")
                               << (bi::Description ^ "the parsed number")
                               << (bi::Type << bi::Number));
-    return BuiltInDef::create(
-      {"units.parse_bytes"}, parse_bytes_decl, parse_bytes);
+    return bi::pure({"units.parse_bytes"}, parse_bytes_decl, parse_bytes);
   }
 }
 
@@ -313,7 +313,7 @@ namespace
                    << (bi::Type
                        << (bi::DynamicObject << (bi::Type << bi::String)
                                              << (bi::Type << bi::String))));
-    return BuiltInDef::create({"uri.parse"}, parse_decl, parse);
+    return bi::pure({"uri.parse"}, parse_decl, parse);
   }
 
   Node is_valid(const Nodes& args)
@@ -347,7 +347,7 @@ namespace
                    << (bi::Description ^
                        "true if `uri` is a valid URI, false otherwise")
                    << (bi::Type << bi::Boolean));
-    return BuiltInDef::create({"uri.is_valid"}, is_valid_decl, is_valid);
+    return bi::pure({"uri.is_valid"}, is_valid_decl, is_valid);
   }
 }
 
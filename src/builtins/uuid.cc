@@ -387,10 +387,9 @@ namespace
                    << (bi::Type
                        << (bi::DynamicObject << (bi::Type << bi::String)
                                              << (bi::Type << bi::Any))));
-    return BuiltInDef::create({"uuid.parse"}, parse_decl, parse);
+    return bi::pure({"uuid.parse"}, parse_decl, parse);
   }
 
-  thread_local std::map<std::string, Node> cache;
   thread_local xoroshiro::p128r32 generator;
 
   struct UUIDRFC4122 : public BuiltInDef
@@ -409,11 +408,12 @@ namespace
                   "a version 4 UUID; for any given `k`, the output will be "
                   "consistent throughout a query evaluation")
               << (bi::Type << bi::String)),
-        [this](const Nodes& args) { return call(args); },
+        [](const Nodes& args) { return call(args); },
         true)
     {}
 
-    Node call(const Nodes& args)
+    // The UUID for each `k` is generated once per evaluation.
+    static Node call(const Nodes& args)
     {
       Node k =
         unwrap_arg(args, UnwrapOpt(0).func("uuid.rfc4122").type(JSONString));
@@ -422,21 +422,25 @@ namespace
         return k;
       }
 
-      std::string k_str = get_string(k);
-      if (cache.contains(k_str))
+      std::string key = "uuid.rfc4122:" + get_string(k);
+      BuiltInContext* context = BuiltInContext::current();
+      if (context != nullptr)
       {
-        return cache[k_str]->clone();
+        Node cached = context->get(key);
+        if (cached != nullptr)
+        {
+          return cached->clone();
+        }
       }
 
       std::string uuid_str = uuid_to_string(uuid_random(generator));
       Node uuid_node = JSONString ^ uuid_str;
-      cache[k_str] = uuid_node;
-      return uuid_node;
-    }
+      if (context != nullptr)
+      {
+        context->put(key, uuid_node->clone());
+      }
 
-    void clear() override
-    {
-      cache.clear();
+      return uuid_node;
     }
   };
 }
@@ -51,6 +51,16 @@ namespace
     const size_t local_count = bundle.local_count;
     const size_t strings_count = bundle.strings.size();
 
+    // The VM dispatches on the statement type through a jump table.
+    if (
+      static_cast<int>(stmt.type) < static_cast<int>(StatementType::Nop) ||
+      static_cast<int>(stmt.type) > static_cast<int>(StatementType::With))
+    {
+      throw std::runtime_error(
+        "bundle verify: invalid statement type " +
+        std::to_string(static_cast<int>(stmt.type)));
+    }
+
     if (stmt.target < 0 || static_cast<size_t>(stmt.target) >= local_count)
     {
       // These types never read stmt.target (audited vs run_stmt); skip check.
@@ -1006,6 +1016,11 @@ namespace rego
 
   void BundleDef::verify() const
   {
+    if (m_verified.value.load(std::memory_order_acquire))
+    {
+      return;
+    }
+
     if (query_plan.has_value() && *query_plan >= plans.size())
     {
       throw std::runtime_error(
@@ -1060,5 +1075,12 @@ namespace rego
         verify_block(block, *this);
       }
     }
+
+    m_verified.value.store(true, std::memory_order_release);
+  }
+
+  bool BundleDef::is_verified() const
+  {
+    return m_verified.value.load(std::memory_order_acquire);
   }
 }
\ No newline at end of file
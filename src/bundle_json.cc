@@ -2284,9 +2284,16 @@ namespace
 
 namespace rego
 {
-  Rewriter json_to_bundle()
+  Rewriter json_to_bundle(bool optimize)
   {
-    return {"json_to_bundle", {::json_to_bundle()}, json::wf};
+    std::vector<Pass> passes = {::json_to_bundle()};
+    if (optimize)
+    {
+      std::vector<Pass> optimizations = optimize_bundle();
+      passes.insert(passes.end(), optimizations.begin(), optimizations.end());
+    }
+
+    return {"json_to_bundle", passes, json::wf};
   }
 
   Rewriter bundle_to_json()
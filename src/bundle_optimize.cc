@@ -0,0 +1,1244 @@
+#include "internal.hh"
+#include "rego.hh"
+#include "trieste/logging.h"
+#include "trieste/rewrite.h"
+
+#include <map>
+#include <set>
+#include <string>
+
+namespace
+{
+  using namespace rego;
+
+  /// Statements whose only effect is to write their target. They cannot
+  /// fail, and can be removed if the target is never read.
+  const std::initializer_list<Token> PureWriteStmts = {
+    AssignIntStmt,
+    AssignVarStmt,
+    MakeArrayStmt,
+    MakeNullStmt,
+    MakeNumberIntStmt,
+    MakeNumberRefStmt,
+    MakeObjectStmt,
+    MakeSetStmt,
+    ResetLocalStmt};
+
+  /// Statements which change the collection held in a local in place.
+  const std::initializer_list<Token> MutatingStmts = {
+    ArrayAppendStmt, ObjectInsertOnceStmt, ObjectInsertStmt, SetAddStmt};
+
+  /// Statements which do not write any local.
+  const std::initializer_list<Token> NoWriteStmts = {
+    BlockStmt,
+    BreakStmt,
+    EqualStmt,
+    IsArrayStmt,
+    IsDefinedStmt,
+    IsObjectStmt,
+    IsSetStmt,
+    IsUndefinedStmt,
+    NotEqualStmt,
+    NotStmt,
+    ResultSetAddStmt,
+    ReturnLocalStmt};
+
+  /// Statements whose local reads can be replaced by a copy of that local.
+  const std::initializer_list<Token> LocalReadStmts = {
+    IsDefinedStmt,
+    IsUndefinedStmt,
+    ObjectMergeStmt,
+    ResultSetAddStmt,
+    ScanStmt};
+
+  Nodes nested_blocks(const Node& stmt)
+  {
+    if (stmt == BlockStmt)
+    {
+      Node blockseq = stmt / Blocks;
+      return Nodes(blockseq->begin(), blockseq->end());
+    }
+
+    if (stmt->in({NotStmt, ScanStmt, WithStmt}))
+    {
+      return {stmt->back()};
+    }
+
+    return {};
+  }
+
+  bool contains(const Node& stmt, const std::initializer_list<Token>& types)
+  {
+    if (stmt->in(types))
+    {
+      return true;
+    }
+
+    for (const Node& block : nested_blocks(stmt))
+    {
+      for (const Node& inner : *block)
+      {
+        if (contains(inner, types))
+        {
+          return true;
+        }
+      }
+    }
+
+    return false;
+  }
+
+  /// The locals written directly by a statement (not including those
+  /// written by the statements nested in it).
+  std::vector<std::size_t> direct_writes(const Node& stmt)
+  {
+    if (stmt == ScanStmt)
+    {
+      return {to_size(stmt / Key), to_size(stmt / Val)};
+    }
+
+    if (stmt->in({ArrayAppendStmt, WithStmt}))
+    {
+      return {to_size(stmt->front())};
+    }
+
+    if (stmt->in(NoWriteStmts))
+    {
+      return {};
+    }
+
+    return {to_size(stmt->back())};
+  }
+
+  /// The locals written by a statement or by any statement nested in it.
+  void collect_writes(const Node& stmt, std::set<std::size_t>& writes)
+  {
+    for (std::size_t local : direct_writes(stmt))
+    {
+      writes.insert(local);
+    }
+
+    for (const Node& block : nested_blocks(stmt))
+    {
+      for (const Node& inner : *block)
+      {
+        collect_writes(inner, writes);
+      }
+    }
+  }
+
+  /// The locals read directly by a statement (not including those read by
+  /// the statements nested in it).
+  void collect_reads(const Node& stmt, std::vector<std::size_t>& reads)
+  {
+    for (const Node& child : *stmt)
+    {
+      if (child == Operand && child->front() == LocalIndex)
+      {
+        reads.push_back(to_size(child->front()));
+      }
+      else if (child == OperandSeq)
+      {
+        for (const Node& op : *child)
+        {
+          if (op->front() == LocalIndex)
+          {
+            reads.push_back(to_size(op->front()));
+          }
+        }
+      }
+    }
+
+    // the collections changed in place and the target of AssignVarOnce are
+    // read as well as written
+    if (stmt == ObjectMergeStmt)
+    {
+      reads.push_back(to_size(stmt / Lhs));
+      reads.push_back(to_size(stmt / Rhs));
+    }
+    else if (stmt->in(
+               {ArrayAppendStmt,
+                IsDefinedStmt,
+                IsUndefinedStmt,
+                ResultSetAddStmt,
+                ReturnLocalStmt,
+                ScanStmt,
+                WithStmt}))
+    {
+      reads.push_back(to_size(stmt->front()));
+    }
+    else if (stmt->in(
+               {AssignVarOnceStmt,
+                ObjectInsertOnceStmt,
+                ObjectInsertStmt,
+                SetAddStmt}))
+    {
+      reads.push_back(to_size(stmt->back()));
+    }
+  }
+
+  /// The number of times each local is read and written.
+  struct LocalUses
+  {
+    std::map<std::size_t, std::size_t> reads;
+    std::map<std::size_t, std::size_t> writes;
+
+    void add(const Node& stmt)
+    {
+      std::vector<std::size_t> locals;
+      collect_reads(stmt, locals);
+      for (std::size_t local : locals)
+      {
+        reads[local]++;
+      }
+
+      for (std::size_t local : direct_writes(stmt))
+      {
+        writes[local]++;
+      }
+
+      for (const Node& block : nested_blocks(stmt))
+      {
+        add_block(block);
+      }
+    }
+
+    void add_block(const Node& block)
+    {
+      for (const Node& stmt : *block)
+      {
+        add(stmt);
+      }
+    }
+
+    std::size_t read_count(std::size_t local) const
+    {
+      auto it = reads.find(local);
+      return it == reads.end() ? 0 : it->second;
+    }
+
+    std::size_t write_count(std::size_t local) const
+    {
+      auto it = writes.find(local);
+      return it == writes.end() ? 0 : it->second;
+    }
+  };
+
+  bool is_local(const Node& operand, std::size_t local)
+  {
+    Node value = operand->front();
+    return value == LocalIndex && to_size(value) == local;
+  }
+
+  bool same_value(const Node& lhs, const Node& rhs)
+  {
+    return lhs->type() == rhs->type() &&
+      lhs->location().view() == rhs->location().view();
+  }
+
+  using PlanSizes = std::map<Location, std::size_t>;
+
+  struct DotFact
+  {
+    Node source;
+    Node key;
+    std::size_t target;
+  };
+
+  /// What is known about the locals before a statement runs. A fact is
+  /// established by a statement which always runs before the current one,
+  /// and holds until one of the locals it mentions is written.
+  struct Facts
+  {
+    /// The targets of earlier Dot statements, by source and key
+    std::vector<DotFact> dots;
+    /// Locals which hold the same value as an operand
+    std::map<std::size_t, Node> copies;
+    /// Locals which are known to be defined
+    std::set<std::size_t> defined;
+    /// Locals which hold (part of) the input or data documents, and so
+    /// cannot be changed in place
+    std::set<std::size_t> frozen;
+
+    static Facts initial()
+    {
+      Facts facts;
+      facts.frozen = {0, 1};
+      return facts;
+    }
+
+    std::optional<std::size_t> dot(const Node& source, const Node& key) const
+    {
+      for (const DotFact& fact : dots)
+      {
+        if (
+          same_value(fact.source->front(), source->front()) &&
+          same_value(fact.key->front(), key->front()))
+        {
+          return fact.target;
+        }
+      }
+
+      return std::nullopt;
+    }
+
+    std::optional<Node> copy(std::size_t local) const
+    {
+      auto it = copies.find(local);
+      if (it == copies.end())
+      {
+        return std::nullopt;
+      }
+
+      return it->second;
+    }
+
+    bool is_frozen(const Node& operand) const
+    {
+      Node value = operand->front();
+      return value != LocalIndex || frozen.contains(to_size(value));
+    }
+
+    bool is_defined(const Node& operand) const
+    {
+      Node value = operand->front();
+      return value != LocalIndex || defined.contains(to_size(value));
+    }
+
+    void kill(std::size_t local)
+    {
+      std::erase_if(dots, [local](const DotFact& fact) {
+        return fact.target == local || is_local(fact.source, local) ||
+          is_local(fact.key, local);
+      });
+      std::erase_if(copies, [local](const auto& entry) {
+        return entry.first == local ||
+          (entry.second == LocalIndex && to_size(entry.second) == local);
+      });
+      defined.erase(local);
+      frozen.erase(local);
+    }
+
+    /// Updates the facts to those which hold after the statement has run.
+    /// For statements with nested blocks, these are also the facts which
+    /// hold on entry to each of those blocks.
+    void update(const Node& stmt)
+    {
+      std::set<std::size_t> writes;
+      collect_writes(stmt, writes);
+      for (std::size_t local : writes)
+      {
+        kill(local);
+      }
+
+      if (contains(stmt, MutatingStmts))
+      {
+        std::erase_if(dots, [this](const DotFact& fact) {
+          return !is_frozen(fact.source);
+        });
+      }
+
+      if (stmt == DotStmt)
+      {
+        Node source = stmt / Src;
+        Node key = stmt / Key;
+        std::size_t target = to_size(stmt / Target);
+        defined.insert(target);
+        if (!is_local(source, target) && !is_local(key, target))
+        {
+          dots.push_back({source->clone(), key->clone(), target});
+          if (is_frozen(source))
+          {
+            frozen.insert(target);
+          }
+        }
+      }
+      else if (stmt == AssignVarStmt)
+      {
+        Node source = stmt / Src;
+        std::size_t target = to_size(stmt / Target);
+        if (!is_local(source, target))
+        {
+          copies[target] = source->front()->clone();
+          if (is_defined(source))
+          {
+            defined.insert(target);
+          }
+
+          if (is_frozen(source))
+          {
+            frozen.insert(target);
+          }
+        }
+      }
+      else if (stmt == IsDefinedStmt)
+      {
+        defined.insert(to_size(stmt / Src));
+      }
+      else if (stmt->in(PureWriteStmts) && stmt != ResetLocalStmt)
+      {
+        defined.insert(to_size(stmt->back()));
+      }
+    }
+  };
+
+  /// Calls `rewrite` on each statement of the block, and of the blocks
+  /// nested in it, along with the facts which hold before the statement
+  /// runs. `rewrite` returns the statement to keep in its place, or nullptr
+  /// to remove it.
+  template<typename F>
+  std::size_t rewrite_block(Node block, Facts facts, F& rewrite)
+  {
+    std::size_t changes = 0;
+    bool changed = false;
+    Nodes stmts;
+    for (Node stmt : *block)
+    {
+      Node result = rewrite(stmt, facts, changes);
+      changed = changed || result != stmt;
+      if (result == nullptr)
+      {
+        continue;
+      }
+
+      Nodes blocks = nested_blocks(result);
+      facts.update(result);
+      for (Node& inner : blocks)
+      {
+        changes += rewrite_block(inner, facts, rewrite);
+      }
+
+      stmts.push_back(result);
+    }
+
+    if (changed)
+    {
+      block->erase(block->begin(), block->end());
+      for (Node& stmt : stmts)
+      {
+        block->push_back(stmt);
+      }
+    }
+
+    return changes;
+  }
+
+  /// The plans and functions of the bundle. Each top level block is run
+  /// independently (a function skips blocks which cannot match), so no facts
+  /// are carried from one to the next.
+  Nodes bodies(const Node& top)
+  {
+    Node policy = top / RegoBundle / Policy;
+    Nodes result;
+    for (Node plan : *(policy / PlanSeq))
+    {
+      result.push_back(plan);
+    }
+
+    for (Node function : *(policy / FunctionSeq))
+    {
+      result.push_back(function);
+    }
+
+    return result;
+  }
+
+  template<typename F>
+  std::size_t rewrite_bodies(const Node& top, F rewrite)
+  {
+    std::size_t changes = 0;
+    for (Node body : bodies(top))
+    {
+      for (Node block : *(body / BlockSeq))
+      {
+        changes += rewrite_block(block, Facts::initial(), rewrite);
+      }
+    }
+
+    return changes;
+  }
+
+  /// The number of statements in each plan, including those in the
+  /// functions it calls.
+  PlanSizes plan_sizes(const Node& top)
+  {
+    Node policy = top / RegoBundle / Policy;
+    std::map<Location, Node> functions;
+    for (Node function : *(policy / FunctionSeq))
+    {
+      functions[(function / Name)->location()] = function;
+    }
+
+    PlanSizes sizes;
+    for (Node plan : *(policy / PlanSeq))
+    {
+      std::set<Location> visited;
+      Nodes frontier = {plan / BlockSeq};
+      std::size_t size = 0;
+      while (!frontier.empty())
+      {
+        Node current = frontier.back();
+        frontier.pop_back();
+        if (current == Block)
+        {
+          size += current->size();
+        }
+
+        if (current == CallStmt)
+        {
+          Location name = (current / Func)->location();
+          auto it = functions.find(name);
+          if (it != functions.end() && visited.insert(name).second)
+          {
+            frontier.push_back(it->second / BlockSeq);
+          }
+
+          continue;
+        }
+
+        frontier.insert(frontier.end(), current->begin(), current->end());
+      }
+
+      sizes[(plan / Name)->location()] = size;
+    }
+
+    return sizes;
+  }
+
+  /// Statements which can be moved out of a scan body when they only read
+  /// locals which do not change during the scan.
+  const std::initializer_list<Token> HoistableStmts = {
+    AssignIntStmt,
+    AssignVarStmt,
+    CallStmt,
+    DotStmt,
+    EqualStmt,
+    IsArrayStmt,
+    IsDefinedStmt,
+    IsObjectStmt,
+    IsSetStmt,
+    IsUndefinedStmt,
+    MakeNullStmt,
+    MakeNumberIntStmt,
+    MakeNumberRefStmt,
+    NotEqualStmt};
+
+  /// Statements which have no effect outside of the scan body they are in,
+  /// other than through the locals they write.
+  const std::initializer_list<Token> SilentStmts = {
+    AssignIntStmt,
+    AssignVarStmt,
+    DotStmt,
+    EqualStmt,
+    IsArrayStmt,
+    IsDefinedStmt,
+    IsObjectStmt,
+    IsSetStmt,
+    IsUndefinedStmt,
+    MakeArrayStmt,
+    MakeNullStmt,
+    MakeNumberIntStmt,
+    MakeNumberRefStmt,
+    MakeObjectStmt,
+    MakeSetStmt,
+    NotEqualStmt,
+    ResetLocalStmt};
+
+  /// Whether the statements of a function block can neither raise an error
+  /// nor have an effect outside the function, given the functions in `total`
+  /// which are already known to be so.
+  bool is_total_block(
+    const Node& block,
+    const LocalUses& uses,
+    bool in_scan,
+    const std::set<Location>& total)
+  {
+    for (const Node& stmt : *block)
+    {
+      // built-ins may raise errors, have effects (e.g. print) or be
+      // non-deterministic
+      if (stmt == CallStmt && !total.contains((stmt / Func)->location()))
+      {
+        return false;
+      }
+
+      if (stmt->in({CallDynamicStmt, ObjectInsertOnceStmt}))
+      {
+        return false;
+      }
+
+      // a conflict needs a second write of the local in the same call
+      if (
+        stmt == AssignVarOnceStmt &&
+        (in_scan || uses.write_count(to_size(stmt->back())) != 1))
+      {
+        return false;
+      }
+
+      for (const Node& inner : nested_blocks(stmt))
+      {
+        if (!is_total_block(inner, uses, in_scan || stmt == ScanStmt, total))
+        {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  /// The functions of the bundle which can neither raise an error nor have
+  /// an effect outside their result, including through the functions they
+  /// call. Functions which call each other are never included.
+  std::set<Location> total_functions(const Node& policy)
+  {
+    std::set<Location> total;
+    bool changed = true;
+    while (changed)
+    {
+      changed = false;
+      for (Node function : *(policy / FunctionSeq))
+      {
+        Location name = (function / Name)->location();
+        if (total.contains(name))
+        {
+          continue;
+        }
+
+        LocalUses uses;
+        for (Node block : *(function / BlockSeq))
+        {
+          uses.add_block(block);
+        }
+
+        bool is_total = true;
+        for (Node block : *(function / BlockSeq))
+        {
+          is_total = is_total && is_total_block(block, uses, false, total);
+        }
+
+        if (is_total)
+        {
+          total.insert(name);
+          changed = true;
+        }
+      }
+    }
+
+    return total;
+  }
+
+  struct Hoister
+  {
+    /// The uses of each local in the plan or function
+    LocalUses uses;
+    /// The functions which can be called from a moved statement (see
+    /// total_functions)
+    std::set<Location> functions;
+    /// The next unused local
+    std::size_t next_local;
+
+    /// Whether the locals written by a statement in the scan body are only
+    /// read inside the body.
+    bool is_confined(const Node& stmt, const LocalUses& body_uses) const
+    {
+      for (std::size_t local : direct_writes(stmt))
+      {
+        if (uses.read_count(local) != body_uses.read_count(local))
+        {
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    /// Moves the statements of scan bodies which give the same result for
+    /// every item out of the scan, so that they run once. The statements
+    /// moved out of a body are those which only read locals which the scan
+    /// does not change, and whose targets are only written by them and only
+    /// read later in the body.
+    ///
+    /// A moved statement which can fail is only moved if the statements
+    /// before it in the body have no effect outside the body, as in that case
+    /// its failure means that no item has any effect. The moved statements
+    /// are then run in a block which sets a flag local when they all succeed,
+    /// and the body starts by checking the flag.
+    ///
+    /// The moved statements run even when the scan has no items, or when the
+    /// statements before them fail for every item, so none of them may raise
+    /// an error: calls are only moved if they are to total functions.
+    std::size_t hoist(Node block)
+    {
+      std::size_t changes = 0;
+      bool changed = false;
+      Nodes stmts;
+      for (Node stmt : *block)
+      {
+        for (Node& inner : nested_blocks(stmt))
+        {
+          changes += hoist(inner);
+        }
+
+        if (stmt != ScanStmt)
+        {
+          stmts.push_back(stmt);
+          continue;
+        }
+
+        Node body = stmt->back();
+        std::set<std::size_t> variant;
+        collect_writes(stmt, variant);
+        LocalUses body_uses;
+        body_uses.add_block(body);
+
+        Nodes hoisted;
+        Nodes kept;
+        std::set<std::size_t> read_before;
+        bool silent = true;
+        bool can_fail = false;
+        bool has_call = false;
+        for (Node inner : *body)
+        {
+          if (can_hoist(inner, variant, read_before, silent, body_uses))
+          {
+            hoisted.push_back(inner);
+            for (std::size_t local : direct_writes(inner))
+            {
+              variant.erase(local);
+            }
+
+            can_fail = can_fail || !inner->in(PureWriteStmts);
+            has_call = has_call || inner == CallStmt;
+            continue;
+          }
+
+          kept.push_back(inner);
+          silent = silent && inner->in(SilentStmts) &&
+            is_confined(inner, body_uses);
+          LocalUses inner_uses;
+          inner_uses.add(inner);
+          for (auto& [local, _] : inner_uses.reads)
+          {
+            read_before.insert(local);
+          }
+        }
+
+        // a single moved statement which can fail is replaced by the check of
+        // the flag, which only pays for itself if the statement is a call
+        if (hoisted.empty() || (can_fail && hoisted.size() == 1 && !has_call))
+        {
+          stmts.push_back(stmt);
+          continue;
+        }
+
+        body->erase(body->begin(), body->end());
+        if (can_fail)
+        {
+          std::string flag = std::to_string(next_local++);
+          stmts.push_back((ResetLocalStmt ^ stmt) << (LocalIndex ^ flag));
+          Node guard = Block << hoisted;
+          guard
+            << ((AssignVarStmt ^ stmt) << (Operand << (Boolean ^ "true"))
+                                       << (LocalIndex ^ flag));
+          stmts.push_back((BlockStmt ^ stmt) << (BlockSeq << guard));
+          kept.insert(
+            kept.begin(), (IsDefinedStmt ^ stmt) << (LocalIndex ^ flag));
+        }
+        else
+        {
+          stmts.insert(stmts.end(), hoisted.begin(), hoisted.end());
+        }
+
+        for (Node& inner : kept)
+        {
+          body->push_back(inner);
+        }
+
+        stmts.push_back(stmt);
+        changes += hoisted.size();
+        changed = true;
+      }
+
+      if (changed)
+      {
+        block->erase(block->begin(), block->end());
+        for (Node& stmt : stmts)
+        {
+          block->push_back(stmt);
+        }
+      }
+
+      return changes;
+    }
+
+    bool can_hoist(
+      const Node& stmt,
+      const std::set<std::size_t>& variant,
+      const std::set<std::size_t>& read_before,
+      bool silent,
+      const LocalUses& body_uses) const
+    {
+      if (!stmt->in(HoistableStmts))
+      {
+        return false;
+      }
+
+      if (
+        stmt == CallStmt &&
+        !functions.contains((stmt / Func)->location()))
+      {
+        return false;
+      }
+
+      if (!stmt->in(PureWriteStmts) && !silent)
+      {
+        return false;
+      }
+
+      std::vector<std::size_t> reads;
+      collect_reads(stmt, reads);
+      for (std::size_t local : reads)
+      {
+        if (variant.contains(local))
+        {
+          return false;
+        }
+      }
+
+      for (std::size_t local : direct_writes(stmt))
+      {
+        if (uses.write_count(local) != 1 || read_before.contains(local))
+        {
+          return false;
+        }
+      }
+
+      return is_confined(stmt, body_uses);
+    }
+  };
+
+  /// The largest local index used in the policy.
+  std::size_t max_local(const Node& node)
+  {
+    if (node == LocalIndex)
+    {
+      return to_size(node);
+    }
+
+    std::size_t result = 0;
+    for (const Node& child : *node)
+    {
+      result = std::max(result, max_local(child));
+    }
+
+    return result;
+  }
+
+  /// Moves statements which do not depend on the scan out of scan bodies.
+  PassDef hoist_invariants(std::shared_ptr<PlanSizes> sizes)
+  {
+    PassDef pass = {
+      "hoist_invariants", wf_bundle, dir::topdown | dir::once, {}};
+
+    pass.pre([sizes](Node top) {
+      *sizes = plan_sizes(top);
+      Node policy = top / RegoBundle / Policy;
+      std::set<Location> functions = total_functions(policy);
+      std::size_t next_local = max_local(policy) + 1;
+      std::size_t changes = 0;
+      for (Node body : bodies(top))
+      {
+        Hoister hoister{{}, functions, next_local};
+        for (Node block : *(body / BlockSeq))
+        {
+          hoister.uses.add_block(block);
+        }
+
+        for (Node block : *(body / BlockSeq))
+        {
+          changes += hoister.hoist(block);
+        }
+
+        next_local = hoister.next_local;
+      }
+
+      return changes;
+    });
+
+    return pass;
+  }
+
+  /// Replaces a Dot statement with a copy of the target of an earlier Dot
+  /// statement with the same source and key, and removes IsDefined checks of
+  /// locals which are known to be defined.
+  PassDef redundant_stmts()
+  {
+    PassDef pass = {
+      "redundant_stmts", wf_bundle, dir::topdown | dir::once, {}};
+
+    pass.pre([](Node top) {
+      return rewrite_bodies(
+        top, [](Node stmt, const Facts& facts, std::size_t& changes) -> Node {
+          if (
+            stmt == IsDefinedStmt &&
+            facts.defined.contains(to_size(stmt / Src)))
+          {
+            changes++;
+            return nullptr;
+          }
+
+          if (stmt != DotStmt)
+          {
+            return stmt;
+          }
+
+          std::size_t target = to_size(stmt / Target);
+          auto earlier = facts.dot(stmt / Src, stmt / Key);
+          if (!earlier.has_value())
+          {
+            return stmt;
+          }
+
+          changes++;
+          if (*earlier == target)
+          {
+            return nullptr;
+          }
+
+          return (AssignVarStmt ^ stmt)
+            << (Operand << (LocalIndex ^ std::to_string(*earlier)))
+            << (stmt / Target);
+        });
+    });
+
+    return pass;
+  }
+
+  /// Replaces reads of a local which holds a copy of another local or of a
+  /// constant with reads of the original, and removes assignments of a value
+  /// the target already holds.
+  PassDef copy_propagation()
+  {
+    PassDef pass = {
+      "copy_propagation", wf_bundle, dir::topdown | dir::once, {}};
+
+    pass.pre([](Node top) {
+      return rewrite_bodies(
+        top, [](Node stmt, const Facts& facts, std::size_t& changes) -> Node {
+          auto propagate = [&](Node operand) {
+            Node value = operand->front();
+            if (value != LocalIndex)
+            {
+              return;
+            }
+
+            auto copy = facts.copy(to_size(value));
+            if (copy.has_value())
+            {
+              operand->replace(value, (*copy)->clone());
+              changes++;
+            }
+          };
+
+          for (Node child : *stmt)
+          {
+            if (child == Operand)
+            {
+              propagate(child);
+            }
+            else if (child == OperandSeq)
+            {
+              for (Node op : *child)
+              {
+                propagate(op);
+              }
+            }
+          }
+
+          if (stmt->in(LocalReadStmts))
+          {
+            Nodes locals = {stmt->front()};
+            if (stmt == ObjectMergeStmt)
+            {
+              locals.push_back(stmt / Rhs);
+            }
+
+            for (Node local : locals)
+            {
+              auto copy = facts.copy(to_size(local));
+              if (copy.has_value() && *copy == LocalIndex)
+              {
+                stmt->replace(local, (*copy)->clone());
+                changes++;
+              }
+            }
+          }
+
+          if (stmt == AssignVarStmt)
+          {
+            Node source = (stmt / Src)->front();
+            std::size_t target = to_size(stmt / Target);
+            auto copy = facts.copy(target);
+            if (
+              is_local(stmt / Src, target) ||
+              (copy.has_value() && same_value(*copy, source)))
+            {
+              changes++;
+              return nullptr;
+            }
+          }
+
+          return stmt;
+        });
+    });
+
+    return pass;
+  }
+
+  /// Removes statements which cannot fail and which only write locals that
+  /// are never read.
+  PassDef dead_locals()
+  {
+    PassDef pass = {"dead_locals", wf_bundle, dir::topdown | dir::once, {}};
+
+    pass.pre([](Node top) {
+      std::size_t changes = 0;
+      for (Node body : bodies(top))
+      {
+        std::set<std::size_t> live = {0, 1};
+        if (body == Function)
+        {
+          for (Node param : *(body / ParameterSeq))
+          {
+            live.insert(to_size(param));
+          }
+
+          live.insert(to_size(body / rego::Return));
+        }
+
+        std::size_t removed;
+        do
+        {
+          std::map<std::size_t, std::size_t> reads;
+          Nodes frontier(
+            (body / BlockSeq)->begin(), (body / BlockSeq)->end());
+          while (!frontier.empty())
+          {
+            Node block = frontier.back();
+            frontier.pop_back();
+            for (const Node& stmt : *block)
+            {
+              std::vector<std::size_t> locals;
+              collect_reads(stmt, locals);
+              for (std::size_t local : locals)
+              {
+                reads[local]++;
+              }
+
+              Nodes inner = nested_blocks(stmt);
+              frontier.insert(frontier.end(), inner.begin(), inner.end());
+            }
+          }
+
+          auto is_dead = [&](Node stmt, const Facts&, std::size_t& count) {
+            if (!stmt->in(PureWriteStmts))
+            {
+              return stmt;
+            }
+
+            std::size_t target = to_size(stmt->back());
+            if (live.contains(target) || reads.contains(target))
+            {
+              return stmt;
+            }
+
+            count++;
+            return Node();
+          };
+
+          removed = 0;
+          for (Node block : *(body / BlockSeq))
+          {
+            removed += rewrite_block(block, Facts::initial(), is_dead);
+          }
+
+          changes += removed;
+        } while (removed > 0);
+      }
+
+      return changes;
+    });
+
+    return pass;
+  }
+
+  /// Whether every statement in the block always succeeds.
+  bool cannot_fail(const Node& block)
+  {
+    for (const Node& stmt : *block)
+    {
+      if (!stmt->in(PureWriteStmts))
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /// Removes empty blocks, and moves the statements of a BlockStmt with a
+  /// single block into the enclosing block when that cannot change which
+  /// statements run: either the statements cannot fail, or the BlockStmt is
+  /// the last statement of a block whose completion is not observed (the
+  /// blocks of a BlockStmt, a Scan body, or a function block).
+  std::size_t flatten_block(Node block, bool observed)
+  {
+    std::size_t changes = 0;
+    bool changed = false;
+    Nodes stmts;
+    for (auto it = block->begin(); it != block->end(); ++it)
+    {
+      Node stmt = *it;
+      if (stmt == NotStmt || stmt == WithStmt)
+      {
+        changes += flatten_block(stmt->back(), true);
+      }
+      else if (stmt == ScanStmt)
+      {
+        changes += flatten_block(stmt->back(), false);
+      }
+
+      if (stmt != BlockStmt)
+      {
+        stmts.push_back(stmt);
+        continue;
+      }
+
+      Node blockseq = stmt / Blocks;
+      Nodes blocks;
+      for (Node inner : *blockseq)
+      {
+        changes += flatten_block(inner, false);
+        if (!inner->empty())
+        {
+          blocks.push_back(inner);
+        }
+      }
+
+      if (blocks.size() < blockseq->size())
+      {
+        changes += blockseq->size() - blocks.size();
+        blockseq->erase(blockseq->begin(), blockseq->end());
+        for (Node& inner : blocks)
+        {
+          blockseq->push_back(inner);
+        }
+      }
+
+      if (blocks.empty())
+      {
+        changed = true;
+        continue;
+      }
+
+      if (blocks.size() > 1 || contains(stmt, {BreakStmt}))
+      {
+        stmts.push_back(stmt);
+        continue;
+      }
+
+      Node inner = blocks.front();
+      bool last = it + 1 == block->end();
+      if (inner->size() == 1 && inner->front() == BlockStmt)
+      {
+        // a BlockStmt whose only statement is another BlockStmt
+        blockseq->erase(blockseq->begin(), blockseq->end());
+        for (Node nested : *(inner->front() / Blocks))
+        {
+          blockseq->push_back(nested);
+        }
+
+        changes++;
+        stmts.push_back(stmt);
+        continue;
+      }
+
+      if (cannot_fail(inner) || (last && !observed))
+      {
+        stmts.insert(stmts.end(), inner->begin(), inner->end());
+        changed = true;
+        changes++;
+        continue;
+      }
+
+      stmts.push_back(stmt);
+    }
+
+    if (changed)
+    {
+      block->erase(block->begin(), block->end());
+      for (Node& stmt : stmts)
+      {
+        block->push_back(stmt);
+      }
+    }
+
+    return changes;
+  }
+
+  PassDef flatten_blocks(std::shared_ptr<PlanSizes> sizes)
+  {
+    PassDef pass = {"flatten_blocks", wf_bundle, dir::topdown | dir::once, {}};
+
+    pass.pre([](Node top) {
+      std::size_t changes = 0;
+      for (Node body : bodies(top))
+      {
+        // whether a plan block completes decides whether the next one runs
+        bool observed = body == Plan;
+        for (Node block : *(body / BlockSeq))
+        {
+          changes += flatten_block(block, observed);
+        }
+      }
+
+      return changes;
+    });
+
+    pass.post([sizes](Node top) {
+      for (auto& [name, after] : plan_sizes(top))
+      {
+        auto it = sizes->find(name);
+        if (it == sizes->end())
+        {
+          continue;
+        }
+
+        std::size_t before = it->second;
+        logging::Info() << "Plan " << name.view() << ": " << before << " -> "
+                        << after << " statements ("
+                        << (before > after ? before - after : 0)
+                        << " removed)";
+      }
+
+      return 0;
+    });
+
+    return pass;
+  }
+}
+
+namespace rego
+{
+  std::vector<Pass> optimize_bundle()
+  {
+    auto sizes = std::make_shared<PlanSizes>();
+    return {
+      hoist_invariants(sizes),
+      redundant_stmts(),
+      copy_propagation(),
+      dead_locals(),
+      flatten_blocks(sizes)};
+  }
+}
@@ -1,8 +1,14 @@
 #include "internal.hh"
 #include "trieste/json.h"
 
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
 #include <sstream>
 #include <string_view>
+#include <unordered_map>
 
 namespace
 {
@@ -98,10 +104,297 @@ namespace
       }
     }
   };
+
+  // Rank of each kind of term in Rego's total ordering. Composite
+  // covers anything without a defined place in that ordering.
+  enum class TermClass : std::uint8_t
+  {
+    Null,
+    False,
+    True,
+    Number,
+    String,
+    Array,
+    Object,
+    Set,
+    Composite
+  };
+
+  struct TermText
+  {
+    TermClass type;
+    std::string_view text;
+  };
+
+  Node unwrap_term(Node node)
+  {
+    while (node->in({Term, Scalar, DataTerm}))
+    {
+      node = node->front();
+    }
+
+    return node;
+  }
+
+  // Classifies a term and, for scalars, produces the same text that to_key()
+  // would (minus string quotes) without building a string. The canonical
+  // text of a Float is written into buf, which must outlive the returned
+  // view.
+  TermText term_text(const Node& node, std::array<char, 32>& buf)
+  {
+    if (node == Int)
+    {
+      return {TermClass::Number, node->location().view()};
+    }
+
+    if (node == Float)
+    {
+      // to_key() falls back to the literal text when std::stod fails
+      std::string_view view = node->location().view();
+      double value;
+      if (!parse_double(view, value))
+      {
+        return {TermClass::Number, view};
+      }
+
+      int size = std::snprintf(buf.data(), buf.size(), "%.16g", value);
+      if (size <= 0 || static_cast<std::size_t>(size) >= buf.size())
+      {
+        return {TermClass::Number, view};
+      }
+
+      return {TermClass::Number, std::string_view(buf.data(), size)};
+    }
+
+    if (node->in({JSONString, Key}))
+    {
+      std::string_view view = node->location().view();
+      if (is_quoted(view))
+      {
+        view = view.substr(1, view.size() - 2);
+      }
+
+      return {TermClass::String, view};
+    }
+
+    if (node == True)
+    {
+      return {TermClass::True, {}};
+    }
+
+    if (node == False)
+    {
+      return {TermClass::False, {}};
+    }
+
+    if (node == Null)
+    {
+      return {TermClass::Null, {}};
+    }
+
+    if (node->in({Array, DataArray}))
+    {
+      return {TermClass::Array, {}};
+    }
+
+    if (node->in({Object, DataObject}))
+    {
+      return {TermClass::Object, {}};
+    }
+
+    if (node->in({Set, DataSet}))
+    {
+      return {TermClass::Set, {}};
+    }
+
+    return {TermClass::Composite, {}};
+  }
+
+  std::size_t hash_combine(std::size_t seed, std::size_t value)
+  {
+    return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+  }
+
+  int compare_numbers(
+    const Node& lhs,
+    std::string_view lhs_text,
+    const Node& rhs,
+    std::string_view rhs_text)
+  {
+    if (lhs_text == rhs_text)
+    {
+      return 0;
+    }
+
+    int result = 0;
+    if (lhs == Int && rhs == Int)
+    {
+      std::int64_t lhs_value;
+      std::int64_t rhs_value;
+      auto lhs_end = lhs_text.data() + lhs_text.size();
+      auto rhs_end = rhs_text.data() + rhs_text.size();
+      auto [lhs_ptr, lhs_ec] =
+        std::from_chars(lhs_text.data(), lhs_end, lhs_value);
+      auto [rhs_ptr, rhs_ec] =
+        std::from_chars(rhs_text.data(), rhs_end, rhs_value);
+      if (
+        lhs_ec == std::errc() && lhs_ptr == lhs_end &&
+        rhs_ec == std::errc() && rhs_ptr == rhs_end)
+      {
+        result = (lhs_value > rhs_value) - (lhs_value < rhs_value);
+      }
+      else
+      {
+        BigInt lhs_int(lhs->location());
+        BigInt rhs_int(rhs->location());
+        result = (lhs_int > rhs_int) - (lhs_int < rhs_int);
+      }
+    }
+    else
+    {
+      double lhs_value;
+      double rhs_value;
+      if (
+        parse_double(lhs->location().view(), lhs_value) &&
+        parse_double(rhs->location().view(), rhs_value))
+      {
+        result = (lhs_value > rhs_value) - (lhs_value < rhs_value);
+      }
+    }
+
+    if (result != 0)
+    {
+      return result;
+    }
+
+    // Distinct values that are indistinguishable as doubles still need a
+    // stable order which agrees with term_equal().
+    return lhs_text.compare(rhs_text) < 0 ? -1 : 1;
+  }
+
+  Node item_key(const Node& item)
+  {
+    return item->front();
+  }
+
+  Node item_val(const Node& item)
+  {
+    return item->back();
+  }
+
+  // Members of a set, or items of an object ordered by key, so that two
+  // collections can be compared pairwise.
+  Nodes sorted_members(const Node& collection, bool is_object)
+  {
+    Nodes members(collection->begin(), collection->end());
+    std::sort(
+      members.begin(),
+      members.end(),
+      [is_object](const Node& lhs, const Node& rhs) {
+        if (is_object)
+        {
+          return term_compare(item_key(lhs), item_key(rhs)) < 0;
+        }
+
+        return term_compare(lhs, rhs) < 0;
+      });
+    return members;
+  }
+
+  // Whether every member (or object item) of lhs has an equal counterpart
+  // in rhs. Both collections must be the same size and free of duplicate
+  // members (or keys).
+  bool members_equal(const Node& lhs, const Node& rhs, bool is_object)
+  {
+    const std::size_t linear_limit = 16;
+    if (lhs->size() <= linear_limit)
+    {
+      for (const Node& lhs_member : *lhs)
+      {
+        bool found = false;
+        for (const Node& rhs_member : *rhs)
+        {
+          if (is_object)
+          {
+            if (term_equal(item_key(lhs_member), item_key(rhs_member)))
+            {
+              found = term_equal(item_val(lhs_member), item_val(rhs_member));
+              break;
+            }
+          }
+          else if (term_equal(lhs_member, rhs_member))
+          {
+            found = true;
+            break;
+          }
+        }
+
+        if (!found)
+        {
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    std::unordered_multimap<std::size_t, Node> index;
+    for (const Node& rhs_member : *rhs)
+    {
+      Node key = is_object ? item_key(rhs_member) : rhs_member;
+      index.emplace(term_hash(key), rhs_member);
+    }
+
+    for (const Node& lhs_member : *lhs)
+    {
+      Node key = is_object ? item_key(lhs_member) : lhs_member;
+      auto [begin, end] = index.equal_range(term_hash(key));
+      auto it = std::find_if(begin, end, [&](const auto& entry) {
+        Node rhs_key = is_object ? item_key(entry.second) : entry.second;
+        return term_equal(key, rhs_key);
+      });
+      if (it == end)
+      {
+        return false;
+      }
+
+      if (
+        is_object && !term_equal(item_val(lhs_member), item_val(it->second)))
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
 }
 
 namespace rego
 {
+  // Parses a number literal the way std::stod would, without allocating for
+  // literals of a typical length.
+  bool parse_double(std::string_view view, double& value)
+  {
+    char short_src[64];
+    std::string long_src;
+    const char* src = short_src;
+    if (view.size() < sizeof(short_src))
+    {
+      std::copy(view.begin(), view.end(), short_src);
+      short_src[view.size()] = '\0';
+    }
+    else
+    {
+      long_src = std::string(view);
+      src = long_src.c_str();
+    }
+
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtod(src, &end);
+    return end != src && errno != ERANGE;
+  }
+
   std::string to_key(
     const Node& node,
     SetFormat set_format,
@@ -357,4 +650,203 @@ namespace rego
 
     return buf.str();
   }
-}
\ No newline at end of file
+
+  std::size_t term_hash(const Node& node)
+  {
+    Node term = unwrap_term(node);
+    std::array<char, 32> buf;
+    TermText text = term_text(term, buf);
+    std::size_t hash = static_cast<std::size_t>(text.type);
+    switch (text.type)
+    {
+      case TermClass::Array:
+        for (const Node& child : *term)
+        {
+          hash = hash_combine(hash, term_hash(child));
+        }
+        break;
+
+      case TermClass::Object:
+      {
+        // Order-independent, as objects compare equal regardless of the
+        // order of their items.
+        std::size_t items = 0;
+        for (const Node& item : *term)
+        {
+          items += hash_combine(
+            term_hash(item_key(item)), term_hash(item_val(item)));
+        }
+        hash = hash_combine(hash, items);
+        break;
+      }
+
+      case TermClass::Set:
+      {
+        std::size_t members = 0;
+        for (const Node& member : *term)
+        {
+          members += term_hash(member);
+        }
+        hash = hash_combine(hash, members);
+        break;
+      }
+
+      case TermClass::Composite:
+        hash = hash_combine(hash, std::hash<std::string>()(to_key(term)));
+        break;
+
+      default:
+        hash = hash_combine(hash, std::hash<std::string_view>()(text.text));
+        break;
+    }
+
+    return hash;
+  }
+
+  bool term_equal(const Node& lhs, const Node& rhs)
+  {
+    Node lhs_term = unwrap_term(lhs);
+    Node rhs_term = unwrap_term(rhs);
+    if (lhs_term == rhs_term)
+    {
+      return true;
+    }
+
+    std::array<char, 32> lhs_buf;
+    std::array<char, 32> rhs_buf;
+    TermText lhs_text = term_text(lhs_term, lhs_buf);
+    TermText rhs_text = term_text(rhs_term, rhs_buf);
+    if (lhs_text.type != rhs_text.type)
+    {
+      return false;
+    }
+
+    switch (lhs_text.type)
+    {
+      case TermClass::Array:
+        if (lhs_term->size() != rhs_term->size())
+        {
+          return false;
+        }
+
+        for (std::size_t i = 0; i < lhs_term->size(); ++i)
+        {
+          if (!term_equal(lhs_term->at(i), rhs_term->at(i)))
+          {
+            return false;
+          }
+        }
+
+        return true;
+
+      case TermClass::Object:
+      case TermClass::Set:
+        if (lhs_term->size() != rhs_term->size())
+        {
+          return false;
+        }
+
+        return members_equal(
+          lhs_term, rhs_term, lhs_text.type == TermClass::Object);
+
+      case TermClass::Composite:
+        return to_key(lhs_term) == to_key(rhs_term);
+
+      default:
+        return lhs_text.text == rhs_text.text;
+    }
+  }
+
+  int term_compare(const Node& lhs, const Node& rhs)
+  {
+    Node lhs_term = unwrap_term(lhs);
+    Node rhs_term = unwrap_term(rhs);
+    if (lhs_term == rhs_term)
+    {
+      return 0;
+    }
+
+    std::array<char, 32> lhs_buf;
+    std::array<char, 32> rhs_buf;
+    TermText lhs_text = term_text(lhs_term, lhs_buf);
+    TermText rhs_text = term_text(rhs_term, rhs_buf);
+    if (lhs_text.type != rhs_text.type)
+    {
+      return lhs_text.type < rhs_text.type ? -1 : 1;
+    }
+
+    switch (lhs_text.type)
+    {
+      case TermClass::Number:
+        return compare_numbers(
+          lhs_term, lhs_text.text, rhs_term, rhs_text.text);
+
+      case TermClass::String:
+      {
+        int result = lhs_text.text.compare(rhs_text.text);
+        return (result > 0) - (result < 0);
+      }
+
+      case TermClass::Array:
+      {
+        std::size_t size = std::min(lhs_term->size(), rhs_term->size());
+        for (std::size_t i = 0; i < size; ++i)
+        {
+          int result = term_compare(lhs_term->at(i), rhs_term->at(i));
+          if (result != 0)
+          {
+            return result;
+          }
+        }
+
+        return (lhs_term->size() > rhs_term->size()) -
+          (lhs_term->size() < rhs_term->size());
+      }
+
+      case TermClass::Object:
+      case TermClass::Set:
+      {
+        bool is_object = lhs_text.type == TermClass::Object;
+        Nodes lhs_members = sorted_members(lhs_term, is_object);
+        Nodes rhs_members = sorted_members(rhs_term, is_object);
+        std::size_t size = std::min(lhs_members.size(), rhs_members.size());
+        for (std::size_t i = 0; i < size; ++i)
+        {
+          int result;
+          if (is_object)
+          {
+            result = term_compare(
+              item_key(lhs_members[i]), item_key(rhs_members[i]));
+            if (result == 0)
+            {
+              result = term_compare(
+                item_val(lhs_members[i]), item_val(rhs_members[i]));
+            }
+          }
+          else
+          {
+            result = term_compare(lhs_members[i], rhs_members[i]);
+          }
+
+          if (result != 0)
+          {
+            return result;
+          }
+        }
+
+        return (lhs_members.size() > rhs_members.size()) -
+          (lhs_members.size() < rhs_members.size());
+      }
+
+      case TermClass::Composite:
+      {
+        int result = to_key(lhs_term).compare(to_key(rhs_term));
+        return (result > 0) - (result < 0);
+      }
+
+      default:
+        // null and the booleans carry no further value
+        return 0;
+    }
+  }
+}
@@ -2,6 +2,8 @@
 
 #include "rego.hh"
 
+#include <array>
+#include <charconv>
 #include <cstdio>
 #include <initializer_list>
 #include <trieste/json.h>
@@ -98,7 +100,25 @@ namespace
 
   double get_double(const Node& node)
   {
-    return std::stod(to_key(node));
+    double value;
+    if (!parse_double(node->location().view(), value))
+    {
+      throw std::out_of_range("Number cannot be represented as a double");
+    }
+
+    if (node == Float)
+    {
+      // Floats are read back from their key, which has 16 significant digits,
+      // so the same rounding is applied here (without building the key).
+      std::array<char, 32> buf;
+      int size = std::snprintf(buf.data(), buf.size(), "%.16g", value);
+      if (size > 0 && static_cast<std::size_t>(size) < buf.size())
+      {
+        parse_double(std::string_view(buf.data(), size), value);
+      }
+    }
+
+    return value;
   }
 
   bool refarg_is_varref(const Node& refarg)
@@ -245,6 +265,26 @@ namespace rego
     return ::get_double(node);
   }
 
+  std::optional<std::int64_t> try_get_int64(const Node& node)
+  {
+    auto maybe_int = unwrap(node, Int);
+    if (!maybe_int.success)
+    {
+      return std::nullopt;
+    }
+
+    std::string_view view = maybe_int.node->location().view();
+    const char* end = view.data() + view.size();
+    std::int64_t value;
+    auto [ptr, ec] = std::from_chars(view.data(), end, value);
+    if (ec != std::errc() || ptr != end)
+    {
+      return std::nullopt;
+    }
+
+    return value;
+  }
+
   std::optional<BigInt> try_get_int(const Node& node)
   {
     auto maybe_int = unwrap(node, {Int, Float});
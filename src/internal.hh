@@ -8,6 +8,8 @@
 #include <chrono>
 #include <limits>
 #include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace rego
 {
@@ -44,10 +46,6 @@ namespace rego
     static Node membership(
       const Node& index, const Node& item, const Node& itemseq);
     static Node membership(const Node& item, const Node& itemseq);
-    static std::vector<std::string> array_find(
-      const Node& array, const std::string& search);
-    static std::vector<std::string> object_find(
-      const Node& object, const std::string& search);
     static Node to_term(const Node& value);
   };
 
@@ -269,10 +267,40 @@ namespace rego
   bool is_falsy(const Node& node);
   bool is_truthy(const Node& node);
   Node to_constant_term(Node expr);
+  bool parse_double(std::string_view view, double& value);
   std::string strip_quotes(const std::string_view& str);
   std::string add_quotes(const std::string_view& str);
   std::string type_name(const Node& node, bool specify_number = false);
 
+  struct TermHash
+  {
+    std::size_t operator()(const Node& node) const
+    {
+      return term_hash(node);
+    }
+  };
+
+  struct TermEqual
+  {
+    bool operator()(const Node& lhs, const Node& rhs) const
+    {
+      return term_equal(lhs, rhs);
+    }
+  };
+
+  struct TermLess
+  {
+    bool operator()(const Node& lhs, const Node& rhs) const
+    {
+      return term_compare(lhs, rhs) < 0;
+    }
+  };
+
+  using TermSet = std::unordered_set<Node, TermHash, TermEqual>;
+
+  template <typename T>
+  using TermMap = std::unordered_map<Node, T, TermHash, TermEqual>;
+
   inline bool is_quoted(const std::string_view& str)
   {
     return str.size() >= 2 && str.front() == str.back() && str.front() == '"';
@@ -396,6 +424,9 @@ namespace rego
   Node ref_to_opblock(Node call);
   Node term_to_opblock(Node term);
 
+  // optimization passes over a bundle
+  std::vector<Pass> optimize_bundle();
+
   class ActionMetrics
   {
   public:
@@ -56,7 +56,9 @@ namespace rego
     m_debug_path(""),
     m_debug_enabled(false),
     m_wf_check_enabled(false),
+    m_optimize_enabled(false),
     m_builtins(BuiltInsDef::create()),
+    m_thread_pool_threads(0),
     m_data_count(0),
     m_log_level(LogLevel::Output)
   {}
@@ -122,7 +124,8 @@ namespace rego
   {
     if (m_bundle == nullptr)
     {
-      m_bundle = std::make_unique<Rewriter>(rego_to_bundle(m_builtins));
+      m_bundle = std::make_unique<Rewriter>(
+        rego_to_bundle(m_builtins, m_optimize_enabled));
     }
 
     return m_bundle->debug_enabled(m_debug_enabled)
@@ -146,7 +149,8 @@ namespace rego
   {
     if (m_read_bundle == nullptr)
     {
-      m_read_bundle = std::make_unique<Rewriter>(json_to_bundle());
+      m_read_bundle =
+        std::make_unique<Rewriter>(json_to_bundle(m_optimize_enabled));
     }
 
     return m_read_bundle->debug_enabled(m_debug_enabled)
@@ -356,6 +360,11 @@ namespace rego
     return nullptr;
   }
 
+  const Node& Interpreter::input() const
+  {
+    return m_input;
+  }
+
   Node Interpreter::set_query(const std::string& query)
   {
     auto loglevel = ::log_level(m_log_level);
@@ -459,6 +468,191 @@ namespace rego
     }
   }
 
+  Node Interpreter::query_bundle()
+  {
+    auto loglevel = ::log_level(m_log_level);
+    WFContext context(wf_bundle);
+    try
+    {
+      return m_vm.run_query(m_input);
+    }
+    catch (const std::exception& e)
+    {
+      return err(m_input, e.what());
+    }
+  }
+
+  Node Interpreter::query_bundle(const std::string& entrypoint)
+  {
+    auto loglevel = ::log_level(m_log_level);
+    WFContext context(wf_bundle);
+    try
+    {
+      return m_vm.run_entrypoint({entrypoint}, m_input);
+    }
+    catch (const std::exception& e)
+    {
+      return err(m_input, e.what());
+    }
+  }
+
+  Nodes Interpreter::query_bundle_batch(
+    const Bundle& bundle,
+    const std::string& entrypoint,
+    std::span<const Node> inputs,
+    ThreadPool& pool)
+  {
+    auto loglevel = ::log_level(m_log_level);
+    WFContext context(wf_bundle);
+    try
+    {
+      return m_vm.bundle(bundle).builtins(m_builtins).run_entrypoint_batch(
+        {entrypoint}, inputs, pool);
+    }
+    catch (const std::exception& e)
+    {
+      return Nodes(inputs.size(), err(m_input, e.what()));
+    }
+  }
+
+  ThreadPool& Interpreter::thread_pool(std::size_t num_threads)
+  {
+    if (m_thread_pool == nullptr || m_thread_pool_threads != num_threads)
+    {
+      // the old workers are joined before the new ones start
+      m_thread_pool.reset();
+      m_thread_pool = std::make_unique<ThreadPool>(num_threads);
+      m_thread_pool_threads = num_threads;
+    }
+
+    return *m_thread_pool;
+  }
+
+  PreparedQuery Interpreter::prepare()
+  {
+    Node result = build();
+    if (result == ErrorSeq)
+    {
+      return std::make_shared<PreparedQueryDef>(result);
+    }
+
+    auto loglevel = ::log_level(m_log_level);
+    WFContext context(wf_bundle);
+    try
+    {
+      auto query = std::make_shared<PreparedQueryDef>(
+        BundleDef::from_node(result), m_builtins);
+      query->m_vm.stmt_limit(m_vm.stmt_limit())
+        .max_call_depth(m_vm.max_call_depth())
+        .max_block_depth(m_vm.max_block_depth())
+        .memo_limit(m_vm.memo_limit());
+      return query;
+    }
+    catch (const std::exception& e)
+    {
+      return std::make_shared<PreparedQueryDef>(
+        ErrorSeq << err(result, e.what()));
+    }
+  }
+
+  PreparedQueryDef::PreparedQueryDef(Bundle bundle, BuiltIns builtins)
+  {
+    m_vm.builtins(builtins).bundle(bundle);
+  }
+
+  PreparedQueryDef::PreparedQueryDef(Node errors) : m_errors(errors) {}
+
+  bool PreparedQueryDef::ok() const
+  {
+    return m_errors == nullptr;
+  }
+
+  Node PreparedQueryDef::errors() const
+  {
+    return m_errors;
+  }
+
+  Bundle PreparedQueryDef::bundle() const
+  {
+    if (!ok())
+    {
+      return nullptr;
+    }
+
+    return m_vm.bundle();
+  }
+
+  Node PreparedQueryDef::to_input(const Node& input) const
+  {
+    // JSON ASTs are not accepted here, as converting them requires a
+    // rewriter, which cannot be shared between threads.
+    if (input == nullptr)
+    {
+      return Input << Undefined;
+    }
+
+    if (input->in({Term, Object, Array, Set, Scalar}))
+    {
+      return Input << Resolver::to_term(input);
+    }
+
+    if (input == Input)
+    {
+      return input;
+    }
+
+    return nullptr;
+  }
+
+  Node PreparedQueryDef::eval(const Node& input) const
+  {
+    if (!ok())
+    {
+      return m_errors;
+    }
+
+    Node input_node = to_input(input);
+    if (input_node == nullptr)
+    {
+      return err(input, "Invalid input node");
+    }
+
+    WFContext context(wf_bundle);
+    try
+    {
+      return m_vm.run_query(input_node);
+    }
+    catch (const std::exception& e)
+    {
+      return err(input_node, e.what());
+    }
+  }
+
+  Node PreparedQueryDef::eval(
+    const std::string& entrypoint, const Node& input) const
+  {
+    if (!ok())
+    {
+      return m_errors;
+    }
+
+    Node input_node = to_input(input);
+    if (input_node == nullptr)
+    {
+      return err(input, "Invalid input node");
+    }
+
+    WFContext context(wf_bundle);
+    try
+    {
+      return m_vm.run_entrypoint({entrypoint}, input_node);
+    }
+    catch (const std::exception& e)
+    {
+      return err(input_node, e.what());
+    }
+  }
+
   std::string Interpreter::query()
   {
     return output_to_string(query_node());
@@ -573,6 +767,24 @@ namespace rego
     return m_wf_check_enabled;
   }
 
+  Interpreter& Interpreter::optimize_enabled(bool enabled)
+  {
+    if (enabled != m_optimize_enabled)
+    {
+      // the rewriters are built with (or without) the optimization passes
+      m_bundle.reset();
+      m_read_bundle.reset();
+    }
+
+    m_optimize_enabled = enabled;
+    return *this;
+  }
+
+  bool Interpreter::optimize_enabled() const
+  {
+    return m_optimize_enabled;
+  }
+
   BuiltIns Interpreter::builtins() const
   {
     return m_builtins;
@@ -781,4 +993,15 @@ namespace rego
     m_vm.max_block_depth(depth);
     return *this;
   }
+
+  size_t Interpreter::memo_limit() const
+  {
+    return m_vm.memo_limit();
+  }
+
+  Interpreter& Interpreter::memo_limit(size_t limit)
+  {
+    m_vm.memo_limit(limit);
+    return *this;
+  }
 }
@@ -111,6 +111,37 @@ namespace rego
       return REGO_ERROR;
     }
   };
+
+  struct regoPreparedQuery
+  {
+    PreparedQuery query;
+
+    template<typename F>
+    Node eval(::regoInput* input, F&& fn)
+    {
+      Node input_node = Input << Undefined;
+      if (input != nullptr)
+      {
+        regoInput* ri = reinterpret_cast<regoInput*>(input);
+        if (ri->stack.empty() || ri->status != REGO_OK)
+        {
+          return err(
+            NodeDef::create(Input), "Input is empty or in error state");
+        }
+
+        input_node = Input << Resolver::to_term(ri->stack.back()->clone());
+      }
+
+      try
+      {
+        return fn(input_node);
+      }
+      catch (const std::exception& e)
+      {
+        return err(input_node, e.what());
+      }
+    }
+  };
 }
 
 extern "C"
@@ -889,6 +920,146 @@ extern "C"
     }
   }
 
+  regoEnum regoBundleQueryEntrypointBatch(
+    regoInterpreter* rego,
+    regoBundle* bundle,
+    const char* entrypoint,
+    regoInput** inputs,
+    regoSize count,
+    regoSize num_threads,
+    regoOutput** outputs)
+  {
+    regoEnum err = rego::check_c_str(rego, entrypoint, "entrypoint");
+    if (err != REGO_OK)
+    {
+      return err;
+    }
+
+    if (count > 0 && (inputs == nullptr || outputs == nullptr))
+    {
+      rego::setError(rego, "inputs and outputs must not be null");
+      return REGO_ERROR;
+    }
+
+    logging::Debug() << "regoBundleQueryEntrypointBatch: rego(" << rego
+                     << ") bundle(" << bundle << ") " << entrypoint << " x"
+                     << count;
+    try
+    {
+      rego::regoBundle* rb = reinterpret_cast<rego::regoBundle*>(bundle);
+      if (rb->node_to_bundle(rego) != REGO_OK)
+      {
+        return REGO_ERROR;
+      }
+
+      rego::Nodes input_nodes;
+      for (regoSize i = 0; i < count; ++i)
+      {
+        rego::regoInput* ri = reinterpret_cast<rego::regoInput*>(inputs[i]);
+        if (ri == nullptr || ri->stack.empty() || ri->status != REGO_OK)
+        {
+          rego::setError(
+            rego, "Input " + std::to_string(i) + " is empty or in error");
+          return REGO_ERROR;
+        }
+
+        input_nodes.push_back(
+          rego::Input << rego::Resolver::to_term(ri->stack.back()->clone()));
+      }
+
+      auto interpreter = reinterpret_cast<rego::Interpreter*>(rego);
+      // the pool is kept by the interpreter, so that repeated batches do not
+      // start new threads
+      rego::Nodes results = interpreter->query_bundle_batch(
+        rb->bundle,
+        entrypoint,
+        input_nodes,
+        interpreter->thread_pool(num_threads));
+      for (regoSize i = 0; i < count; ++i)
+      {
+        rego::regoOutput* output = new rego::regoOutput{results[i]};
+        outputs[i] = reinterpret_cast<regoOutput*>(output);
+      }
+
+      return REGO_OK;
+    }
+    catch (const std::exception& e)
+    {
+      rego::setError(rego, e.what());
+      return REGO_ERROR;
+    }
+  }
+
+  regoPreparedQuery* regoPrepare(regoInterpreter* rego)
+  {
+    if (rego == nullptr)
+    {
+      return nullptr;
+    }
+
+    logging::Debug() << "regoPrepare";
+    try
+    {
+      rego::PreparedQuery query =
+        reinterpret_cast<rego::Interpreter*>(rego)->prepare();
+      if (!query->ok())
+      {
+        ok_or_error(query->errors());
+      }
+
+      rego::regoPreparedQuery* pq = new rego::regoPreparedQuery{query};
+      auto ptr = reinterpret_cast<regoPreparedQuery*>(pq);
+      logging::Debug() << "regoPrepare output: " << ptr;
+      return ptr;
+    }
+    catch (const std::exception& e)
+    {
+      rego::setError(rego, e.what());
+      return nullptr;
+    }
+  }
+
+  regoOutput* regoPreparedQueryEval(regoPreparedQuery* query, regoInput* input)
+  {
+    if (query == nullptr)
+    {
+      return nullptr;
+    }
+
+    logging::Debug() << "regoPreparedQueryEval: query(" << query << ") input("
+                     << input << ")";
+    auto pq = reinterpret_cast<rego::regoPreparedQuery*>(query);
+    rego::Node result = pq->eval(input, [&](const rego::Node& input_node) {
+      return pq->query->eval(input_node);
+    });
+    rego::regoOutput* output = new rego::regoOutput{result};
+    return reinterpret_cast<regoOutput*>(output);
+  }
+
+  regoOutput* regoPreparedQueryEvalEntrypoint(
+    regoPreparedQuery* query, const char* entrypoint, regoInput* input)
+  {
+    if (query == nullptr || entrypoint == nullptr)
+    {
+      return nullptr;
+    }
+
+    logging::Debug() << "regoPreparedQueryEvalEntrypoint: query(" << query
+                     << ") " << entrypoint << " input(" << input << ")";
+    auto pq = reinterpret_cast<rego::regoPreparedQuery*>(query);
+    rego::Node result = pq->eval(input, [&](const rego::Node& input_node) {
+      return pq->query->eval(entrypoint, input_node);
+    });
+    rego::regoOutput* output = new rego::regoOutput{result};
+    return reinterpret_cast<regoOutput*>(output);
+  }
+
+  void regoFreePreparedQuery(regoPreparedQuery* query)
+  {
+    logging::Debug() << "regoFreePreparedQuery: " << query;
+    delete reinterpret_cast<rego::regoPreparedQuery*>(query);
+  }
+
   void regoFreeBundle(regoBundle* bundle)
   {
     logging::Debug() << "regoFreeBundle: " << bundle;
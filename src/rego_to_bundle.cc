@@ -6201,22 +6201,27 @@ namespace
 
 namespace rego
 {
-  Rewriter rego_to_bundle(BuiltIns builtins)
+  Rewriter rego_to_bundle(BuiltIns builtins, bool optimize)
   {
-    return {
-      "rego_to_bundle",
-      {refheads(),
-       rules(),
-       locals(),
-       implicit_scans(),
-       merge(),
-       unify(builtins),
-       unique_locals(),
-       expr_to_opblock(builtins),
-       lift_functions(builtins),
-       with_rules(),
-       add_plans(builtins),
-       index_strings_locals()},
-      wf_bundle_input};
+    std::vector<Pass> passes = {
+      refheads(),
+      rules(),
+      locals(),
+      implicit_scans(),
+      merge(),
+      unify(builtins),
+      unique_locals(),
+      expr_to_opblock(builtins),
+      lift_functions(builtins),
+      with_rules(),
+      add_plans(builtins),
+      index_strings_locals()};
+    if (optimize)
+    {
+      std::vector<Pass> optimizations = optimize_bundle();
+      passes.insert(passes.end(), optimizations.begin(), optimizations.end());
+    }
+
+    return {"rego_to_bundle", passes, wf_bundle_input};
   }
 }
\ No newline at end of file
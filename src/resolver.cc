@@ -1,6 +1,10 @@
 #include "internal.hh"
 #include "rego.hh"
 
+#include <array>
+#include <cstdio>
+#include <limits>
+
 namespace
 {
   using namespace rego;
@@ -51,6 +55,67 @@ namespace
     return Int ^ value.loc();
   }
 
+  // Applies an arithmetic operator to 64-bit integers. Returns null if the
+  // result might not fit in 64 bits, in which case the BigInt overload should
+  // be used instead.
+  Node do_arith(const Node& op, std::int64_t lhs, std::int64_t rhs)
+  {
+    using Limits = std::numeric_limits<std::int64_t>;
+    // operands below this magnitude cannot overflow when multiplied
+    const std::int64_t max_factor = std::int64_t(1) << 31;
+
+    std::int64_t value;
+    if (op->type() == Add)
+    {
+      if (
+        (rhs > 0 && lhs > Limits::max() - rhs) ||
+        (rhs < 0 && lhs < Limits::min() - rhs))
+      {
+        return nullptr;
+      }
+
+      value = lhs + rhs;
+    }
+    else if (op->type() == Subtract)
+    {
+      if (
+        (rhs < 0 && lhs > Limits::max() + rhs) ||
+        (rhs > 0 && lhs < Limits::min() + rhs))
+      {
+        return nullptr;
+      }
+
+      value = lhs - rhs;
+    }
+    else if (op->type() == Multiply)
+    {
+      if (
+        lhs <= -max_factor || lhs >= max_factor || rhs <= -max_factor ||
+        rhs >= max_factor)
+      {
+        return nullptr;
+      }
+
+      value = lhs * rhs;
+    }
+    else if (op->type() == Modulo)
+    {
+      if (rhs == 0)
+      {
+        return err(op, "modulo by zero", EvalBuiltInError);
+      }
+
+      // INT64_MIN % -1 overflows, although the result is 0
+      value = rhs == -1 ? 0 : lhs % rhs;
+    }
+    else
+    {
+      return nullptr;
+    }
+
+    return Int ^ std::to_string(value);
+  }
+
   Node do_arith(const Node& op, double lhs, double rhs)
   {
     double value;
@@ -84,10 +149,10 @@ namespace
       return err(op, "unsupported math operation");
     }
 
-    std::ostringstream oss;
-    oss << std::setprecision(std::numeric_limits<double>::max_digits10 - 1)
-        << std::noshowpoint << value;
-    return Float ^ oss.str();
+    // the same text as an ostream with a precision of max_digits10 - 1
+    std::array<char, 32> buf;
+    int size = std::snprintf(buf.data(), buf.size(), "%.16g", value);
+    return Float ^ std::string(buf.data(), size);
   }
 
   Node do_bool(const Node& op, BigInt lhs, BigInt rhs)
@@ -174,32 +239,33 @@ namespace
     }
   }
 
-  Node do_bool(const Node& op, const std::string& lhs, const std::string& rhs)
+  // Applies a comparison operator to the result of term_compare().
+  Node do_compare(const Node& op, int order)
   {
     bool value;
     if (op->type() == Equals)
     {
-      value = lhs == rhs;
+      value = order == 0;
     }
     else if (op->type() == NotEquals)
     {
-      value = lhs != rhs;
+      value = order != 0;
     }
     else if (op->type() == LessThan)
     {
-      value = lhs < rhs;
+      value = order < 0;
     }
     else if (op->type() == LessThanOrEquals)
     {
-      value = lhs <= rhs;
+      value = order <= 0;
     }
     else if (op->type() == GreaterThan)
     {
-      value = lhs > rhs;
+      value = order > 0;
     }
     else if (op->type() == GreaterThanOrEquals)
     {
-      value = lhs >= rhs;
+      value = order >= 0;
     }
     else
     {
@@ -319,6 +385,20 @@ namespace rego
     {
       Node lhs_number = maybe_lhs_number.node;
       Node rhs_number = maybe_rhs_number.node;
+      if (lhs_number == Int && rhs_number == Int)
+      {
+        auto lhs_int64 = try_get_int64(lhs_number);
+        auto rhs_int64 = try_get_int64(rhs_number);
+        if (lhs_int64.has_value() && rhs_int64.has_value())
+        {
+          Node result = do_arith(op, *lhs_int64, *rhs_int64);
+          if (result != nullptr)
+          {
+            return result;
+          }
+        }
+      }
+
       auto lhs_int = try_get_int(lhs_number);
       auto rhs_int = try_get_int(rhs_number);
       if (lhs_int.has_value() && rhs_int.has_value() && op->type() != Divide)
@@ -407,6 +487,14 @@ namespace rego
       Node rhs_number = maybe_rhs_number.node;
       if (lhs_number->type() == Int && rhs_number->type() == Int)
       {
+        auto lhs_int64 = try_get_int64(lhs_number);
+        auto rhs_int64 = try_get_int64(rhs_number);
+        if (lhs_int64.has_value() && rhs_int64.has_value())
+        {
+          return do_compare(
+            op, (*lhs_int64 > *rhs_int64) - (*lhs_int64 < *rhs_int64));
+        }
+
         return do_bool(op, get_int(lhs_number), get_int(rhs_number));
       }
       else
@@ -416,7 +504,13 @@ namespace rego
     }
     else
     {
-      return do_bool(op, to_key(lhs), to_key(rhs));
+      if (op->type() == Equals || op->type() == NotEquals)
+      {
+        // equality does not need the (more expensive) total ordering
+        return do_compare(op, term_equal(lhs, rhs) ? 0 : 1);
+      }
+
+      return do_compare(op, term_compare(lhs, rhs));
     }
   }
 
@@ -443,7 +537,7 @@ namespace rego
   Node Resolver::object(const Node& object_items)
   {
     Node object = NodeDef::create(Object);
-    std::map<std::string, Node> items;
+    TermMap<Node> items;
     for (std::size_t i = 0; i < object_items->size(); i += 2)
     {
       const Node& key = object_items->at(i);
@@ -458,13 +552,11 @@ namespace rego
         return val;
       }
 
-      std::string key_str = to_key(key);
-      if (items.contains(key_str))
+      auto it = items.find(key);
+      if (it != items.end())
       {
-        Node old_val = items[key_str] / Val;
-        auto lhs_str = to_key(old_val);
-        auto rhs_str = to_key(val);
-        if (lhs_str != rhs_str)
+        Node old_val = it->second / Val;
+        if (!term_equal(old_val, val))
         {
           return err(val, "object keys must be unique", EvalConflictError);
         }
@@ -475,12 +567,21 @@ namespace rego
       }
       else
       {
-        items[key_str] = ObjectItem << key << val;
+        items[key] = ObjectItem << key << val;
       }
     }
 
     // objects need to be created with sorted keys
-    for (auto [_, item] : items)
+    Nodes sorted;
+    for (auto& [_, item] : items)
+    {
+      sorted.push_back(item);
+    }
+
+    std::sort(sorted.begin(), sorted.end(), [](const Node& a, const Node& b) {
+      return term_compare(a->front(), b->front()) < 0;
+    });
+    for (auto& item : sorted)
     {
       object->push_back(item);
     }
@@ -510,7 +611,8 @@ namespace rego
 
   Node Resolver::set(const Node& set_members)
   {
-    std::map<std::string, Node> members;
+    TermSet seen;
+    Nodes members;
     for (Node member : *set_members)
     {
       if (member->type() == Expr)
@@ -518,15 +620,15 @@ namespace rego
         throw std::runtime_error("Not implemented");
       }
 
-      std::string repr = to_key(member);
-      if (!members.contains(repr))
+      if (seen.insert(member).second)
       {
-        members[repr] = to_term(member);
+        members.push_back(to_term(member));
       }
     }
 
+    std::sort(members.begin(), members.end(), TermLess());
     Node set = NodeDef::create(Set);
-    for (auto [_, member] : members)
+    for (auto& member : members)
     {
       set->push_back(member);
     }
@@ -547,15 +649,10 @@ namespace rego
 
     Node set = NodeDef::create(Set);
 
-    std::set<std::string> values;
-    for (auto term : *lhs)
-    {
-      values.insert(to_key(term));
-    }
-
+    TermSet values(lhs->begin(), lhs->end());
     for (auto term : *rhs)
     {
-      if (values.contains(to_key(term)))
+      if (values.contains(term))
       {
         set->push_back(term->clone());
       }
@@ -578,22 +675,26 @@ namespace rego
 
     Node set = NodeDef::create(Set);
 
-    std::map<std::string, Node> members;
+    TermSet seen;
+    Nodes members;
     for (auto term : *lhs)
     {
-      members[to_key(term)] = term;
+      if (seen.insert(term).second)
+      {
+        members.push_back(term);
+      }
     }
 
     for (auto term : *rhs)
     {
-      std::string key = to_key(term);
-      if (!members.contains(key))
+      if (seen.insert(term).second)
       {
-        members[key] = term;
+        members.push_back(term);
       }
     }
 
-    for (auto [_, member] : members)
+    std::sort(members.begin(), members.end(), TermLess());
+    for (auto& member : members)
     {
       set->push_back(member->clone());
     }
@@ -614,15 +715,10 @@ namespace rego
     }
 
     Node set = NodeDef::create(Set);
-    std::set<std::string> values;
-    for (auto term : *rhs)
-    {
-      values.insert(to_key(term));
-    }
-
+    TermSet values(rhs->begin(), rhs->end());
     for (auto term : *lhs)
     {
-      if (!values.contains(to_key(term)))
+      if (!values.contains(term))
       {
         set->push_back(term->clone());
       }
@@ -679,26 +775,28 @@ namespace rego
       items = items->front();
     }
 
-    std::vector<std::string> indices;
     if (items->type() == Array || items->type() == Set)
     {
-      indices = array_find(items, to_key(item));
+      for (std::size_t i = 0; i < items->size(); ++i)
+      {
+        if (
+          term_equal(items->at(i), item) &&
+          to_key(index) == std::to_string(i))
+        {
+          return True ^ "true";
+        }
+      }
     }
     else if (items->type() == Object)
     {
-      indices = object_find(items, to_key(item));
-    }
-    else
-    {
-      return False ^ "false";
-    }
-
-    std::string index_str = to_key(index);
-    for (auto& i : indices)
-    {
-      if (i == index_str)
+      for (auto& objectitem : *items)
       {
-        return True ^ "true";
+        if (
+          term_equal(objectitem / Val, item) &&
+          term_equal(objectitem / Key, index))
+        {
+          return True ^ "true";
+        }
       }
     }
 
@@ -713,56 +811,27 @@ namespace rego
       items = items->front();
     }
 
-    std::vector<std::string> indices;
     if (items->type() == Array || items->type() == Set)
     {
-      indices = array_find(items, to_key(item));
-    }
-    else if (items->type() == Object)
-    {
-      indices = object_find(items, to_key(item));
-    }
-    else
-    {
-      return False ^ "false";
-    }
-
-    if (indices.size() > 0)
-    {
-      return True ^ "True";
-    }
-
-    return False ^ "false";
-  }
-
-  std::vector<std::string> Resolver::array_find(
-    const Node& array, const std::string& search)
-  {
-    std::vector<std::string> indices;
-    for (std::size_t i = 0; i < array->size(); ++i)
-    {
-      Node item = array->at(i);
-      if (to_key(item) == search)
+      for (const Node& value : *items)
       {
-        indices.push_back(std::to_string(i));
+        if (term_equal(value, item))
+        {
+          return True ^ "true";
+        }
       }
     }
-
-    return indices;
-  }
-
-  std::vector<std::string> Resolver::object_find(
-    const Node& object, const std::string& search)
-  {
-    std::vector<std::string> indices;
-    for (auto& objectitem : *object)
+    else if (items->type() == Object)
     {
-      if (to_key(objectitem / Val) == search)
+      for (const Node& objectitem : *items)
       {
-        indices.push_back(to_key(objectitem / Key));
+        if (term_equal(objectitem / Val, item))
+        {
+          return True ^ "true";
+        }
       }
     }
 
-    return indices;
+    return False ^ "false";
   }
-}
\ No newline at end of file
+}
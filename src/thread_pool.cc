@@ -0,0 +1,168 @@
+#include "rego.hh"
+
+#include <algorithm>
+#include <deque>
+
+namespace rego
+{
+  struct ThreadPool::Queue
+  {
+    std::mutex mutex;
+    std::deque<std::size_t> indices;
+  };
+
+  ThreadPool::ThreadPool(std::size_t num_threads) :
+    m_task(nullptr), m_generation(0), m_busy(0), m_stop(false)
+  {
+    if (num_threads == 0)
+    {
+      num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (std::size_t i = 0; i < num_threads; ++i)
+    {
+      m_queues.push_back(std::make_unique<Queue>());
+    }
+
+    for (std::size_t i = 0; i < num_threads; ++i)
+    {
+      m_threads.emplace_back([this, i]() { work(i); });
+    }
+  }
+
+  ThreadPool::~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+
+    m_start.notify_all();
+    for (auto& thread : m_threads)
+    {
+      thread.join();
+    }
+  }
+
+  std::size_t ThreadPool::size() const
+  {
+    return m_threads.size();
+  }
+
+  void ThreadPool::run(
+    std::size_t count,
+    const std::function<void(std::size_t worker, std::size_t index)>& task)
+  {
+    if (count == 0)
+    {
+      return;
+    }
+
+    std::lock_guard<std::mutex> run_lock(m_run_mutex);
+
+    // deal the indices out in contiguous blocks, so that a worker which is
+    // not stolen from works through adjacent inputs
+    std::size_t num_workers = m_queues.size();
+    std::size_t block = count / num_workers;
+    std::size_t extra = count % num_workers;
+    std::size_t index = 0;
+    for (std::size_t worker = 0; worker < num_workers; ++worker)
+    {
+      std::size_t end = index + block + (worker < extra ? 1 : 0);
+      std::lock_guard<std::mutex> lock(m_queues[worker]->mutex);
+      for (; index < end; ++index)
+      {
+        m_queues[worker]->indices.push_back(index);
+      }
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_task = &task;
+    m_error = nullptr;
+    m_busy = num_workers;
+    m_generation++;
+    m_start.notify_all();
+    m_done.wait(lock, [this]() { return m_busy == 0; });
+    m_task = nullptr;
+
+    if (m_error != nullptr)
+    {
+      std::exception_ptr error = m_error;
+      m_error = nullptr;
+      std::rethrow_exception(error);
+    }
+  }
+
+  void ThreadPool::work(std::size_t worker)
+  {
+    std::size_t generation = 0;
+    while (true)
+    {
+      const std::function<void(std::size_t, std::size_t)>* task;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_start.wait(
+          lock, [&]() { return m_stop || m_generation != generation; });
+        if (m_stop)
+        {
+          return;
+        }
+
+        generation = m_generation;
+        task = m_task;
+      }
+
+      std::size_t index;
+      while (next(worker, index))
+      {
+        try
+        {
+          (*task)(worker, index);
+        }
+        catch (...)
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          if (m_error == nullptr)
+          {
+            m_error = std::current_exception();
+          }
+        }
+      }
+
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (--m_busy == 0)
+      {
+        m_done.notify_one();
+      }
+    }
+  }
+
+  bool ThreadPool::next(std::size_t worker, std::size_t& index)
+  {
+    {
+      Queue& own = *m_queues[worker];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.indices.empty())
+      {
+        index = own.indices.front();
+        own.indices.pop_front();
+        return true;
+      }
+    }
+
+    // steal from the back, away from where the owner is working
+    for (std::size_t i = 1; i < m_queues.size(); ++i)
+    {
+      Queue& other = *m_queues[(worker + i) % m_queues.size()];
+      std::lock_guard<std::mutex> lock(other.mutex);
+      if (!other.indices.empty())
+      {
+        index = other.indices.back();
+        other.indices.pop_back();
+        return true;
+      }
+    }
+
+    return false;
+  }
+}
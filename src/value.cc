@@ -0,0 +1,355 @@
+#include "internal.hh"
+
+#include <stdexcept>
+
+namespace
+{
+  using namespace trieste;
+
+  // Values are not modified once they have been placed in a collection, so
+  // a single node is shared by every null and boolean that leaves a frame.
+  const Node& null_node()
+  {
+    static const Node node = rego::Null ^ "null";
+    return node;
+  }
+
+  const Node& true_node()
+  {
+    static const Node node = rego::True ^ "true";
+    return node;
+  }
+
+  const Node& false_node()
+  {
+    static const Node node = rego::False ^ "false";
+    return node;
+  }
+}
+
+namespace rego
+{
+  Value::Value() : m_kind(Kind::Undefined), m_int(0) {}
+
+  Value::Value(const Node& node) : m_kind(Kind::Undefined), m_int(0)
+  {
+    Node value = node;
+    if (value == nullptr)
+    {
+      // held as is, so that writing it to a local can be reported
+      m_kind = Kind::Node;
+      new (&m_node) Node();
+      return;
+    }
+
+    if (value == Term)
+    {
+      value = value->front();
+    }
+
+    if (value == Scalar)
+    {
+      value = value->front();
+    }
+
+    if (value == Undefined)
+    {
+      return;
+    }
+
+    if (value == Null)
+    {
+      m_kind = Kind::Null;
+    }
+    else if (value == True)
+    {
+      m_kind = Kind::True;
+    }
+    else if (value == False)
+    {
+      m_kind = Kind::False;
+    }
+    else
+    {
+      m_kind = Kind::Node;
+      new (&m_node) Node(std::move(value));
+    }
+  }
+
+  Value Value::null()
+  {
+    Value value;
+    value.m_kind = Kind::Null;
+    return value;
+  }
+
+  Value Value::boolean(bool value)
+  {
+    Value result;
+    result.m_kind = value ? Kind::True : Kind::False;
+    return result;
+  }
+
+  Value Value::integer(std::int64_t value)
+  {
+    Value result;
+    result.m_kind = Kind::Int;
+    result.m_int = value;
+    return result;
+  }
+
+  Value Value::string(const Node& value)
+  {
+    Value result;
+    result.m_kind = Kind::String;
+    result.m_string = &value;
+    return result;
+  }
+
+  Value::Value(const Value& other) : m_kind(other.m_kind), m_int(0)
+  {
+    switch (m_kind)
+    {
+      case Kind::Int:
+        m_int = other.m_int;
+        break;
+
+      case Kind::String:
+        m_string = other.m_string;
+        break;
+
+      case Kind::Node:
+        new (&m_node) Node(other.m_node);
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  Value::Value(Value&& other) noexcept : m_kind(other.m_kind), m_int(0)
+  {
+    switch (m_kind)
+    {
+      case Kind::Int:
+        m_int = other.m_int;
+        break;
+
+      case Kind::String:
+        m_string = other.m_string;
+        break;
+
+      case Kind::Node:
+        new (&m_node) Node(std::move(other.m_node));
+        other.clear();
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  Value& Value::operator=(const Value& other)
+  {
+    if (this != &other)
+    {
+      if (m_kind == Kind::Node && other.m_kind == Kind::Node)
+      {
+        m_node = other.m_node;
+        return *this;
+      }
+
+      clear();
+      m_kind = other.m_kind;
+      switch (m_kind)
+      {
+        case Kind::Int:
+          m_int = other.m_int;
+          break;
+
+        case Kind::String:
+          m_string = other.m_string;
+          break;
+
+        case Kind::Node:
+          new (&m_node) Node(other.m_node);
+          break;
+
+        default:
+          break;
+      }
+    }
+
+    return *this;
+  }
+
+  Value& Value::operator=(Value&& other) noexcept
+  {
+    if (this != &other)
+    {
+      clear();
+      m_kind = other.m_kind;
+      switch (m_kind)
+      {
+        case Kind::Int:
+          m_int = other.m_int;
+          break;
+
+        case Kind::String:
+          m_string = other.m_string;
+          break;
+
+        case Kind::Node:
+          new (&m_node) Node(std::move(other.m_node));
+          other.clear();
+          break;
+
+        default:
+          break;
+      }
+    }
+
+    return *this;
+  }
+
+  Value::~Value()
+  {
+    clear();
+  }
+
+  void Value::clear()
+  {
+    if (m_kind == Kind::Node)
+    {
+      m_node.~Node();
+    }
+
+    m_kind = Kind::Undefined;
+    m_int = 0;
+  }
+
+  Value::Kind Value::kind() const
+  {
+    return m_kind;
+  }
+
+  Token Value::type() const
+  {
+    switch (m_kind)
+    {
+      case Kind::Undefined:
+        return Undefined;
+
+      case Kind::Null:
+        return Null;
+
+      case Kind::False:
+        return False;
+
+      case Kind::True:
+        return True;
+
+      case Kind::Int:
+        return Int;
+
+      case Kind::String:
+        return JSONString;
+
+      case Kind::Node:
+        if (m_node == nullptr)
+        {
+          return Undefined;
+        }
+
+        return m_node->type();
+    }
+
+    throw std::runtime_error("Invalid value kind");
+  }
+
+  bool Value::is_defined() const
+  {
+    return m_kind != Kind::Undefined;
+  }
+
+  std::int64_t Value::int_value() const
+  {
+    assert(m_kind == Kind::Int);
+    return m_int;
+  }
+
+  const Location& Value::string_value() const
+  {
+    assert(m_kind == Kind::String);
+    return (*m_string)->location();
+  }
+
+  const Node& Value::node() const
+  {
+    assert(m_kind == Kind::Node);
+    return m_node;
+  }
+
+  Node Value::to_node() const
+  {
+    switch (m_kind)
+    {
+      case Kind::Undefined:
+        return NodeDef::create(Undefined);
+
+      case Kind::Null:
+        return null_node();
+
+      case Kind::False:
+        return false_node();
+
+      case Kind::True:
+        return true_node();
+
+      case Kind::Int:
+        return Int ^ std::to_string(m_int);
+
+      case Kind::String:
+        return *m_string;
+
+      case Kind::Node:
+        return m_node;
+    }
+
+    throw std::runtime_error("Invalid value kind");
+  }
+
+  std::ostream& operator<<(std::ostream& os, const Value& value)
+  {
+    switch (value.m_kind)
+    {
+      case Value::Kind::Undefined:
+        return os << "<undefined>";
+
+      case Value::Kind::Null:
+        return os << "null";
+
+      case Value::Kind::False:
+        return os << "false";
+
+      case Value::Kind::True:
+        return os << "true";
+
+      case Value::Kind::Int:
+        return os << value.m_int;
+
+      case Value::Kind::String:
+        return os << (*value.m_string)->location().view();
+
+      case Value::Kind::Node:
+        if (value.m_node == nullptr)
+        {
+          return os << "<null>";
+        }
+
+        return os << to_key(value.m_node);
+    }
+
+    return os;
+  }
+}
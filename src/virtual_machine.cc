@@ -1,10 +1,17 @@
 #include "internal.hh"
 #include "rego.hh"
 
+#include <algorithm>
 #include <cstdint>
 #include <iterator>
 #include <stdexcept>
 
+// Statements are dispatched with computed goto where the compiler supports it,
+// and with a switch everywhere else.
+#if defined(__GNUC__) && !defined(REGOCPP_NO_COMPUTED_GOTO)
+#  define REGOCPP_COMPUTED_GOTO
+#endif
+
 namespace
 {
   using namespace trieste;
@@ -39,603 +46,2683 @@ namespace
     os << "--";
     return os;
   }
-}
-
-namespace rego
-{
-  namespace b = bundle;
 
-  std::ostream& operator<<(std::ostream& os, const DebugKey& node)
-  {
-    return os << rego::to_key(node.n);
-  }
+  // Collections smaller than this are searched linearly; a hashed index only
+  // pays for itself once there are a few members to skip over.
+  const std::size_t MinIndexedSize = 8;
 
-  VirtualMachine::VirtualMachine() :
-    m_int_regex(R"(-?(?:0|[1-9][0-9]*))"),
-    m_stmt_limit(10000000),
-    m_max_call_depth(512),
-    m_max_block_depth(512)
-  {}
+  // Sibling blocks are only indexed by a path into the input if at least this
+  // many of them compare the path with a constant.
+  const std::size_t MinIndexedRules = 4;
 
-  VirtualMachine& VirtualMachine::bundle(Bundle bundle)
-  {
-    if (bundle != nullptr)
-    {
-      // Sole structural-verification point: walk the bundle once at the
-      // public API boundary so the VM is never driven by malformed
-      // bytecode, regardless of how the BundleDef was produced (binary
-      // load, JSON IR, or programmatic construction by an embedder).
-      // verify() throws on any inconsistency.
-      bundle->verify();
-    }
-    m_bundle = bundle;
-    return *this;
-  }
+  // The initial size of the arena of a State. The arena grows to fit the
+  // largest evaluation seen, so that later evaluations do not spill onto
+  // the heap.
+  const std::size_t InitialArenaSize = 16 * 1024;
 
-  Bundle VirtualMachine::bundle() const
-  {
-    return m_bundle;
-  }
+  // The Rego version against which built-in deprecation is checked.
+  const trieste::Location RegoVersion("v1");
 
-  VirtualMachine& VirtualMachine::builtins(BuiltIns builtins)
+  // Appends a child without re-parenting it. Values are shared between
+  // collections, and with every other evaluation of the bundle (its data, its
+  // interned strings, and the shared null and boolean nodes), so writing
+  // their parent would race when a bundle is evaluated on several threads.
+  // Evaluation never walks up from a value, so the parent is not needed.
+  void append_shared(const trieste::Node& node, const trieste::Node& child)
   {
-    m_builtins = builtins;
-    return *this;
+    node->push_back_ephemeral(child);
   }
 
-  BuiltIns VirtualMachine::builtins() const
+  // Creates a node whose children are (possibly) shared values.
+  trieste::Node create_shared(
+    const trieste::Token& type, std::initializer_list<trieste::Node> children)
   {
-    return m_builtins;
-  }
+    trieste::Node node = trieste::NodeDef::create(type);
+    for (auto& child : children)
+    {
+      append_shared(node, child);
+    }
 
-  bool VirtualMachine::State::is_in_call_stack(const Location& func_name) const
-  {
-    auto it = std::find(m_call_stack.begin(), m_call_stack.end(), func_name);
-    return it != m_call_stack.end();
+    return node;
   }
 
-  void VirtualMachine::State::push_function(
-    const Location& func_name, size_t num_args)
+  // Copies the top level of a collection, sharing its members.
+  trieste::Node shallow_copy(const trieste::Node& collection)
   {
-    m_call_stack.push_back(func_name);
-    m_num_args.push_back(num_args);
-  }
+    trieste::Node copy =
+      trieste::NodeDef::create(collection->type(), collection->location());
+    for (auto& child : *collection)
+    {
+      append_shared(copy, child);
+    }
 
-  void VirtualMachine::State::pop_function(const Location& func_name)
-  {
-    assert(m_call_stack.back() == func_name);
-    m_call_stack.pop_back();
-    m_num_args.pop_back();
+    return copy;
   }
 
-  void VirtualMachine::State::put_function_result(
-    const Location& func_name, Node result)
+  // Compares two values without creating nodes for them. Returns nullopt when
+  // the comparison needs the full term_equal().
+  std::optional<bool> inline_equal(
+    const rego::Value& lhs, const rego::Value& rhs)
   {
-    m_function_cache[func_name] = result;
-  }
+    using Kind = rego::Value::Kind;
+    if (
+      lhs.kind() == Kind::Node || rhs.kind() == Kind::Node ||
+      !lhs.is_defined() || !rhs.is_defined())
+    {
+      return std::nullopt;
+    }
 
-  Node VirtualMachine::State::get_function_result(
-    const Location& func_name) const
-  {
-    if (in_with())
+    if (lhs.kind() == Kind::String && rhs.kind() == Kind::String)
     {
-      return nullptr;
+      // the same text is the same string, but differently escaped text may
+      // still be
+      if (lhs.string_value().view() == rhs.string_value().view())
+      {
+        return true;
+      }
+
+      return std::nullopt;
     }
 
-    auto it = m_function_cache.find(func_name);
-    if (it == m_function_cache.end())
+    if (lhs.kind() != rhs.kind())
     {
-      return nullptr;
+      return false;
     }
 
-    return it->second;
-  }
+    if (lhs.kind() == Kind::Int)
+    {
+      return lhs.int_value() == rhs.int_value();
+    }
 
-  bool VirtualMachine::State::in_with() const
-  {
-    return m_with_count > 0;
+    return true;
   }
 
-  void VirtualMachine::State::push_with()
+  bool values_equal(const rego::Value& lhs, const rego::Value& rhs)
   {
-    m_with_count++;
-  }
+    auto maybe_equal = inline_equal(lhs, rhs);
+    if (maybe_equal.has_value())
+    {
+      return *maybe_equal;
+    }
 
-  void VirtualMachine::State::pop_with()
-  {
-    assert(m_with_count > 0);
-    m_with_count--;
+    return rego::term_equal(lhs.to_node(), rhs.to_node());
   }
 
-  bool VirtualMachine::State::in_break() const
+  trieste::Node member_key(
+    const trieste::Node& collection, const trieste::Node& member)
   {
-    return m_break_count > 0;
-  }
+    // ObjectItem is (Key, Val). front() is used rather than `/ Key` so that
+    // indexes can also be built outside of an active WFContext.
+    if (collection == rego::Object)
+    {
+      return member->front();
+    }
 
-  void VirtualMachine::State::push_break(size_t levels)
-  {
-    m_break_count += levels;
+    return member;
   }
 
-  void VirtualMachine::State::pop_break()
+  // The value at a path of keys into nested objects, or null if there is no
+  // such value.
+  trieste::Node field_value(
+    trieste::Node node, const std::vector<trieste::Node>& keys)
   {
-    assert(m_break_count > 0);
-    m_break_count--;
-  }
+    auto unwrap_term = [](trieste::Node& n) {
+      while (n->in({rego::Term, rego::Scalar}) && !n->empty())
+      {
+        n = n->front();
+      }
+    };
 
-  std::string_view VirtualMachine::State::root_function_name() const
-  {
-    if (m_call_stack.empty())
+    for (const trieste::Node& key : keys)
     {
-      return "<invalid>";
-    }
+      unwrap_term(node);
+      if (node != rego::Object)
+      {
+        return nullptr;
+      }
 
-    std::string_view name = m_call_stack.front().view();
-    if (name.starts_with("g0.querymodule$"))
-    {
-      if (m_call_stack.size() == 1)
+      trieste::Node found;
+      for (const trieste::Node& item : *node)
       {
-        return "<invalid>";
+        if (rego::term_equal(item->front(), key))
+        {
+          found = item->back();
+          break;
+        }
+      }
+
+      if (found == nullptr)
+      {
+        return nullptr;
       }
 
-      name = m_call_stack.at(1).view();
+      node = found;
     }
 
-    name = name.substr(name.find('.') + 1);
-    return name;
+    unwrap_term(node);
+    return node;
   }
+}
 
-  void VirtualMachine::State::add_result(Node node)
-  {
-    m_result_set.push_back(node);
-  }
+namespace rego
+{
+  namespace b = bundle;
 
-  const Nodes& VirtualMachine::State::result_set() const
+  std::ostream& operator<<(std::ostream& os, const DebugKey& node)
   {
-    return m_result_set;
+    return os << rego::to_key(node.n);
   }
 
-  void VirtualMachine::State::add_error(Node node)
-  {
-    m_errors.push_back(node);
-  }
+  VirtualMachine::VirtualMachine() :
+    m_int_regex(R"(-?(?:0|[1-9][0-9]*))"),
+    m_stmt_limit(10000000),
+    m_max_call_depth(512),
+    m_max_block_depth(512),
+    m_memo_limit(0),
+    m_stmts_executed(0),
+    m_allocations(0),
+    m_allocated_bytes(0),
+    m_heap_allocations(0),
+    m_heap_bytes(0),
+    m_arena_enabled(false)
+  {}
 
-  void VirtualMachine::State::add_error_multiple_output(Node node)
+  VirtualMachine& VirtualMachine::bundle(Bundle bundle)
   {
-    const std::string comp_message =
-      "complete rules must not produce multiple outputs";
-    const std::string func_message =
-      "functions must not produce multiple outputs for same inputs";
-    if (m_num_args.empty() || m_num_args.back() == 2)
+    // Interpreter::query_bundle sets the bundle before every query, so the
+    // bundle already in use is kept along with its lowered program, indexes
+    // and shared results.
+    if (bundle != nullptr && bundle == m_bundle)
     {
-      add_error(err(node, comp_message, EvalConflictError));
-      return;
+      return *this;
     }
 
-    add_error(err(node, func_message, EvalConflictError));
-  }
-
-  void VirtualMachine::State::add_error_object_insert(Node node)
-  {
-    const std::string message = "object keys must be unique";
-    add_error(err(node, message, EvalConflictError));
-  }
+    if (bundle != nullptr)
+    {
+      // Sole structural-verification point: walk the bundle once at the
+      // public API boundary so the VM is never driven by malformed
+      // bytecode, regardless of how the BundleDef was produced (binary
+      // load, JSON IR, or programmatic construction by an embedder).
+      // verify() throws on any inconsistency, and returns at once for a
+      // bundle which has already passed.
+      bundle->verify();
+    }
+    m_bundle = bundle;
 
-  const Nodes& VirtualMachine::State::errors() const
-  {
-    return m_errors;
-  }
+    {
+      // pooled states are sized for the previous bundle
+      std::lock_guard<std::mutex> lock(m_state_pool_mutex);
+      m_state_pool.clear();
+    }
 
-  Node VirtualMachine::State::read_local(size_t key) const
-  {
-    assert(key < m_frame.size());
+    intern_strings();
+    lower();
+    index_rules();
+    link();
 
-    if (m_frame[key] != nullptr)
+    // The bundle data is shared by every evaluation, so large collections
+    // within it are indexed once here rather than per query.
+    m_data_indexes.clear();
+    m_field_indexes.clear();
+    if (m_bundle != nullptr && m_bundle->data != nullptr)
     {
-      logging::Trace() << "frame[" << key << "]" << " -> "
-                       << DebugKey(m_frame[key]);
-      return m_frame[key];
+      Nodes pending{m_bundle->data};
+      while (!pending.empty())
+      {
+        Node node = pending.back();
+        pending.pop_back();
+        if (node->in({Object, Set}) && node->size() >= MinIndexedSize)
+        {
+          auto [it, _] = m_data_indexes.try_emplace(
+            node.get(), std::make_pair(node, TermIndex()));
+          it->second.second.sync(node);
+        }
+
+        if (
+          !m_field_paths.empty() && node->in({Array, Object, Set}) &&
+          node->size() >= MinIndexedSize)
+        {
+          index_fields(node);
+        }
+
+        pending.insert(pending.end(), node->begin(), node->end());
+      }
     }
 
-    logging::Trace() << "frame[" << key << "]" << " -> " << "<missing>";
-    return Undefined;
+    return *this;
   }
 
-  void VirtualMachine::State::write_local(size_t key, Node value)
+  void VirtualMachine::intern_strings()
   {
-    assert(key < m_frame.size());
-
-    if (value == Term)
+    m_strings.clear();
+    m_numbers.clear();
+    if (m_bundle == nullptr)
     {
-      value = value->front();
+      return;
     }
 
-    if (value == Scalar)
+    // filled in by lower() for the strings that MakeNumberRef refers to
+    m_numbers.resize(m_bundle->strings.size());
+
+    m_strings.reserve(m_bundle->strings.size());
+    for (const Location& string : m_bundle->strings)
     {
-      value = value->front();
+      Node node = JSONString ^ string;
+      std::string text = strip_quotes(to_key(node));
+      std::size_t hash = term_hash(node);
+      m_strings.push_back({node, text, hash});
     }
+  }
 
-    if (value == Undefined)
+  void VirtualMachine::lower()
+  {
+    m_code.clear();
+    m_blocks.clear();
+    m_plan_blocks.clear();
+    m_function_blocks.clear();
+    m_calls.clear();
+    if (m_bundle == nullptr)
     {
-      return reset_local(key);
+      return;
     }
 
-    if (value == nullptr)
+    for (const b::Plan& plan : m_bundle->plans)
     {
-      logging::Error() << "Attempting to write null value to local: " << key;
-      throw std::runtime_error("Cannot write null value to local variable");
+      m_plan_blocks.push_back(
+        lower_blocks(plan.blocks.data(), plan.blocks.size()));
     }
 
-    m_frame[key] = value;
-    logging::Trace() << DebugKey(value) << " -> frame[" << key << "]";
+    for (const b::Function& function : m_bundle->functions)
+    {
+      m_function_blocks.push_back(
+        lower_blocks(function.blocks.data(), function.blocks.size()));
+    }
   }
 
-  bool VirtualMachine::State::is_defined(size_t key) const
+  VirtualMachine::Range VirtualMachine::lower_blocks(
+    const b::Block* blocks, std::size_t count)
   {
-    assert(key < m_frame.size());
-
-    if (m_frame[key] == nullptr || m_frame[key] == Undefined)
+    // The blocks are reserved first so that they stay adjacent even though
+    // lowering them appends the blocks nested within them.
+    std::uint32_t begin = static_cast<std::uint32_t>(m_blocks.size());
+    m_blocks.resize(m_blocks.size() + count);
+    for (std::size_t i = 0; i < count; ++i)
     {
-      logging::Trace() << "frame[" << key << "]" << " -> " << "<missing>";
-      return false;
+      Range code = lower_block(blocks[i]);
+      m_blocks[begin + i] = code;
     }
 
-    logging::Trace() << "frame[" << key << "]" << " -> "
-                     << DebugKey(m_frame[key]);
-    return true;
+    return {begin, static_cast<std::uint32_t>(begin + count)};
   }
 
-  void VirtualMachine::State::reset_local(size_t key)
+  VirtualMachine::Range VirtualMachine::lower_block(const b::Block& block)
   {
-    assert(key < m_frame.size());
+    std::uint32_t begin = static_cast<std::uint32_t>(m_code.size());
+    m_code.resize(m_code.size() + block.size());
+    for (std::size_t i = 0; i < block.size(); ++i)
+    {
+      const b::Statement& stmt = block[i];
+      Instruction inst;
+      inst.type = stmt.type;
+      inst.target = stmt.target;
+      inst.op0 = stmt.op0;
+      inst.op1 = stmt.op1;
+      inst.blocks = {0, 0};
+      inst.call = 0;
+      inst.rule_index = NoRuleIndex;
+      inst.scan_key = NoScanKey;
+      inst.stmt = &stmt;
+      switch (stmt.type)
+      {
+        case b::StatementType::Call: {
+          CallTarget call{
+            stmt.ext->call().func, nullptr, NoFunction, false, false};
+          auto maybe_index = m_bundle->find_function(call.name);
+          if (maybe_index.has_value())
+          {
+            call.function = static_cast<std::uint32_t>(*maybe_index);
+          }
 
-    logging::Debug() << "reset frame[" << key << "]";
-    m_frame[key] = nullptr;
-  }
+          inst.call = static_cast<std::uint32_t>(m_calls.size());
+          m_calls.push_back(call);
+          break;
+        }
 
-  Node VirtualMachine::unpack_operand(
-    const State& state, const b::Operand& operand) const
-  {
-    switch (operand.type)
-    {
-      case b::OperandType::Local:
-        return state.read_local(operand.index);
+        case b::StatementType::Block: {
+          const std::vector<b::Block>& blocks = stmt.ext->blocks();
+          inst.blocks = lower_blocks(blocks.data(), blocks.size());
+          break;
+        }
 
-      case b::OperandType::String:
-        assert(operand.index < m_bundle->strings.size());
-        return JSONString ^ m_bundle->strings[operand.index];
+        case b::StatementType::MakeNumberRef: {
+          Node& number = m_numbers[stmt.op0.index];
+          if (number == nullptr)
+          {
+            const Location& value = m_bundle->strings[stmt.op0.index];
+            if (TRegex::FullMatch(value.view(), m_int_regex))
+            {
+              number = Int ^ value;
+            }
+            else
+            {
+              number = Float ^ value;
+            }
+          }
+          break;
+        }
 
-      case b::OperandType::False:
-        return False ^ "false";
+        case b::StatementType::Not:
+        case b::StatementType::Scan:
+          inst.blocks = lower_blocks(&stmt.ext->block(), 1);
+          break;
 
-      case b::OperandType::True:
-        return True ^ "true";
+        case b::StatementType::With:
+          inst.blocks = lower_blocks(&stmt.ext->with().block, 1);
+          break;
 
-      case b::OperandType::Index:
-      case b::OperandType::Value:
-        throw std::runtime_error("Unpacking raw operand");
+        default:
+          break;
+      }
 
-      case b::OperandType::None:
-        throw std::runtime_error("Uninitialized operand");
+      m_code[begin + i] = inst;
     }
 
-    throw std::runtime_error("Invalid operand");
-  }
-
-  size_t VirtualMachine::State::stmt_count() const
-  {
-    return m_stmt_count;
-  }
-
-  size_t VirtualMachine::State::inc_stmts()
-  {
-    m_stmt_count += 1;
-    return m_stmt_count;
+    return {begin, static_cast<std::uint32_t>(begin + block.size())};
   }
 
-  size_t VirtualMachine::State::call_depth() const
+  void VirtualMachine::index_rules()
   {
-    return m_call_stack.size();
-  }
+    m_rule_indexes.clear();
+    m_function_rule_indexes.clear();
+    m_scan_keys.clear();
+    m_field_paths.clear();
+    if (m_bundle == nullptr)
+    {
+      return;
+    }
 
-  size_t VirtualMachine::State::block_depth() const
-  {
-    return m_block_depth;
-  }
+    std::unordered_map<std::size_t, std::uint32_t> counts;
+    auto index_nested = [&](const Range& top) {
+      std::vector<Range> pending{top};
+      while (!pending.empty())
+      {
+        Range blocks = pending.back();
+        pending.pop_back();
+        for (std::uint32_t b = blocks.begin; b < blocks.end; ++b)
+        {
+          const Range& block = m_blocks[b];
+          for (std::uint32_t i = block.begin; i < block.end; ++i)
+          {
+            Instruction& inst = m_code[i];
+            if (inst.type == b::StatementType::Block)
+            {
+              inst.rule_index = index_rules(inst.blocks, counts);
+            }
+            else if (inst.type == b::StatementType::Scan)
+            {
+              inst.scan_key = index_scan(inst, counts);
+            }
 
-  void VirtualMachine::State::enter_block()
-  {
-    m_block_depth += 1;
-  }
+            if (inst.blocks.end > inst.blocks.begin)
+            {
+              pending.push_back(inst.blocks);
+            }
+          }
+        }
+      }
+    };
 
-  void VirtualMachine::State::leave_block()
-  {
-    assert(m_block_depth > 0 && "leave_block underflow");
-    m_block_depth -= 1;
-  }
+    // Only the blocks nested within a plan are indexed, as a plan stops at
+    // the first of its own blocks which is undefined.
+    for (const Range& blocks : m_plan_blocks)
+    {
+      counts.clear();
+      count_locals(blocks, counts);
+      index_nested(blocks);
+    }
 
-  VirtualMachine::State::State(Node input, Node data, size_t num_locals) :
-    m_with_count(0), m_break_count(0), m_stmt_count(0), m_block_depth(0)
-  {
-    m_frame.resize(num_locals, nullptr);
-    write_local(0, input->front());
-    write_local(1, data);
+    for (const Range& blocks : m_function_blocks)
+    {
+      counts.clear();
+      count_locals(blocks, counts);
+      m_function_rule_indexes.push_back(index_rules(blocks, counts));
+      index_nested(blocks);
+    }
   }
 
-  Node VirtualMachine::run_query(Node input) const
+  std::uint32_t VirtualMachine::index_rules(
+    const Range& blocks,
+    const std::unordered_map<std::size_t, std::uint32_t>& counts)
   {
-    logging::Debug() << "Input: " << input;
+    if (blocks.end - blocks.begin < MinIndexedRules)
+    {
+      return NoRuleIndex;
+    }
+
+    struct Guard
+    {
+      std::vector<std::uint32_t> path;
+      std::uint32_t string;
+      std::vector<std::uint32_t> resets;
+    };
+
+    // A block is guarded if, before any statement other than those which
+    // only assign locals or test values, it tests a path into the input
+    // (local 0) for equality with a string. Skipping a guarded block which
+    // cannot match must have the same effect as running it, so the locals
+    // it assigns before the test must not be used outside of it (locals are
+    // shared by a whole function or plan), and the locals it resets must be
+    // reset before it can stop.
+    auto find_guard = [&](std::uint32_t block) -> std::optional<Guard> {
+      const Range& code = m_blocks[block];
+      std::unordered_map<std::size_t, std::vector<std::uint32_t>> paths{
+        {0, {}}};
+      auto path_of = [&paths](const b::Operand& op) {
+        const std::vector<std::uint32_t>* path = nullptr;
+        if (op.type == b::OperandType::Local)
+        {
+          auto it = paths.find(op.index);
+          if (it != paths.end())
+          {
+            path = &it->second;
+          }
+        }
 
-    if (m_bundle == nullptr)
-    {
-      return ErrorSeq << err(Line ^ Location("<query>"), "no bundle loaded");
-    }
+        return path;
+      };
 
-    auto maybe_index = m_bundle->query_plan;
-    if (!maybe_index.has_value())
-    {
-      logging::Error() << "Plan not found for query";
-      return ErrorSeq << err(
-               Line ^ Location("<query>"), "query plan not found");
-    }
+      Guard guard;
+      std::vector<std::size_t> assigned;
+      bool can_stop = false;
+      for (std::uint32_t i = code.begin; i < code.end; ++i)
+      {
+        const Instruction& inst = m_code[i];
+        switch (inst.type)
+        {
+          case b::StatementType::Dot:
+          case b::StatementType::AssignVar:
+          case b::StatementType::AssignInt:
+          case b::StatementType::MakeNumberInt:
+          case b::StatementType::MakeNumberRef:
+          case b::StatementType::MakeNull:
+          case b::StatementType::ResetLocal: {
+            if (inst.target <= 0)
+            {
+              return std::nullopt;
+            }
+
+            std::size_t target = static_cast<std::size_t>(inst.target);
+            const std::vector<std::uint32_t>* source = path_of(inst.op0);
+            if (
+              inst.type == b::StatementType::Dot && source != nullptr &&
+              inst.op1.type == b::OperandType::String)
+            {
+              std::vector<std::uint32_t> path = *source;
+              path.push_back(static_cast<std::uint32_t>(inst.op1.index));
+              paths[target] = std::move(path);
+            }
+            else if (
+              inst.type == b::StatementType::AssignVar && source != nullptr)
+            {
+              std::vector<std::uint32_t> path = *source;
+              paths[target] = std::move(path);
+            }
+            else
+            {
+              paths.erase(target);
+            }
 
-    State state(input, m_bundle->data, m_bundle->local_count);
-    run_plan(m_bundle->plans[*maybe_index], state);
+            if (inst.type == b::StatementType::ResetLocal)
+            {
+              if (can_stop)
+              {
+                return std::nullopt;
+              }
 
-    if (!state.errors().empty())
+              guard.resets.push_back(static_cast<std::uint32_t>(target));
+            }
+            else
+            {
+              assigned.push_back(target);
+            }
+
+            can_stop = can_stop || inst.type == b::StatementType::Dot;
+            break;
+          }
+
+          case b::StatementType::IsDefined:
+          case b::StatementType::IsUndefined:
+          case b::StatementType::NotEqual:
+            can_stop = true;
+            break;
+
+          case b::StatementType::Equal: {
+            can_stop = true;
+            const std::vector<std::uint32_t>* path = path_of(inst.op0);
+            const b::Operand* constant = &inst.op1;
+            if (path == nullptr)
+            {
+              path = path_of(inst.op1);
+              constant = &inst.op0;
+            }
+
+            // differently escaped strings may still be equal
+            if (
+              path == nullptr || constant->type != b::OperandType::String ||
+              m_bundle->strings[constant->index].view().find('\\') !=
+                std::string_view::npos)
+            {
+              break;
+            }
+
+            std::unordered_map<std::size_t, std::uint32_t> uses;
+            count_locals({block, block + 1}, uses);
+            for (std::size_t local : assigned)
+            {
+              auto it = counts.find(local);
+              if (it == counts.end() || it->second != uses[local])
+              {
+                return std::nullopt;
+              }
+            }
+
+            guard.path = *path;
+            guard.string = static_cast<std::uint32_t>(constant->index);
+            std::sort(guard.resets.begin(), guard.resets.end());
+            guard.resets.erase(
+              std::unique(guard.resets.begin(), guard.resets.end()),
+              guard.resets.end());
+            return guard;
+          }
+
+          default:
+            return std::nullopt;
+        }
+      }
+
+      return std::nullopt;
+    };
+
+    std::vector<std::optional<Guard>> guards;
+    std::map<std::vector<std::uint32_t>, std::size_t> frequencies;
+    for (std::uint32_t b = blocks.begin; b < blocks.end; ++b)
     {
-      return ErrorSeq << state.errors();
+      guards.push_back(find_guard(b));
+      if (guards.back().has_value())
+      {
+        frequencies[guards.back()->path]++;
+      }
     }
 
-    if (state.result_set().empty())
+    auto most_frequent = std::max_element(
+      frequencies.begin(), frequencies.end(), [](auto& lhs, auto& rhs) {
+        return lhs.second < rhs.second;
+      });
+    if (
+      most_frequent == frequencies.end() ||
+      most_frequent->second < MinIndexedRules)
     {
-      return Undefined;
+      return NoRuleIndex;
     }
 
-    Node results = NodeDef::create(Results);
-    for (Node result : state.result_set())
+    RuleIndex index;
+    index.path = most_frequent->first;
+    bool first = true;
+    for (std::uint32_t b = blocks.begin; b < blocks.end; ++b)
     {
-      Node result_obj = (result->front() / Val)->front();
+      const std::optional<Guard>& guard = guards[b - blocks.begin];
+      if (!guard.has_value() || guard->path != index.path)
+      {
+        index.unguarded.push_back(b);
+        continue;
+      }
 
-      Nodes nodes = Resolver::object_lookdown(result_obj, "\"expressions\"");
-      Node terms = NodeDef::create(Terms);
-      if (!nodes.empty())
+      // the skipped blocks are replaced by a single set of resets
+      if (first)
       {
-        Node expressions_arr = nodes.front()->front();
-        if (expressions_arr->empty())
+        index.resets = guard->resets;
+        first = false;
+      }
+      else if (guard->resets != index.resets)
+      {
+        return NoRuleIndex;
+      }
+
+      index.guarded[m_bundle->strings[guard->string].view()].push_back(b);
+    }
+
+    m_rule_indexes.push_back(std::move(index));
+    return static_cast<std::uint32_t>(m_rule_indexes.size() - 1);
+  }
+
+  std::uint32_t VirtualMachine::index_scan(
+    const Instruction& inst,
+    const std::unordered_map<std::size_t, std::uint32_t>& counts)
+  {
+    // As for rule bodies (see index_rules), the body of the scan must start
+    // with the test, before which it only assigns locals or tests values,
+    // and the locals assigned for an item which is skipped (including the
+    // key and the item themselves) must not be used outside of the scan.
+    std::size_t key = inst.op0.index;
+    std::size_t item = inst.op1.index;
+    std::unordered_map<std::size_t, std::vector<std::uint32_t>> paths{
+      {item, {}}};
+    auto path_of = [&paths](const b::Operand& op) {
+      const std::vector<std::uint32_t>* path = nullptr;
+      if (op.type == b::OperandType::Local)
+      {
+        auto it = paths.find(op.index);
+        if (it != paths.end())
         {
-          continue;
+          path = &it->second;
         }
+      }
 
-        for (auto expr : *expressions_arr)
+      return path;
+    };
+
+    // whether the body of the scan assigns the local
+    auto is_assigned = [&](std::size_t local) {
+      std::vector<Range> pending{inst.blocks};
+      while (!pending.empty())
+      {
+        Range blocks = pending.back();
+        pending.pop_back();
+        for (std::uint32_t b = blocks.begin; b < blocks.end; ++b)
         {
-          auto maybe_object = unwrap(expr, Object);
-          if (!maybe_object.success)
+          const Range& block = m_blocks[b];
+          for (std::uint32_t i = block.begin; i < block.end; ++i)
           {
-            return ErrorSeq << err(expr, "Expected a results object");
+            const Instruction& nested = m_code[i];
+            if (
+              (nested.target >= 0 &&
+               static_cast<std::size_t>(nested.target) == local) ||
+              (nested.type == b::StatementType::Scan &&
+               (nested.op0.index == local || nested.op1.index == local)))
+            {
+              return true;
+            }
+
+            if (nested.blocks.end > nested.blocks.begin)
+            {
+              pending.push_back(nested.blocks);
+            }
           }
+        }
+      }
 
-          Nodes values =
-            Resolver::object_lookdown(maybe_object.node, "\"value\"");
-          if (values.size() != 1)
+      return false;
+    };
+
+    // whether a local holds the same value throughout the scan
+    auto is_invariant = [&](std::size_t local, const auto& assigned) {
+      return local != key && local != item &&
+        std::find(assigned.begin(), assigned.end(), local) == assigned.end() &&
+        !is_assigned(local);
+    };
+
+    // the locals which hold a path into a value which does not change
+    std::unordered_map<std::size_t, Probe> probes;
+    std::vector<std::size_t> assigned{key, item};
+    const Range& body = m_blocks[inst.blocks.begin];
+    for (std::uint32_t i = body.begin; i < body.end; ++i)
+    {
+      const Instruction& stmt = m_code[i];
+      switch (stmt.type)
+      {
+        case b::StatementType::Dot:
+        case b::StatementType::AssignVar:
+        case b::StatementType::AssignInt:
+        case b::StatementType::MakeNumberInt:
+        case b::StatementType::MakeNumberRef:
+        case b::StatementType::MakeNull: {
+          if (stmt.target < 0)
           {
-            return ErrorSeq
-              << err(maybe_object.node, "No results in result object");
+            return NoScanKey;
+          }
+
+          std::size_t target = static_cast<std::size_t>(stmt.target);
+          std::optional<std::vector<std::uint32_t>> source;
+          if (const auto* path = path_of(stmt.op0); path != nullptr)
+          {
+            source = *path;
+          }
+
+          std::optional<Probe> probe;
+          if (stmt.op0.type == b::OperandType::Local)
+          {
+            auto it = probes.find(stmt.op0.index);
+            if (it != probes.end())
+            {
+              probe = it->second;
+            }
+            else if (is_invariant(stmt.op0.index, assigned))
+            {
+              probe = Probe{stmt.op0, {}};
+            }
+          }
+          else if (stmt.op0.type == b::OperandType::String)
+          {
+            probe = Probe{stmt.op0, {}};
+          }
+
+          paths.erase(target);
+          probes.erase(target);
+          if (
+            stmt.type == b::StatementType::Dot &&
+            stmt.op1.type == b::OperandType::String)
+          {
+            std::uint32_t step = static_cast<std::uint32_t>(stmt.op1.index);
+            if (source.has_value())
+            {
+              source->push_back(step);
+              paths[target] = std::move(*source);
+            }
+            else if (
+              probe.has_value() &&
+              probe->operand.type != b::OperandType::String)
+            {
+              probe->path.push_back(step);
+              probes[target] = std::move(*probe);
+            }
+          }
+          else if (stmt.type == b::StatementType::AssignVar)
+          {
+            if (source.has_value())
+            {
+              paths[target] = std::move(*source);
+            }
+            else if (probe.has_value())
+            {
+              probes[target] = std::move(*probe);
+            }
+          }
+
+          assigned.push_back(target);
+          break;
+        }
+
+        case b::StatementType::IsDefined:
+        case b::StatementType::IsUndefined:
+        case b::StatementType::NotEqual:
+          break;
+
+        case b::StatementType::Equal: {
+          const std::vector<std::uint32_t>* path = path_of(stmt.op0);
+          const b::Operand* operand = &stmt.op1;
+          if (path == nullptr)
+          {
+            path = path_of(stmt.op1);
+            operand = &stmt.op0;
+          }
+
+          if (path == nullptr)
+          {
+            break;
+          }
+
+          std::optional<Probe> probe;
+          if (operand->type == b::OperandType::String)
+          {
+            probe = Probe{*operand, {}};
+          }
+          else if (operand->type == b::OperandType::Local)
+          {
+            auto it = probes.find(operand->index);
+            if (it != probes.end())
+            {
+              probe = it->second;
+            }
+            else if (is_invariant(operand->index, assigned))
+            {
+              probe = Probe{*operand, {}};
+            }
+          }
+
+          if (!probe.has_value())
+          {
+            break;
+          }
+
+          std::unordered_map<std::size_t, std::uint32_t> uses;
+          count_locals({inst.blocks.begin, inst.blocks.begin + 1}, uses);
+          uses[key]++;
+          uses[item]++;
+          if (inst.target >= 0)
+          {
+            uses[static_cast<std::size_t>(inst.target)]++;
+          }
+
+          for (std::size_t local : assigned)
+          {
+            auto it = counts.find(local);
+            if (it == counts.end() || it->second != uses[local])
+            {
+              return NoScanKey;
+            }
           }
 
-          terms << values.front();
+          auto existing =
+            std::find(m_field_paths.begin(), m_field_paths.end(), *path);
+          std::uint32_t path_index =
+            static_cast<std::uint32_t>(existing - m_field_paths.begin());
+          if (existing == m_field_paths.end())
+          {
+            m_field_paths.push_back(*path);
+          }
+
+          m_scan_keys.push_back({path_index, std::move(*probe)});
+          return static_cast<std::uint32_t>(m_scan_keys.size() - 1);
         }
+
+        default:
+          return NoScanKey;
       }
+    }
 
-      nodes = Resolver::object_lookdown(result_obj, "\"bindings\"");
-      Node bindings = NodeDef::create(Bindings);
-      if (!nodes.empty())
+    return NoScanKey;
+  }
+
+  void VirtualMachine::index_fields(const Node& collection)
+  {
+    for (std::uint32_t p = 0; p < m_field_paths.size(); ++p)
+    {
+      std::vector<Node> keys;
+      for (std::uint32_t key : m_field_paths[p])
       {
-        Node bindings_obj = nodes.front()->front();
-        for (Node item : *bindings_obj)
+        keys.push_back(m_strings[key].node);
+      }
+
+      FieldIndex index;
+      for (std::uint32_t i = 0; i < collection->size(); ++i)
+      {
+        Node value = collection->at(i);
+        if (collection == Object)
+        {
+          value = value->back();
+        }
+
+        value = field_value(value, keys);
+        if (value == nullptr || value != JSONString)
+        {
+          // not a string, and so never equal to one
+          continue;
+        }
+
+        std::string_view text = value->location().view();
+        if (text.find('\\') != std::string_view::npos)
         {
-          bindings
-            << (Binding << (Var ^ strip_quotes(to_key(item / Key)))
-                        << item / Val);
+          index.escaped.push_back(i);
+        }
+        else
+        {
+          index.positions[text].push_back(i);
         }
       }
 
-      results << (Result << terms << bindings);
+      if (!index.positions.empty() || !index.escaped.empty())
+      {
+        m_field_indexes.emplace(
+          std::make_pair(collection.get(), p), std::move(index));
+      }
     }
+  }
 
-    Node ast = Top << results;
-    wf_result.build_st(ast);
+  void VirtualMachine::count_locals(
+    const Range& blocks,
+    std::unordered_map<std::size_t, std::uint32_t>& counts) const
+  {
+    // Every operand which may refer to a local is counted, whether or not it
+    // does, so that the counts err on the side of a local being used.
+    auto count = [&counts](const b::Operand& op) {
+      if (op.type == b::OperandType::Local || op.type == b::OperandType::Index)
+      {
+        counts[op.index]++;
+      }
+    };
 
-    logging::Debug() << "Results: " << results;
+    std::vector<Range> pending{blocks};
+    while (!pending.empty())
+    {
+      Range range = pending.back();
+      pending.pop_back();
+      for (std::uint32_t b = range.begin; b < range.end; ++b)
+      {
+        const Range& block = m_blocks[b];
+        for (std::uint32_t i = block.begin; i < block.end; ++i)
+        {
+          const Instruction& inst = m_code[i];
+          count(inst.op0);
+          count(inst.op1);
+          if (inst.target >= 0)
+          {
+            counts[static_cast<std::size_t>(inst.target)]++;
+          }
 
-    return results;
+          if (inst.type == b::StatementType::Call)
+          {
+            std::for_each(
+              inst.stmt->ext->call().ops.begin(),
+              inst.stmt->ext->call().ops.end(),
+              count);
+          }
+          else if (inst.type == b::StatementType::CallDynamic)
+          {
+            const b::CallDynamicExt& call = inst.stmt->ext->call_dynamic();
+            std::for_each(call.path.begin(), call.path.end(), count);
+            std::for_each(call.ops.begin(), call.ops.end(), count);
+          }
+
+          if (inst.blocks.end > inst.blocks.begin)
+          {
+            pending.push_back(inst.blocks);
+          }
+        }
+      }
+    }
   }
 
-  Node VirtualMachine::run_entrypoint(
-    const Location& entrypoint, Node input) const
+  void VirtualMachine::link()
   {
-    if (m_bundle == nullptr)
+    // Built-ins take precedence over bundle functions of the same name, as
+    // they did when calls were resolved by name at evaluation time.
+    for (CallTarget& call : m_calls)
     {
-      return ErrorSeq << err(Line ^ Location("<query>"), "no bundle loaded");
+      call.builtin = nullptr;
+      if (m_builtins != nullptr && m_builtins->is_builtin(call.name))
+      {
+        call.builtin = m_builtins->at(call.name);
+      }
+
+      call.is_member =
+        call.builtin != nullptr && call.name.view() == "internal.member_2";
+      call.is_checked = false;
     }
 
-    auto maybe_index = m_bundle->find_plan(entrypoint);
-    if (!maybe_index.has_value())
+    classify_functions();
+
+    if (m_builtins == nullptr)
     {
-      logging::Error() << "Plan not found for entrypoint: "
+      return;
+    }
+
+    // Arity and deprecation depend only on the call site, so they are
+    // checked here once. Call sites which fail the checks are left to
+    // BuiltInsDef::call at evaluation time, which reports the error.
+    for (const Instruction& inst : m_code)
+    {
+      if (inst.type != b::StatementType::Call)
+      {
+        continue;
+      }
+
+      CallTarget& call = m_calls[inst.call];
+      if (call.builtin == nullptr)
+      {
+        continue;
+      }
+
+      std::size_t num_args = inst.stmt->ext->call().ops.size();
+      call.is_checked =
+        (call.builtin->arity == builtins::AnyArity ||
+         call.builtin->arity == num_args) &&
+        !m_builtins->is_deprecated(RegoVersion, call.name);
+    }
+  }
+
+  void VirtualMachine::classify_functions()
+  {
+    std::size_t num_functions =
+      m_bundle == nullptr ? 0 : m_bundle->functions.size();
+    {
+      std::unique_lock<std::shared_mutex> lock(m_shared_results_mutex);
+      m_shared_results.assign(num_functions, nullptr);
+    }
+
+    // A function is pure if it calls only deterministic built-ins and other
+    // pure functions, and so within one evaluation always returns the same
+    // result for the same arguments. It is also input-independent if
+    // neither it nor any function it calls reads the input. Functions are
+    // ruled out until none of their callees is.
+    std::vector<bool> pure(num_functions, true);
+    std::vector<bool> independent(num_functions, true);
+    std::vector<std::vector<std::uint32_t>> callees(num_functions);
+    for (std::uint32_t f = 0; f < num_functions; ++f)
+    {
+      std::vector<Range> pending{m_function_blocks[f]};
+      while (!pending.empty() && pure[f])
+      {
+        Range blocks = pending.back();
+        pending.pop_back();
+        for (std::uint32_t b = blocks.begin; b < blocks.end; ++b)
+        {
+          const Range& block = m_blocks[b];
+          for (std::uint32_t i = block.begin; i < block.end; ++i)
+          {
+            const Instruction& inst = m_code[i];
+            bool reads_input = false;
+            if (!classify(inst, callees[f], reads_input))
+            {
+              pure[f] = false;
+              independent[f] = false;
+              break;
+            }
+
+            if (reads_input)
+            {
+              independent[f] = false;
+            }
+
+            if (inst.blocks.end > inst.blocks.begin)
+            {
+              pending.push_back(inst.blocks);
+            }
+          }
+        }
+      }
+    }
+
+    bool changed = true;
+    while (changed)
+    {
+      changed = false;
+      for (std::uint32_t f = 0; f < num_functions; ++f)
+      {
+        for (std::uint32_t callee : callees[f])
+        {
+          if (pure[f] && !pure[callee])
+          {
+            pure[f] = false;
+            changed = true;
+          }
+
+          if (independent[f] && !independent[callee])
+          {
+            independent[f] = false;
+            changed = true;
+          }
+        }
+      }
+    }
+
+    // Functions without arguments are cached by name (and, if they are
+    // input-independent, shared between evaluations). Pure functions with
+    // arguments are memoized by their arguments.
+    m_shared_functions.assign(num_functions, false);
+    m_memo_functions.assign(num_functions, false);
+    for (std::uint32_t f = 0; f < num_functions; ++f)
+    {
+      const b::Function& function = m_bundle->functions[f];
+      m_shared_functions[f] = independent[f] && function.cacheable;
+      m_memo_functions[f] = pure[f] && function.parameters.size() > 2;
+    }
+  }
+
+  bool VirtualMachine::classify(
+    const Instruction& inst,
+    std::vector<std::uint32_t>& callees,
+    bool& reads_input) const
+  {
+    auto is_input = [](const b::Operand& op) {
+      return (op.type == b::OperandType::Local ||
+              op.type == b::OperandType::Index) &&
+        op.index == 0;
+    };
+
+    reads_input = is_input(inst.op0) || is_input(inst.op1);
+
+    if (inst.type == b::StatementType::CallDynamic)
+    {
+      // the function called is not known until evaluation
+      return false;
+    }
+
+    if (inst.type != b::StatementType::Call)
+    {
+      return true;
+    }
+
+    const CallTarget& call = m_calls[inst.call];
+    const std::vector<b::Operand>& ops = inst.stmt->ext->call().ops;
+    if (call.builtin != nullptr)
+    {
+      reads_input =
+        reads_input || std::any_of(ops.begin(), ops.end(), is_input);
+      return call.builtin->deterministic;
+    }
+
+    if (call.function == NoFunction)
+    {
+      return false;
+    }
+
+    // the first two arguments of a bundle function are always the input and
+    // the data, which the function reads from their locals
+    for (std::size_t i = 2; i < ops.size(); ++i)
+    {
+      reads_input = reads_input || is_input(ops[i]);
+    }
+
+    callees.push_back(call.function);
+    return true;
+  }
+
+  Node VirtualMachine::shared_result(std::uint32_t function) const
+  {
+    if (!m_shared_functions[function])
+    {
+      return nullptr;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(m_shared_results_mutex);
+    return m_shared_results[function];
+  }
+
+  void VirtualMachine::put_shared_result(
+    std::uint32_t function, const Node& result) const
+  {
+    std::unique_lock<std::shared_mutex> lock(m_shared_results_mutex);
+    if (m_shared_results[function] == nullptr)
+    {
+      m_shared_results[function] = result;
+    }
+  }
+
+  Bundle VirtualMachine::bundle() const
+  {
+    return m_bundle;
+  }
+
+  VirtualMachine& VirtualMachine::builtins(BuiltIns builtins)
+  {
+    // Linking again would also discard the shared results, so it is skipped
+    // when the same built-ins are given back unchanged.
+    if (
+      builtins != nullptr && builtins == m_builtins &&
+      builtins->generation() == m_builtins_generation)
+    {
+      return *this;
+    }
+
+    m_builtins = builtins;
+    m_builtins_generation = builtins != nullptr ? builtins->generation() : 0;
+    link();
+    return *this;
+  }
+
+  BuiltIns VirtualMachine::builtins() const
+  {
+    return m_builtins;
+  }
+
+  bool VirtualMachine::State::is_in_call_stack(std::uint32_t function) const
+  {
+    return m_in_call[function];
+  }
+
+  void VirtualMachine::State::push_function(
+    std::uint32_t function, const Location& func_name, size_t num_args)
+  {
+    m_call_stack.push_back(&func_name);
+    m_call_functions.push_back(function);
+    m_in_call[function] = true;
+    m_num_args.push_back(num_args);
+  }
+
+  void VirtualMachine::State::pop_function(std::uint32_t function)
+  {
+    assert(m_call_functions.back() == function);
+    m_in_call[function] = false;
+    m_call_stack.pop_back();
+    m_call_functions.pop_back();
+    m_num_args.pop_back();
+  }
+
+  void VirtualMachine::State::put_function_result(
+    const Location& func_name, Node result)
+  {
+    m_function_caches.back()[func_name] = result;
+  }
+
+  Node VirtualMachine::State::get_function_result(
+    const Location& func_name) const
+  {
+    const auto& cache = m_function_caches.back();
+    auto it = cache.find(func_name);
+    if (it == cache.end())
+    {
+      return nullptr;
+    }
+
+    return it->second;
+  }
+
+  const VirtualMachine::FunctionMemo* VirtualMachine::State::find_memo(
+    std::uint32_t function, std::size_t hash, const Node& args) const
+  {
+    auto [begin, end] = m_memo_scopes.back().equal_range(hash);
+    for (auto it = begin; it != end; ++it)
+    {
+      const FunctionMemo& memo = it->second;
+      if (memo.function == function && term_equal(memo.args, args))
+      {
+        return &memo;
+      }
+    }
+
+    return nullptr;
+  }
+
+  void VirtualMachine::State::put_memo(
+    std::size_t hash, FunctionMemo memo, size_t limit)
+  {
+    if (m_memo_count < limit)
+    {
+      m_memo_scopes.back().emplace(hash, std::move(memo));
+      m_memo_count++;
+    }
+  }
+
+  bool VirtualMachine::State::in_with() const
+  {
+    return m_with_count > 0;
+  }
+
+  void VirtualMachine::State::push_with()
+  {
+    // Results computed inside a with statement only hold for its
+    // replacements, so each with statement caches them in a scope of its own.
+    m_with_count++;
+    m_function_caches.emplace_back();
+    m_memo_scopes.emplace_back();
+  }
+
+  void VirtualMachine::State::pop_with()
+  {
+    assert(m_with_count > 0);
+    m_with_count--;
+    m_function_caches.pop_back();
+    m_memo_count -= m_memo_scopes.back().size();
+    m_memo_scopes.pop_back();
+  }
+
+  bool VirtualMachine::State::in_break() const
+  {
+    return m_break_count > 0;
+  }
+
+  void VirtualMachine::State::push_break(size_t levels)
+  {
+    m_break_count += levels;
+  }
+
+  void VirtualMachine::State::pop_break()
+  {
+    assert(m_break_count > 0);
+    m_break_count--;
+  }
+
+  std::string_view VirtualMachine::State::root_function_name() const
+  {
+    if (m_call_stack.empty())
+    {
+      return "<invalid>";
+    }
+
+    std::string_view name = m_call_stack.front()->view();
+    if (name.starts_with("g0.querymodule$"))
+    {
+      if (m_call_stack.size() == 1)
+      {
+        return "<invalid>";
+      }
+
+      name = m_call_stack.at(1)->view();
+    }
+
+    name = name.substr(name.find('.') + 1);
+    return name;
+  }
+
+  void VirtualMachine::State::add_result(Node node)
+  {
+    m_result_set.push_back(node);
+  }
+
+  const Nodes& VirtualMachine::State::result_set() const
+  {
+    return m_result_set;
+  }
+
+  void VirtualMachine::State::add_error(Node node)
+  {
+    m_errors.push_back(node);
+  }
+
+  void VirtualMachine::State::add_error_multiple_output(Node node)
+  {
+    const std::string comp_message =
+      "complete rules must not produce multiple outputs";
+    const std::string func_message =
+      "functions must not produce multiple outputs for same inputs";
+    if (m_num_args.empty() || m_num_args.back() == 2)
+    {
+      add_error(err(node, comp_message, EvalConflictError));
+      return;
+    }
+
+    add_error(err(node, func_message, EvalConflictError));
+  }
+
+  void VirtualMachine::State::add_error_object_insert(Node node)
+  {
+    const std::string message = "object keys must be unique";
+    add_error(err(node, message, EvalConflictError));
+  }
+
+  const Nodes& VirtualMachine::State::errors() const
+  {
+    return m_errors;
+  }
+
+  const Value& VirtualMachine::State::read_local(size_t key) const
+  {
+    assert(key < m_frame.size());
+
+    logging::Trace() << "frame[" << key << "]" << " -> " << m_frame[key];
+    return m_frame[key];
+  }
+
+  void VirtualMachine::State::write_local(size_t key, Value value)
+  {
+    assert(key < m_frame.size());
+
+    if (!value.is_defined())
+    {
+      return reset_local(key);
+    }
+
+    if (value.kind() == Value::Kind::Node && value.node() == nullptr)
+    {
+      logging::Error() << "Attempting to write null value to local: " << key;
+      throw std::runtime_error("Cannot write null value to local variable");
+    }
+
+    logging::Trace() << value << " -> frame[" << key << "]";
+    touch(key);
+    m_frame[key] = std::move(value);
+  }
+
+  void VirtualMachine::State::touch(size_t index)
+  {
+    if (!m_is_touched[index])
+    {
+      m_is_touched[index] = true;
+      m_touched.push_back(static_cast<std::uint32_t>(index));
+    }
+  }
+
+  bool VirtualMachine::State::is_defined(size_t key) const
+  {
+    assert(key < m_frame.size());
+
+    logging::Trace() << "frame[" << key << "]" << " -> " << m_frame[key];
+    return m_frame[key].is_defined();
+  }
+
+  void VirtualMachine::State::reset_local(size_t key)
+  {
+    assert(key < m_frame.size());
+
+    logging::Debug() << "reset frame[" << key << "]";
+    m_frame[key] = Value();
+  }
+
+  Value VirtualMachine::unpack_operand(
+    const State& state, const b::Operand& operand) const
+  {
+    switch (operand.type)
+    {
+      case b::OperandType::Local:
+        return state.read_local(operand.index);
+
+      case b::OperandType::String:
+        assert(operand.index < m_strings.size());
+        return Value::string(m_strings[operand.index].node);
+
+      case b::OperandType::False:
+        return Value::boolean(false);
+
+      case b::OperandType::True:
+        return Value::boolean(true);
+
+      case b::OperandType::Index:
+      case b::OperandType::Value:
+        throw std::runtime_error("Unpacking raw operand");
+
+      case b::OperandType::None:
+        throw std::runtime_error("Uninitialized operand");
+    }
+
+    throw std::runtime_error("Invalid operand");
+  }
+
+  size_t VirtualMachine::State::stmt_count() const
+  {
+    return m_stmt_count;
+  }
+
+  size_t VirtualMachine::State::inc_stmts()
+  {
+    m_stmt_count += 1;
+    return m_stmt_count;
+  }
+
+  size_t VirtualMachine::State::call_depth() const
+  {
+    return m_call_stack.size();
+  }
+
+  size_t VirtualMachine::State::block_depth() const
+  {
+    return m_block_depth;
+  }
+
+  void VirtualMachine::State::enter_block()
+  {
+    m_block_depth += 1;
+  }
+
+  void VirtualMachine::State::leave_block()
+  {
+    assert(m_block_depth > 0 && "leave_block underflow");
+    m_block_depth -= 1;
+  }
+
+  Nodes& VirtualMachine::State::builtin_args()
+  {
+    return m_builtin_args;
+  }
+
+  BuiltInContext& VirtualMachine::State::builtin_context()
+  {
+    return m_builtin_context;
+  }
+
+  VirtualMachine::TermIndex& VirtualMachine::State::term_index(
+    const Node& collection)
+  {
+    auto [it, _] = m_term_indexes.try_emplace(
+      collection.get(),
+      std::make_pair(collection, TermIndex(&m_temporaries)));
+    return it->second.second;
+  }
+
+  const VirtualMachine::CountingResource& VirtualMachine::State::
+    temporaries() const
+  {
+    return m_temporaries;
+  }
+
+  const VirtualMachine::CountingResource& VirtualMachine::State::heap() const
+  {
+    return m_heap;
+  }
+
+  VirtualMachine::TermIndex::TermIndex(std::pmr::memory_resource* resource) :
+    m_positions(resource)
+  {}
+
+  VirtualMachine::CountingResource::CountingResource(
+    std::pmr::memory_resource* upstream) :
+    m_upstream(upstream), m_allocations(0), m_bytes(0)
+  {}
+
+  void VirtualMachine::CountingResource::upstream(
+    std::pmr::memory_resource* upstream)
+  {
+    m_upstream = upstream;
+  }
+
+  std::uint64_t VirtualMachine::CountingResource::allocations() const
+  {
+    return m_allocations;
+  }
+
+  std::uint64_t VirtualMachine::CountingResource::bytes() const
+  {
+    return m_bytes;
+  }
+
+  void VirtualMachine::CountingResource::reset_counts()
+  {
+    m_allocations = 0;
+    m_bytes = 0;
+  }
+
+  void* VirtualMachine::CountingResource::do_allocate(
+    std::size_t bytes, std::size_t alignment)
+  {
+    m_allocations += 1;
+    m_bytes += bytes;
+    return m_upstream->allocate(bytes, alignment);
+  }
+
+  void VirtualMachine::CountingResource::do_deallocate(
+    void* p, std::size_t bytes, std::size_t alignment)
+  {
+    m_upstream->deallocate(p, bytes, alignment);
+  }
+
+  bool VirtualMachine::CountingResource::do_is_equal(
+    const std::pmr::memory_resource& other) const noexcept
+  {
+    return this == &other;
+  }
+
+  void VirtualMachine::TermIndex::sync(const Node& collection)
+  {
+    if (collection->size() < m_size)
+    {
+      // members were removed, so the recorded positions are stale
+      m_positions.clear();
+      m_size = 0;
+    }
+
+    for (; m_size < collection->size(); ++m_size)
+    {
+      Node key = member_key(collection, collection->at(m_size));
+      m_positions.emplace(term_hash(key), m_size);
+    }
+  }
+
+  Node VirtualMachine::TermIndex::find(
+    const Node& collection, const Node& key, std::size_t key_hash) const
+  {
+    auto [begin, end] = m_positions.equal_range(key_hash);
+    for (auto it = begin; it != end; ++it)
+    {
+      Node member = collection->at(it->second);
+      if (term_equal(member_key(collection, member), key))
+      {
+        return member;
+      }
+    }
+
+    return nullptr;
+  }
+
+  std::size_t VirtualMachine::TermIndex::size() const
+  {
+    return m_size;
+  }
+
+  VirtualMachine::State::State(
+    size_t num_locals, size_t num_functions, bool use_arena) :
+    m_heap(std::pmr::new_delete_resource()),
+    m_arena_buffer(use_arena ? InitialArenaSize : 0),
+    m_arena(
+      use_arena ? std::make_unique<std::pmr::monotonic_buffer_resource>(
+                    m_arena_buffer.data(), m_arena_buffer.size(), &m_heap) :
+                  nullptr),
+    m_temporaries(
+      m_arena ? static_cast<std::pmr::memory_resource*>(m_arena.get()) :
+                &m_heap),
+    m_function_caches(&m_temporaries),
+    m_memo_scopes(&m_temporaries),
+    m_memo_count(0),
+    m_with_count(0),
+    m_break_count(0),
+    m_stmt_count(0),
+    m_block_depth(0),
+    m_term_indexes(&m_temporaries)
+  {
+    m_frame.resize(num_locals);
+    m_is_touched.resize(num_locals, false);
+    m_in_call.resize(num_functions, false);
+    m_function_caches.emplace_back();
+    m_memo_scopes.emplace_back();
+  }
+
+  void VirtualMachine::State::begin(Node input, Node data)
+  {
+    write_local(0, input->front());
+    write_local(1, data);
+  }
+
+  void VirtualMachine::State::clear()
+  {
+    for (std::uint32_t index : m_touched)
+    {
+      m_frame[index] = Value();
+      m_is_touched[index] = false;
+    }
+
+    m_touched.clear();
+
+    // an evaluation which threw may have left functions on the call stack
+    for (std::uint32_t function : m_call_functions)
+    {
+      m_in_call[function] = false;
+    }
+
+    m_call_stack.clear();
+    m_call_functions.clear();
+    m_num_args.clear();
+    m_errors.clear();
+    // an evaluation which threw may have left with scopes open
+    m_function_caches.resize(1);
+    m_function_caches.front().clear();
+    m_memo_scopes.resize(1);
+    m_memo_scopes.front().clear();
+    m_memo_count = 0;
+    m_result_set.clear();
+    m_with_count = 0;
+    m_break_count = 0;
+    m_stmt_count = 0;
+    m_block_depth = 0;
+    m_term_indexes.clear();
+    m_builtin_args.clear();
+    m_builtin_context.clear();
+
+    if (m_arena != nullptr)
+    {
+      // The emptied tables still hold their buckets, which must be given up
+      // before the arena is released.
+      TermIndexes(&m_temporaries).swap(m_term_indexes);
+      FunctionCaches(&m_temporaries).swap(m_function_caches);
+      MemoScopes(&m_temporaries).swap(m_memo_scopes);
+      if (m_heap.bytes() > 0)
+      {
+        // the evaluation spilled onto the heap, so grow the arena to fit
+        m_arena.reset();
+        m_arena_buffer.resize(m_arena_buffer.size() + m_heap.bytes());
+        m_arena = std::make_unique<std::pmr::monotonic_buffer_resource>(
+          m_arena_buffer.data(), m_arena_buffer.size(), &m_heap);
+        m_temporaries.upstream(m_arena.get());
+      }
+      else
+      {
+        m_arena->release();
+      }
+
+      m_function_caches.emplace_back();
+      m_memo_scopes.emplace_back();
+    }
+
+    m_temporaries.reset_counts();
+    m_heap.reset_counts();
+  }
+
+  VirtualMachine::StateLease::StateLease(const VirtualMachine& vm) :
+    m_vm(vm), m_in_use(false)
+  {
+    {
+      std::lock_guard<std::mutex> lock(vm.m_state_pool_mutex);
+      if (!vm.m_state_pool.empty())
+      {
+        m_state = std::move(vm.m_state_pool.back());
+        vm.m_state_pool.pop_back();
+      }
+    }
+
+    if (m_state == nullptr)
+    {
+      m_state = std::make_unique<State>(
+        vm.m_bundle->local_count,
+        vm.m_bundle->functions.size(),
+        vm.m_arena_enabled);
+    }
+  }
+
+  VirtualMachine::StateLease::~StateLease()
+  {
+    // cleared now, rather than when next leased, so that the pool does not
+    // keep the values of the evaluation alive
+    if (m_in_use)
+    {
+      m_state->clear();
+    }
+
+    std::lock_guard<std::mutex> lock(m_vm.m_state_pool_mutex);
+    m_vm.m_state_pool.push_back(std::move(m_state));
+  }
+
+  VirtualMachine::State& VirtualMachine::StateLease::begin(Node input)
+  {
+    if (m_in_use)
+    {
+      m_state->clear();
+    }
+
+    m_in_use = true;
+    m_state->begin(input, m_vm.m_bundle->data);
+    return *m_state;
+  }
+
+  Node VirtualMachine::run_query(Node input) const
+  {
+    logging::Debug() << "Input: " << input;
+
+    if (m_bundle == nullptr)
+    {
+      return ErrorSeq << err(Line ^ Location("<query>"), "no bundle loaded");
+    }
+
+    auto maybe_index = m_bundle->query_plan;
+    if (!maybe_index.has_value())
+    {
+      logging::Error() << "Plan not found for query";
+      return ErrorSeq << err(
+               Line ^ Location("<query>"), "query plan not found");
+    }
+
+    // the context covers reading the results as well as the evaluation, as
+    // both look up children by name
+    WFContext context({&wf_bundle, &wf_result});
+    StateLease lease(*this);
+    State& state = lease.begin(input);
+    run_plan(*maybe_index, state);
+
+    if (!state.errors().empty())
+    {
+      return ErrorSeq << state.errors();
+    }
+
+    if (state.result_set().empty())
+    {
+      return Undefined;
+    }
+
+    Node results = NodeDef::create(Results);
+    for (Node result : state.result_set())
+    {
+      Node result_obj = (result->front() / Val)->front();
+
+      Nodes nodes = Resolver::object_lookdown(result_obj, "\"expressions\"");
+      Node terms = NodeDef::create(Terms);
+      if (!nodes.empty())
+      {
+        Node expressions_arr = nodes.front()->front();
+        if (expressions_arr->empty())
+        {
+          continue;
+        }
+
+        for (auto expr : *expressions_arr)
+        {
+          auto maybe_object = unwrap(expr, Object);
+          if (!maybe_object.success)
+          {
+            return ErrorSeq << err(expr, "Expected a results object");
+          }
+
+          Nodes values =
+            Resolver::object_lookdown(maybe_object.node, "\"value\"");
+          if (values.size() != 1)
+          {
+            return ErrorSeq
+              << err(maybe_object.node, "No results in result object");
+          }
+
+          // copied before it leaves the VM, as in entrypoint_results
+          terms << values.front()->clone();
+        }
+      }
+
+      nodes = Resolver::object_lookdown(result_obj, "\"bindings\"");
+      Node bindings = NodeDef::create(Bindings);
+      if (!nodes.empty())
+      {
+        Node bindings_obj = nodes.front()->front();
+        for (Node item : *bindings_obj)
+        {
+          Node binding = Binding << (Var ^ strip_quotes(to_key(item / Key)));
+          binding << (item / Val)->clone();
+          bindings << binding;
+        }
+      }
+
+      results << (Result << terms << bindings);
+    }
+
+    Node ast = Top << results;
+    wf_result.build_st(ast);
+
+    logging::Debug() << "Results: " << results;
+
+    return results;
+  }
+
+  Node VirtualMachine::run_entrypoint(
+    const Location& entrypoint, Node input) const
+  {
+    if (m_bundle == nullptr)
+    {
+      return ErrorSeq << err(Line ^ Location("<query>"), "no bundle loaded");
+    }
+
+    auto maybe_index = m_bundle->find_plan(entrypoint);
+    if (!maybe_index.has_value())
+    {
+      logging::Error() << "Plan not found for entrypoint: "
                        << entrypoint.view();
       return ErrorSeq << err(Line ^ entrypoint, "entrypoint not found");
     }
 
-    if (input != Input)
+    if (input != Input)
+    {
+      logging::Error() << "Input node is not of type Input: " << input;
+      return ErrorSeq << err(input, "Invalid input node");
+    }
+
+    logging::Debug() << "Input: " << input;
+
+    WFContext context({&wf_bundle, &wf_result});
+    StateLease lease(*this);
+    State& state = lease.begin(input);
+    run_plan(*maybe_index, state);
+    return entrypoint_results(state);
+  }
+
+  Nodes VirtualMachine::run_entrypoint_batch(
+    const Location& entrypoint,
+    std::span<const Node> inputs,
+    ThreadPool& pool) const
+  {
+    Nodes outputs(inputs.size());
+    if (m_bundle == nullptr)
+    {
+      for (auto& output : outputs)
+      {
+        output =
+          ErrorSeq << err(Line ^ Location("<query>"), "no bundle loaded");
+      }
+
+      return outputs;
+    }
+
+    auto maybe_index = m_bundle->find_plan(entrypoint);
+    if (!maybe_index.has_value())
+    {
+      logging::Error() << "Plan not found for entrypoint: "
+                       << entrypoint.view();
+      for (auto& output : outputs)
+      {
+        output = ErrorSeq << err(Line ^ entrypoint, "entrypoint not found");
+      }
+
+      return outputs;
+    }
+
+    // each worker keeps one state for all of the inputs it evaluates
+    std::vector<std::optional<StateLease>> leases(pool.size());
+    pool.run(inputs.size(), [&](std::size_t worker, std::size_t index) {
+      const Node& input = inputs[index];
+      if (input != Input)
+      {
+        logging::Error() << "Input node is not of type Input: " << input;
+        outputs[index] = ErrorSeq << err(input, "Invalid input node");
+        return;
+      }
+
+      if (!leases[worker].has_value())
+      {
+        leases[worker].emplace(*this);
+      }
+
+      // the context is per thread, so each worker installs its own around
+      // the evaluation and the reading of its results
+      WFContext context({&wf_bundle, &wf_result});
+      try
+      {
+        State& state = leases[worker]->begin(input);
+        run_plan(*maybe_index, state);
+        outputs[index] = entrypoint_results(state);
+      }
+      catch (const std::exception& e)
+      {
+        outputs[index] = ErrorSeq << err(input, e.what());
+      }
+    });
+
+    return outputs;
+  }
+
+  Node VirtualMachine::entrypoint_results(const State& state) const
+  {
+    if (!state.errors().empty())
+    {
+      return ErrorSeq << state.errors();
+    }
+
+    if (state.result_set().empty())
+    {
+      return Undefined;
+    }
+
+    Node results = NodeDef::create(Results);
+    for (Node result : state.result_set())
+    {
+      auto maybe_object = unwrap(result, Object);
+      if (!maybe_object.success)
+      {
+        return ErrorSeq << err(result, "Expected a result object");
+      }
+
+      Nodes values = Resolver::object_lookdown(maybe_object.node, "\"result\"");
+      if (values.size() != 1)
+      {
+        return ErrorSeq << err(
+                 maybe_object.node, "No result values in result object");
+      }
+
+      // the result may share members with the bundle data, the shared
+      // results and the function caches, so it is copied before it leaves
+      // the VM
+      results << (Result << (Terms << values.front()->clone()) << Bindings);
+    }
+
+    Node ast = Top << results;
+    wf_result.build_st(ast);
+
+    logging::Debug() << "Results: " << results;
+
+    return results;
+  }
+
+  const std::vector<std::uint32_t>* VirtualMachine::guarded_blocks(
+    State& state, const RuleIndex& index) const
+  {
+    static const std::vector<std::uint32_t> none;
+    Value input = state.read_local(0);
+    if (!input.is_defined())
     {
-      logging::Error() << "Input node is not of type Input: " << input;
-      return ErrorSeq << err(input, "Invalid input node");
+      return &none;
     }
 
-    logging::Debug() << "Input: " << input;
+    Node node = input.to_node();
+    for (std::uint32_t key : index.path)
+    {
+      const InternedString& string = m_strings[key];
+      node = dot(state, node, string.node, string.hash);
+      if (node == nullptr)
+      {
+        return &none;
+      }
+    }
+
+    Value value(node);
+    std::string_view text;
+    if (value.kind() == Value::Kind::String)
+    {
+      text = value.string_value().view();
+    }
+    else if (value.kind() == Value::Kind::Node && value.node() == JSONString)
+    {
+      text = value.node()->location().view();
+    }
+    else if (
+      (value.kind() != Value::Kind::Node &&
+       value.kind() != Value::Kind::Undefined) ||
+      (value.kind() == Value::Kind::Node &&
+       value.node()->in({Int, Float, Object, Array, Set})))
+    {
+      // not a string, and so equal to none of the constants
+      return &none;
+    }
+    else
+    {
+      return nullptr;
+    }
 
-    State state(input, m_bundle->data, m_bundle->local_count);
-    run_plan(m_bundle->plans[*maybe_index], state);
+    if (text.find('\\') != std::string_view::npos)
+    {
+      return nullptr;
+    }
 
-    if (!state.errors().empty())
+    auto it = index.guarded.find(text);
+    if (it == index.guarded.end())
     {
-      return ErrorSeq << state.errors();
+      return &none;
+    }
+
+    return &it->second;
+  }
+
+  template <typename F>
+  void VirtualMachine::for_each_block(
+    State& state, const Range& blocks, std::uint32_t rule_index, F&& run) const
+  {
+    const std::vector<std::uint32_t>* guarded = nullptr;
+    if (rule_index != NoRuleIndex)
+    {
+      guarded = guarded_blocks(state, m_rule_indexes[rule_index]);
+    }
+
+    if (guarded == nullptr)
+    {
+      for (std::uint32_t i = blocks.begin; i < blocks.end; ++i)
+      {
+        if (!run(m_blocks[i]))
+        {
+          return;
+        }
+      }
+
+      return;
+    }
+
+    // The unguarded blocks and the guarded blocks which may match are run in
+    // order. A guarded block which cannot match would only have reset its
+    // locals, so those are reset wherever blocks are skipped.
+    const RuleIndex& index = m_rule_indexes[rule_index];
+    auto unguarded = index.unguarded.begin();
+    auto matching = guarded->begin();
+    std::uint32_t next = blocks.begin;
+    while (unguarded != index.unguarded.end() || matching != guarded->end())
+    {
+      std::uint32_t block;
+      if (
+        matching == guarded->end() ||
+        (unguarded != index.unguarded.end() && *unguarded < *matching))
+      {
+        block = *unguarded++;
+      }
+      else
+      {
+        block = *matching++;
+      }
+
+      if (block != next)
+      {
+        for (std::uint32_t local : index.resets)
+        {
+          state.reset_local(local);
+        }
+      }
+
+      if (!run(m_blocks[block]))
+      {
+        return;
+      }
+
+      next = block + 1;
+    }
+
+    if (next != blocks.end)
+    {
+      for (std::uint32_t local : index.resets)
+      {
+        state.reset_local(local);
+      }
+    }
+  }
+
+  void VirtualMachine::run_plan(std::size_t plan, State& state) const
+  {
+    BuiltInContext::Scope scope(state.builtin_context());
+
+    const Range& blocks = m_plan_blocks[plan];
+    for (std::uint32_t i = blocks.begin; i < blocks.end; ++i)
+    {
+      if (run_block(state, m_blocks[i]) != Code::Continue)
+      {
+        break;
+      }
+    }
+
+    m_stmts_executed.fetch_add(state.stmt_count(), std::memory_order_relaxed);
+    m_allocations.fetch_add(
+      state.temporaries().allocations(), std::memory_order_relaxed);
+    m_allocated_bytes.fetch_add(
+      state.temporaries().bytes(), std::memory_order_relaxed);
+    m_heap_allocations.fetch_add(
+      state.heap().allocations(), std::memory_order_relaxed);
+    m_heap_bytes.fetch_add(state.heap().bytes(), std::memory_order_relaxed);
+  }
+
+  VirtualMachine::Code VirtualMachine::run_block(
+    State& state, const Range& block) const
+  {
+    // Bound stack growth from pathological block nesting (mirrors call_depth).
+    if (state.block_depth() >= m_max_block_depth)
+    {
+      state.add_error(err(
+        Error,
+        "maximum block recursion depth (" + std::to_string(m_max_block_depth) +
+          ") exceeded",
+        RecursionError));
+      return Code::Error;
     }
 
-    if (state.result_set().empty())
-    {
-      return Undefined;
-    }
+    struct BlockGuard
+    {
+      State& s;
+      BlockGuard(State& st) : s(st)
+      {
+        s.enter_block();
+      }
+      ~BlockGuard()
+      {
+        s.leave_block();
+      }
+    } guard(state);
+
+    // Each handler either moves on to the next instruction with `continue`,
+    // or leaves the block with STOP (or RESULT, for a code which may be
+    // Continue).
+#ifdef REGOCPP_COMPUTED_GOTO
+    // Indexed by bundle::StatementType.
+    static const void* const dispatch[] = {
+      &&op_Nop,           &&op_ArrayAppend,    &&op_AssignInt,
+      &&op_AssignVarOnce, &&op_AssignVar,      &&op_Block,
+      &&op_Break,         &&op_CallDynamic,    &&op_Call,
+      &&op_Dot,           &&op_Equal,          &&op_IsArray,
+      &&op_IsDefined,     &&op_IsObject,       &&op_IsSet,
+      &&op_IsUndefined,   &&op_Len,            &&op_MakeArray,
+      &&op_MakeNull,      &&op_MakeNumberInt,  &&op_MakeNumberRef,
+      &&op_MakeObject,    &&op_MakeSet,        &&op_NotEqual,
+      &&op_Not,           &&op_ObjectInsert,   &&op_ObjectInsertOnce,
+      &&op_ObjectMerge,   &&op_ResetLocal,     &&op_ResultSetAdd,
+      &&op_ReturnLocal,   &&op_Scan,           &&op_SetAdd,
+      &&op_With};
+    static_assert(
+      sizeof(dispatch) / sizeof(dispatch[0]) ==
+      static_cast<std::size_t>(b::StatementType::With) + 1);
+#  define DISPATCH(type) goto* dispatch[static_cast<std::size_t>(type)];
+#  define STMT(name) op_##name
+#else
+#  define DISPATCH(type) switch (type)
+#  define STMT(name) case b::StatementType::name
+#endif
+#define STOP(result) \
+  { \
+    code = (result); \
+    goto stop; \
+  }
+#define RESULT(result) \
+  { \
+    code = (result); \
+    if (code == Code::Continue) \
+    { \
+      continue; \
+    } \
+    goto stop; \
+  }
+
+    Code code = Code::Continue;
+    logging::Debug() << BlockIndent();
+    {
+      logging::LocalIndent indent;
+      const Instruction* first = m_code.data() + block.begin;
+      const Instruction* last = m_code.data() + block.end;
+      for (const Instruction* inst = first; inst != last; ++inst)
+      {
+        std::size_t index = inst - first;
+        if (state.inc_stmts() >= m_stmt_limit)
+        {
+          state.add_error(err(
+            Line ^ inst->stmt->location,
+            "Maximum statement count reached",
+            TimeoutError));
+          code = Code::Timeout;
+          break;
+        }
+
+        logging::Debug() << DebugIdx(index) << *inst->stmt;
+        DISPATCH(inst->type)
+        {
+          STMT(MakeObject):
+            state.write_local(inst->target, NodeDef::create(Object));
+            continue;
+
+          STMT(MakeArray):
+            state.write_local(inst->target, NodeDef::create(Array));
+            continue;
+
+          STMT(MakeSet):
+            state.write_local(inst->target, NodeDef::create(Set));
+            continue;
+
+          STMT(MakeNull):
+            state.write_local(inst->target, Value::null());
+            continue;
+
+          STMT(MakeNumberRef):
+            state.write_local(inst->target, m_numbers[inst->op0.index]);
+            continue;
+
+          STMT(AssignInt):
+          STMT(MakeNumberInt):
+            state.write_local(inst->target, Value::integer(inst->op0.value));
+            continue;
+
+          STMT(Block): {
+            Code block_code = Code::Continue;
+            for_each_block(
+              state, inst->blocks, inst->rule_index, [&](const Range& inner) {
+                Code result = run_block(state, inner);
+                switch (result)
+                {
+                  case Code::Continue:
+                  case Code::Undefined:
+                    return true;
+                  case Code::Return:
+                  case Code::Error:
+                  case Code::Break:
+                  case Code::Timeout:
+                    block_code = result;
+                    return false;
+                  default:
+                    logging::Error() << "Unexpected return code from block: "
+                                     << static_cast<int>(result);
+                    throw std::runtime_error(
+                      "Unexpected return code from block");
+                }
+              });
+            if (block_code != Code::Continue)
+            {
+              STOP(block_code);
+            }
+          }
+          continue;
+
+          STMT(Len): {
+            Node source = unpack_operand(state, inst->op0).to_node();
+            state.write_local(
+              inst->target,
+              Value::integer(static_cast<std::int64_t>(source->size())));
+          }
+          continue;
+
+          STMT(IsObject):
+            if (unpack_operand(state, inst->op0).type() != Object)
+            {
+              STOP(Code::Undefined);
+            }
+            continue;
+
+          STMT(IsArray):
+            if (unpack_operand(state, inst->op0).type() != Array)
+            {
+              STOP(Code::Undefined);
+            }
+            continue;
+
+          STMT(IsSet):
+            if (unpack_operand(state, inst->op0).type() != Set)
+            {
+              STOP(Code::Undefined);
+            }
+            continue;
+
+          STMT(ResetLocal):
+            state.reset_local(inst->target);
+            continue;
+
+          STMT(AssignVarOnce): {
+            Value source = unpack_operand(state, inst->op0);
+            if (!source.is_defined())
+            {
+              continue;
+            }
+
+            if (state.is_defined(inst->target))
+            {
+              if (values_equal(source, state.read_local(inst->target)))
+              {
+                continue;
+              }
+
+              state.add_error_multiple_output(Line ^ inst->stmt->location);
+              STOP(Code::Error);
+            }
+
+            state.write_local(inst->target, source);
+          }
+          continue;
+
+          STMT(IsDefined):
+            if (!state.is_defined(inst->target))
+            {
+              STOP(Code::Undefined);
+            }
+            continue;
+
+          STMT(IsUndefined):
+            if (state.is_defined(inst->target))
+            {
+              STOP(Code::Undefined);
+            }
+            continue;
+
+          STMT(Not): {
+            Code not_code = run_block(state, m_blocks[inst->blocks.begin]);
+            if (not_code == Code::Error || not_code == Code::Timeout)
+            {
+              // Propagate genuine errors (including strict-mode builtin errors)
+              // and timeouts instead of treating them as a failed negation. In
+              // non-strict mode a builtin error has already become Undefined
+              // before reaching here, so `not` still succeeds.
+              logging::Debug() << DebugIdx(index) << "NotStmt() -> propagate";
+              STOP(not_code);
+            }
+            if (not_code != Code::Undefined)
+            {
+              logging::Debug() << DebugIdx(index) << "NotStmt() -> Undefined";
+              STOP(Code::Undefined);
+            }
+            logging::Debug() << DebugIdx(index) << "NotStmt() -> Continue";
+            continue;
+          }
+
+          STMT(ReturnLocal):
+            STOP(Code::Return);
+
+          STMT(ObjectInsert): {
+            Node key = unpack_operand(state, inst->op0).to_node();
+            Node value = unpack_operand(state, inst->op1).to_node();
+            Node object = state.read_local(inst->target).to_node();
+            if (object != nullptr)
+            {
+              if (insert_into_object(state, object, key, value, false))
+              {
+                state.add_error_object_insert(Line ^ inst->stmt->location);
+                STOP(Code::Error);
+              }
+            }
+          }
+          continue;
+
+          STMT(ObjectInsertOnce): {
+            Node key = unpack_operand(state, inst->op0).to_node();
+            Node value = unpack_operand(state, inst->op1).to_node();
+            Node object = state.read_local(inst->target).to_node();
+            if (object != nullptr)
+            {
+              if (insert_into_object(state, object, key, value, true))
+              {
+                state.add_error_object_insert(Line ^ inst->stmt->location);
+                STOP(Code::Error);
+              }
+            }
+          }
+          continue;
+
+          STMT(ObjectMerge): {
+            Node a = state.read_local(inst->op0.index).to_node();
+            Node b = state.read_local(inst->op1.index).to_node();
+            Node merged = merge_objects(a, b);
+            state.write_local(inst->target, merged);
+          }
+          continue;
+
+          STMT(ArrayAppend): {
+            Node array = state.read_local(inst->target).to_node();
+            if (array != nullptr)
+            {
+              Value value = unpack_operand(state, inst->op0);
+              if (!value.is_defined())
+              {
+                STOP(Code::Undefined);
+              }
+
+              append_shared(array, to_term(value.to_node()));
+            }
+          }
+          continue;
+
+          STMT(SetAdd): {
+            Node set = state.read_local(inst->target).to_node();
+            if (set != nullptr)
+            {
+              Node value = unpack_operand(state, inst->op0).to_node();
+              if (value == Undefined)
+              {
+                STOP(Code::Undefined);
+              }
+
+              if (find_member(state, set, value) == nullptr)
+              {
+                append_shared(set, to_term(value));
+              }
+            }
+          }
+          continue;
+
+          STMT(Dot): {
+            Node source = unpack_operand(state, inst->op0).to_node();
+            Value key = unpack_operand(state, inst->op1);
+            Node value;
+            if (source == Array && key.kind() == Value::Kind::Int)
+            {
+              // an inline index does not need a key node
+              std::int64_t position = key.int_value();
+              if (
+                position >= 0 &&
+                static_cast<std::size_t>(position) < source->size())
+              {
+                value = source->at(position);
+              }
+            }
+            else if (inst->op1.type == b::OperandType::String)
+            {
+              const InternedString& string = m_strings[inst->op1.index];
+              value = dot(state, source, string.node, string.hash);
+            }
+            else
+            {
+              value = dot(state, source, key.to_node());
+            }
+
+            if (value == nullptr)
+            {
+              logging::Warn()
+                << "Dot operation returned null for source: "
+                << source->location().view() << ", key: " << key;
+              STOP(Code::Undefined);
+            }
+
+            state.write_local(inst->target, value);
+          }
+          continue;
+
+          STMT(AssignVar):
+            state.write_local(inst->target, unpack_operand(state, inst->op0));
+            continue;
+
+          STMT(ResultSetAdd): {
+            Node value = state.read_local(inst->target).to_node();
+            if (value != nullptr)
+            {
+              state.add_result(value);
+            }
+          }
+          continue;
+
+          STMT(Equal): {
+            Value a = unpack_operand(state, inst->op0);
+            Value b = unpack_operand(state, inst->op1);
+            auto maybe_equal = inline_equal(a, b);
+            if (maybe_equal.has_value())
+            {
+              if (!*maybe_equal)
+              {
+                STOP(Code::Undefined);
+              }
+
+              continue;
+            }
+
+            Node result = Resolver::boolinfix(
+              NodeDef::create(Equals), a.to_node(), b.to_node());
+            if (result == False)
+            {
+              STOP(Code::Undefined);
+            }
+          }
+          continue;
+
+          STMT(NotEqual): {
+            Value a = unpack_operand(state, inst->op0);
+            Value b = unpack_operand(state, inst->op1);
+            if (!a.is_defined() || !b.is_defined())
+            {
+              STOP(Code::Undefined);
+            }
+
+            auto maybe_equal = inline_equal(a, b);
+            if (maybe_equal.has_value())
+            {
+              if (*maybe_equal)
+              {
+                STOP(Code::Undefined);
+              }
+
+              continue;
+            }
+
+            Node result = Resolver::boolinfix(
+              NodeDef::create(Equals), a.to_node(), b.to_node());
+            if (result == True)
+            {
+              STOP(Code::Undefined);
+            }
+          }
+          continue;
+
+          STMT(Call):
+            RESULT(run_call(
+              state,
+              m_calls[inst->call],
+              inst->stmt->ext->call().ops,
+              inst->target));
 
-    Node results = NodeDef::create(Results);
-    for (Node result : state.result_set())
-    {
-      auto maybe_object = unwrap(result, Object);
-      if (!maybe_object.success)
-      {
-        return ErrorSeq << err(result, "Expected a result object");
-      }
+          STMT(CallDynamic):
+            RESULT(run_call_dynamic(state, *inst));
 
-      Nodes values = Resolver::object_lookdown(maybe_object.node, "\"result\"");
-      if (values.size() != 1)
-      {
-        return ErrorSeq << err(
-                 maybe_object.node, "No result values in result object");
-      }
+          STMT(Scan):
+            RESULT(run_scan(state, *inst));
 
-      results << (Result << (Terms << values.front()) << Bindings);
-    }
+          STMT(With):
+            RESULT(run_with(state, *inst));
 
-    Node ast = Top << results;
-    wf_result.build_st(ast);
+          STMT(Break):
+            state.push_break(inst->op0.index);
+            STOP(Code::Break);
 
-    logging::Debug() << "Results: " << results;
+          STMT(Nop):
+            continue;
+        }
 
-    return results;
-  }
+        throw std::runtime_error("Invalid statement type");
 
-  void VirtualMachine::run_plan(const b::Plan& plan, State& state) const
-  {
-    WFContext ctx({&wf_bundle, &wf_result});
-    m_builtins->clear();
+      stop:
+        if (code == Code::Break)
+        {
+          state.pop_break();
+          if (state.in_break())
+          {
+            return Code::Break;
+          }
+        }
 
-    for (b::Block block : plan.blocks)
-    {
-      if (run_block(state, block) != Code::Continue)
-      {
         break;
       }
     }
+#undef RESULT
+#undef STOP
+#undef STMT
+#undef DISPATCH
+    logging::Debug() << BlockUndent();
+    return code;
   }
 
-  VirtualMachine::Code VirtualMachine::run_block(
-    State& state, const b::Block& block) const
+  VirtualMachine::Code VirtualMachine::run_builtin(
+    State& state,
+    const CallTarget& call,
+    const std::vector<b::Operand>& args,
+    size_t target) const
   {
-    // Bound stack growth from pathological block nesting (mirrors call_depth).
-    if (state.block_depth() >= m_max_block_depth)
+    // The argument vector is reused across calls, so that calling a
+    // built-in does not allocate once the buffer has grown to fit.
+    Nodes& arg_values = state.builtin_args();
+    arg_values.clear();
+    for (const b::Operand& arg : args)
     {
-      state.add_error(err(
-        Error,
-        "maximum block recursion depth (" + std::to_string(m_max_block_depth) +
-          ") exceeded",
-        RecursionError));
-      return Code::Error;
+      arg_values.push_back(unpack_operand(state, arg).to_node());
     }
 
-    struct BlockGuard
+    Node value;
+    if (call.is_member && arg_values.size() == 2 && arg_values[0] != Error)
     {
-      State& s;
-      BlockGuard(State& st) : s(st)
-      {
-        s.enter_block();
-      }
-      ~BlockGuard()
+      // Set membership (`x in s`) is answered from the term index rather
+      // than by the builtin's linear scan.
+      auto maybe_set = unwrap(arg_values[1], Set);
+      if (maybe_set.success)
       {
-        s.leave_block();
+        bool found =
+          find_member(state, maybe_set.node, arg_values[0]) != nullptr;
+        value = found ? (True ^ "true") : (False ^ "false");
       }
-    } guard(state);
+    }
 
-    Code code = Code::Continue;
-    logging::Debug() << BlockIndent();
+    if (value == nullptr)
     {
-      logging::LocalIndent indent;
-      for (size_t i = 0; i < block.size(); ++i)
+      if (call.is_checked)
       {
-        code = run_stmt(state, i, block[i]);
-        switch (code)
-        {
-          case Code::Continue:
-            continue;
-          case Code::Undefined:
-          case Code::Return:
-          case Code::Error:
-          case Code::Timeout:
-            break;
-          case Code::Break:
-            state.pop_break();
-            if (state.in_break())
-            {
-              return Code::Break;
-            }
-            break;
-          default:
-            logging::Error() << "Unexpected return code from run_stmt: "
-                             << static_cast<int>(code);
-            throw std::runtime_error("Unexpected return code from run_stmt");
-        }
-
-        break;
+        value = m_builtins->call(call.builtin, arg_values);
+      }
+      else
+      {
+        value = m_builtins->call(call.name, RegoVersion, arg_values);
       }
     }
-    logging::Debug() << BlockUndent();
-    return code;
+
+    arg_values.clear();
+
+    state.write_local(target, value);
+    if (value == Error)
+    {
+      state.add_error(value);
+      return Code::Error;
+    }
+
+    return Code::Continue;
   }
 
   VirtualMachine::Code VirtualMachine::run_call(
     State& state,
-    const Location& func,
+    const CallTarget& call,
     const std::vector<b::Operand>& args,
     size_t target) const
   {
-    if (state.is_in_call_stack(func))
+    if (call.builtin != nullptr)
     {
-      throw std::runtime_error(
-        "Recursion detected in rule body: " +
-        std::string(state.root_function_name()));
+      return run_builtin(state, call, args, target);
     }
 
-    if (m_builtins->is_builtin(func))
+    if (call.function == NoFunction)
     {
-      Nodes arg_values;
-      std::transform(
-        args.begin(),
-        args.end(),
-        std::back_inserter(arg_values),
-        [this, state](const b::Operand& arg) {
-          return unpack_operand(state, arg);
-        });
-
-      Node value = m_builtins->call(func, {"v1"}, arg_values);
-      state.write_local(target, value);
-      if (value == Error)
-      {
-        state.add_error(value);
-        return Code::Error;
-      }
-
-      return Code::Continue;
+      throw std::runtime_error(
+        "Function not found: " + std::string(call.name.view()));
     }
 
-    auto maybe_index = m_bundle->find_function(func);
-    if (!maybe_index.has_value())
+    if (state.is_in_call_stack(call.function))
     {
       throw std::runtime_error(
-        "Function not found: " + std::string(func.view()));
+        "Recursion detected in rule body: " +
+        std::string(state.root_function_name()));
     }
 
-    const b::Function& function = m_bundle->functions[*maybe_index];
+    const b::Function& function = m_bundle->functions[call.function];
     Node cached_result = state.get_function_result(function.name);
+    if (cached_result == nullptr && !state.in_with())
+    {
+      cached_result = shared_result(call.function);
+    }
+
     if (cached_result != nullptr)
     {
       state.write_local(target, cached_result);
@@ -660,485 +2747,256 @@ namespace rego
       assert(false && "VM invariant: call arity >= parameter count");
       state.add_error(err(
         Error,
-        "internal: call arity mismatch for '" + std::string(func.view()) +
+        "internal: call arity mismatch for '" + std::string(call.name.view()) +
           "' (bundle was not verified)",
         EvalBuiltInError));
       return Code::Error;
-    }
-
-    for (size_t i = 2; i < function.parameters.size(); ++i)
-    {
-      state.write_local(function.parameters[i], unpack_operand(state, args[i]));
-    }
-
-    // Implementation-defined call-depth guard.
-    //
-    // OPA itself does not impose a maximum call depth, but the rego-cpp
-    // interpreter recurses through the C++ stack on every user-function
-    // call. A bundle with a long chain of mutually recursive functions
-    // (each distinct, so the existing is_in_call_stack check does not
-    // fire) could otherwise overflow the stack and crash the host.
-    //
-    // The default of 512 frames is sized for the smallest typical
-    // platform thread stack (Windows: 1 MiB) with headroom for
-    // sanitiser builds, while remaining well above any depth
-    // observed in the OPA conformance suite. Embedders on platforms
-    // with larger stacks (Linux/macOS: 8 MiB) may safely raise this
-    // via VirtualMachine::max_call_depth(size_t) /
-    // Interpreter::max_call_depth(size_t) if their workloads need
-    // deeper chains.
-    if (state.call_depth() >= m_max_call_depth)
-    {
-      state.add_error(err(
-        Error,
-        "interpreter stack-depth limit exceeded: "
-        "maximum function call depth (" +
-          std::to_string(m_max_call_depth) +
-          ") reached. This is an implementation limit on C++ stack "
-          "growth, not a Rego rule-recursion cycle; "
-          "raise via Interpreter::max_call_depth(size_t).",
-        RecursionError));
-      return Code::Error;
-    }
-
-    state.push_function(func, function.arity);
-
-    Code code;
-
-    // Run the function's block
-    for (const b::Block& block : function.blocks)
-    {
-      code = run_block(state, block);
-      if (code == Code::Return)
-      {
-        break;
-      }
-
-      if (code == Code::Break)
-      {
-        break;
-      }
-
-      if (code == Code::Error)
-      {
-        break;
-      }
-    }
-
-    state.pop_function(func);
-
-    if (code == Code::Return)
-    {
-      Node value = state.read_local(function.result);
-      state.write_local(target, value);
-      if (function.cacheable && !state.in_with())
-      {
-        state.put_function_result(function.name, value);
-      }
-
-      if (value == Error)
-      {
-        state.add_error(value);
-        return Code::Error;
-      }
-
-      return Code::Continue;
-    }
-
-    if (code == Code::Break)
-    {
-      return code;
-    }
-
-    return Code::Undefined;
-  }
-
-  VirtualMachine::Code VirtualMachine::run_stmt(
-    State& state, size_t index, const b::Statement& stmt) const
-  {
-    if (state.inc_stmts() >= m_stmt_limit)
-    {
-      state.add_error(err(
-        Line ^ stmt.location, "Maximum statement count reached", TimeoutError));
-      return Code::Timeout;
-    }
-
-    logging::Debug() << DebugIdx(index) << stmt;
-    switch (stmt.type)
-    {
-      case b::StatementType::MakeObject:
-        state.write_local(stmt.target, NodeDef::create(Object));
-        break;
-
-      case b::StatementType::MakeArray:
-        state.write_local(stmt.target, NodeDef::create(Array));
-        break;
-
-      case b::StatementType::MakeSet:
-        state.write_local(stmt.target, NodeDef::create(Set));
-        break;
-
-      case b::StatementType::MakeNull:
-        state.write_local(stmt.target, NodeDef::create(Null));
-        break;
-
-      case b::StatementType::MakeNumberRef: {
-        const Location& num_value = m_bundle->strings[stmt.op0.index];
-        if (TRegex::FullMatch(num_value.view(), m_int_regex))
-        {
-          state.write_local(stmt.target, Int ^ num_value);
-        }
-        else
-        {
-          state.write_local(stmt.target, Float ^ num_value);
-        }
-      }
-      break;
-
-      case b::StatementType::AssignInt:
-      case b::StatementType::MakeNumberInt:
-        state.write_local(stmt.target, Int ^ std::to_string(stmt.op0.value));
-        break;
-
-      case b::StatementType::Block:
-        for (const b::Block& block : stmt.ext->blocks())
-        {
-          Code code = run_block(state, block);
-          switch (code)
-          {
-            case Code::Continue:
-            case Code::Undefined:
-              continue;
-            case Code::Return:
-            case Code::Error:
-            case Code::Break:
-            case Code::Timeout:
-              return code;
-            default:
-              logging::Error() << "Unexpected return code from block: "
-                               << static_cast<int>(code);
-              throw std::runtime_error("Unexpected return code from block");
-          }
-        }
-        break;
-
-      case b::StatementType::Len: {
-        Node source = unpack_operand(state, stmt.op0);
-        Node len = Int ^ std::to_string(source->size());
-        state.write_local(stmt.target, Term << (Scalar << len));
-      }
-      break;
-
-      case b::StatementType::IsObject:
-        if (unpack_operand(state, stmt.op0) != Object)
-        {
-          return Code::Undefined;
-        }
-        break;
-
-      case b::StatementType::IsArray:
-        if (unpack_operand(state, stmt.op0) != Array)
-        {
-          return Code::Undefined;
-        }
-        break;
-
-      case b::StatementType::IsSet:
-        if (unpack_operand(state, stmt.op0) != Set)
-        {
-          return Code::Undefined;
-        }
-        break;
-
-      case b::StatementType::ResetLocal:
-        state.reset_local(stmt.target);
-        break;
-
-      case b::StatementType::AssignVarOnce: {
-        Node source = unpack_operand(state, stmt.op0);
-        if (source == Undefined)
-        {
-          return Code::Continue;
-        }
-
-        if (state.is_defined(stmt.target))
-        {
-          Node existing = state.read_local(stmt.target);
-          std::string lhs = to_key(source);
-          std::string rhs = to_key(existing);
-          if (lhs == rhs)
-          {
-            return Code::Continue;
-          }
-
-          state.add_error_multiple_output(Line ^ stmt.location);
-          return Code::Error;
-        }
-
-        state.write_local(stmt.target, source);
-      }
-      break;
-
-      case b::StatementType::IsDefined:
-        if (!state.is_defined(stmt.target))
-        {
-          return Code::Undefined;
-        }
-        break;
-
-      case b::StatementType::IsUndefined:
-        if (state.is_defined(stmt.target))
-        {
-          return Code::Undefined;
-        }
-        break;
-
-      case b::StatementType::Not: {
-        Code code = run_block(state, stmt.ext->block());
-        if (code == Code::Error || code == Code::Timeout)
-        {
-          // Propagate genuine errors (including strict-mode builtin errors)
-          // and timeouts instead of treating them as a failed negation. In
-          // non-strict mode a builtin error has already become Undefined
-          // before reaching here, so `not` still succeeds.
-          logging::Debug() << DebugIdx(index) << "NotStmt() -> propagate";
-          return code;
-        }
-        if (code != Code::Undefined)
-        {
-          logging::Debug() << DebugIdx(index) << "NotStmt() -> Undefined";
-          return Code::Undefined;
-        }
-        logging::Debug() << DebugIdx(index) << "NotStmt() -> Continue";
-        break;
-      }
-
-      case b::StatementType::ReturnLocal:
-        return Code::Return;
+    }
 
-      case b::StatementType::ObjectInsert: {
-        Node key = unpack_operand(state, stmt.op0);
-        Node value = unpack_operand(state, stmt.op1);
-        Node object = state.read_local(stmt.target);
-        if (object != nullptr)
-        {
-          if (insert_into_object(object, key, value, false))
-          {
-            state.add_error_object_insert(Line ^ stmt.location);
-            return Code::Error;
-          }
-        }
+    // Memoized calls are keyed by the values of their arguments.
+    Node memo_args;
+    std::size_t memo_hash = 0;
+    if (m_memo_limit > 0 && m_memo_functions[call.function])
+    {
+      memo_args = NodeDef::create(Array);
+      for (size_t i = 2; i < function.parameters.size(); ++i)
+      {
+        append_shared(memo_args, unpack_operand(state, args[i]).to_node());
       }
-      break;
 
-      case b::StatementType::ObjectInsertOnce: {
-        Node key = unpack_operand(state, stmt.op0);
-        Node value = unpack_operand(state, stmt.op1);
-        Node object = state.read_local(stmt.target);
-        if (object != nullptr)
+      memo_hash = term_hash(memo_args);
+      const FunctionMemo* memo =
+        state.find_memo(call.function, memo_hash, memo_args);
+      if (memo != nullptr)
+      {
+        if (memo->result == nullptr)
         {
-          if (insert_into_object(object, key, value, true))
-          {
-            state.add_error_object_insert(Line ^ stmt.location);
-            return Code::Error;
-          }
+          return Code::Undefined;
         }
-      }
-      break;
-
-      case b::StatementType::ObjectMerge: {
-        Node a = state.read_local(stmt.op0.index);
-        Node b = state.read_local(stmt.op1.index);
-        Node merged = merge_objects(a, b);
-        state.write_local(stmt.target, merged);
-      }
-      break;
-
-      case b::StatementType::ArrayAppend: {
-        Node array = state.read_local(stmt.target);
-        if (array != nullptr)
-        {
-          Node value = unpack_operand(state, stmt.op0);
-          if (value == Undefined)
-          {
-            return Code::Undefined;
-          }
 
-          array << to_term(value);
-        }
+        state.write_local(target, memo->result);
+        return Code::Continue;
       }
-      break;
+    }
 
-      case b::StatementType::SetAdd: {
-        Node set = state.read_local(stmt.target);
-        if (set != nullptr)
-        {
-          Node value = unpack_operand(state, stmt.op0);
-          if (value == Undefined)
-          {
-            return Code::Undefined;
-          }
+    for (size_t i = 2; i < function.parameters.size(); ++i)
+    {
+      state.write_local(function.parameters[i], unpack_operand(state, args[i]));
+    }
 
-          // TODO need a better intermediate representation for sets
-          std::set<std::string> members;
-          std::transform(
-            set->begin(),
-            set->end(),
-            std::inserter(members, members.end()),
-            [](const Node& item) { return to_key(item); });
-          if (members.find(to_key(value)) == members.end())
-          {
-            set << to_term(value);
-          }
-        }
-      }
-      break;
+    // Implementation-defined call-depth guard.
+    //
+    // OPA itself does not impose a maximum call depth, but the rego-cpp
+    // interpreter recurses through the C++ stack on every user-function
+    // call. A bundle with a long chain of mutually recursive functions
+    // (each distinct, so the existing is_in_call_stack check does not
+    // fire) could otherwise overflow the stack and crash the host.
+    //
+    // The default of 512 frames is sized for the smallest typical
+    // platform thread stack (Windows: 1 MiB) with headroom for
+    // sanitiser builds, while remaining well above any depth
+    // observed in the OPA conformance suite. Embedders on platforms
+    // with larger stacks (Linux/macOS: 8 MiB) may safely raise this
+    // via VirtualMachine::max_call_depth(size_t) /
+    // Interpreter::max_call_depth(size_t) if their workloads need
+    // deeper chains.
+    if (state.call_depth() >= m_max_call_depth)
+    {
+      state.add_error(err(
+        Error,
+        "interpreter stack-depth limit exceeded: "
+        "maximum function call depth (" +
+          std::to_string(m_max_call_depth) +
+          ") reached. This is an implementation limit on C++ stack "
+          "growth, not a Rego rule-recursion cycle; "
+          "raise via Interpreter::max_call_depth(size_t).",
+        RecursionError));
+      return Code::Error;
+    }
 
-      case b::StatementType::Dot: {
-        Node source = unpack_operand(state, stmt.op0);
-        Node key = unpack_operand(state, stmt.op1);
-        Node value = dot(source, key);
-        if (value == nullptr)
-        {
-          logging::Warn() << "Dot operation returned null for source: "
-                          << source->location().view()
-                          << ", key: " << key->location().view();
-          return Code::Undefined;
-        }
+    state.push_function(call.function, function.name, function.arity);
 
-        state.write_local(stmt.target, value);
-      }
-      break;
+    Code code = Code::Undefined;
 
-      case b::StatementType::AssignVar:
-        state.write_local(stmt.target, unpack_operand(state, stmt.op0));
-        break;
+    // Run the function's blocks
+    for_each_block(
+      state,
+      m_function_blocks[call.function],
+      m_function_rule_indexes[call.function],
+      [&](const Range& block) {
+        code = run_block(state, block);
+        return code != Code::Return && code != Code::Break &&
+          code != Code::Error;
+      });
 
-      case b::StatementType::ResultSetAdd: {
-        Node value = state.read_local(stmt.target);
-        if (value != nullptr)
-        {
-          state.add_result(value);
-        }
-      }
-      break;
+    state.pop_function(call.function);
 
-      case b::StatementType::Equal: {
-        Node a = unpack_operand(state, stmt.op0);
-        Node b = unpack_operand(state, stmt.op1);
-        Node result = Resolver::boolinfix(NodeDef::create(Equals), a, b);
-        if (result == False)
+    if (code == Code::Return)
+    {
+      Value value = state.read_local(function.result);
+      state.write_local(target, value);
+      if (function.cacheable)
+      {
+        Node result = value.to_node();
+        state.put_function_result(function.name, result);
+        if (
+          m_shared_functions[call.function] && !state.in_with() &&
+          result != Error)
         {
-          return Code::Undefined;
+          put_shared_result(call.function, result);
         }
       }
-      break;
 
-      case b::StatementType::NotEqual: {
-        Node a = unpack_operand(state, stmt.op0);
-        Node b = unpack_operand(state, stmt.op1);
-        if (a == Undefined || b == Undefined)
-        {
-          return Code::Undefined;
-        }
-        Node result = Resolver::boolinfix(NodeDef::create(Equals), a, b);
-        if (result == True)
-        {
-          return Code::Undefined;
-        }
+      if (memo_args != nullptr && value.type() != Error)
+      {
+        state.put_memo(
+          memo_hash,
+          {call.function, memo_args, value.to_node()},
+          m_memo_limit);
       }
-      break;
 
-      case b::StatementType::Call: {
-        const b::CallExt& call = stmt.ext->call();
-        return run_call(state, call.func, call.ops, stmt.target);
+      if (value.type() == Error)
+      {
+        state.add_error(value.node());
+        return Code::Error;
       }
 
-      case b::StatementType::CallDynamic: {
-        const b::CallDynamicExt& call_dynamic = stmt.ext->call_dynamic();
-        bool found = false;
-        size_t valid_index = 0;
-        std::ostringstream path_buf;
-        Location func;
-        path_buf << "g0";
-        for (size_t i = 0; i < call_dynamic.path.size(); ++i)
-        {
-          path_buf << "."
-                   << strip_quotes(
-                        to_key(unpack_operand(state, call_dynamic.path[i])));
-
-          if (m_bundle->is_function(path_buf.str()))
-          {
-            func = path_buf.str();
-            logging::Trace() << "dynamic path: " << func.view();
-            valid_index = i;
-            found = true;
-          }
-        }
+      return Code::Continue;
+    }
 
-        if (!found)
-        {
-          // No rule matched this dynamic path; Undefined runs OPA's fallback.
-          logging::Trace() << "CallDynamic: no function matched path "
-                           << path_buf.str();
-          return Code::Undefined;
-        }
+    if (code == Code::Break)
+    {
+      return code;
+    }
 
-        Code code = run_call(state, func, call_dynamic.ops, stmt.target);
-        if (
-          valid_index == call_dynamic.path.size() - 1 || code != Code::Continue)
-        {
-          return code;
-        }
+    if (
+      memo_args != nullptr &&
+      (code == Code::Undefined || code == Code::Continue))
+    {
+      state.put_memo(
+        memo_hash, {call.function, memo_args, nullptr}, m_memo_limit);
+    }
 
-        Node value = state.read_local(stmt.target);
-        for (size_t i = valid_index + 1; i < call_dynamic.path.size(); ++i)
-        {
-          Node key = unpack_operand(state, call_dynamic.path[i]);
-          value = dot(value, key);
-          if (value == nullptr)
-          {
-            logging::Warn() << "Dot operation returned null path operand: "
-                            << key->location().view();
-            return Code::Undefined;
-          }
-        }
+    return Code::Undefined;
+  }
 
-        state.write_local(stmt.target, value);
-        return Code::Continue;
+  VirtualMachine::Code VirtualMachine::run_call_dynamic(
+    State& state, const Instruction& inst) const
+  {
+    const b::CallDynamicExt& call_dynamic = inst.stmt->ext->call_dynamic();
+    bool found = false;
+    size_t valid_index = 0;
+    std::ostringstream path_buf;
+    CallTarget call{{}, nullptr, NoFunction, false, false};
+    path_buf << "g0";
+    for (size_t i = 0; i < call_dynamic.path.size(); ++i)
+    {
+      const b::Operand& segment = call_dynamic.path[i];
+      path_buf << ".";
+      if (segment.type == b::OperandType::String)
+      {
+        path_buf << m_strings[segment.index].text;
+      }
+      else
+      {
+        path_buf << strip_quotes(
+          to_key(unpack_operand(state, segment).to_node()));
       }
 
-      case b::StatementType::Scan:
-        return run_scan(state, stmt);
+      auto maybe_index = m_bundle->find_function(path_buf.str());
+      if (maybe_index.has_value())
+      {
+        call.function = static_cast<std::uint32_t>(*maybe_index);
+        call.name = m_bundle->functions[*maybe_index].name;
+        logging::Trace() << "dynamic path: " << call.name.view();
+        valid_index = i;
+        found = true;
+      }
+    }
 
-      case b::StatementType::With:
-        return run_with(state, stmt);
+    if (!found)
+    {
+      // No rule matched this dynamic path; Undefined runs OPA's fallback.
+      logging::Trace() << "CallDynamic: no function matched path "
+                       << path_buf.str();
+      return Code::Undefined;
+    }
 
-      case b::StatementType::Break:
-        state.push_break(stmt.op0.index);
-        return Code::Break;
+    Code code = run_call(state, call, call_dynamic.ops, inst.target);
+    if (
+      valid_index == call_dynamic.path.size() - 1 || code != Code::Continue)
+    {
+      return code;
+    }
 
-      case b::StatementType::Nop:
-        break;
+    Node value = state.read_local(inst.target).to_node();
+    for (size_t i = valid_index + 1; i < call_dynamic.path.size(); ++i)
+    {
+      Node key = unpack_operand(state, call_dynamic.path[i]).to_node();
+      value = dot(state, value, key);
+      if (value == nullptr)
+      {
+        logging::Warn() << "Dot operation returned null path operand: "
+                        << key->location().view();
+        return Code::Undefined;
+      }
     }
 
+    state.write_local(inst.target, value);
     return Code::Continue;
   }
 
   VirtualMachine::Code VirtualMachine::run_with(
-    State& state, const b::Statement& stmt) const
+    State& state, const Instruction& inst) const
   {
     state.push_with();
-    Node value = unpack_operand(state, stmt.op0);
-    Node old_value =
-      write_and_swap(state, stmt.target, stmt.ext->with().path, value);
-    Code result = run_block(state, stmt.ext->with().block);
-    state.write_local(stmt.target, old_value);
+    Value value = unpack_operand(state, inst.op0);
+    Value old_value =
+      write_and_swap(state, inst.target, inst.stmt->ext->with().path, value);
+    Code result = run_block(state, m_blocks[inst.blocks.begin]);
+    state.write_local(inst.target, old_value);
     state.pop_with();
     return result;
   }
 
-  Node VirtualMachine::dot(const Node& node, const Node& key) const
+  Node VirtualMachine::find_member(
+    State& state,
+    const Node& collection,
+    const Node& key,
+    std::optional<std::size_t> key_hash) const
+  {
+    if (collection->size() < MinIndexedSize)
+    {
+      for (Node& member : *collection)
+      {
+        if (term_equal(member_key(collection, member), key))
+        {
+          return member;
+        }
+      }
+
+      return nullptr;
+    }
+
+    std::size_t hash = key_hash.has_value() ? *key_hash : term_hash(key);
+    auto it = m_data_indexes.find(collection.get());
+    if (
+      it != m_data_indexes.end() &&
+      it->second.second.size() == collection->size())
+    {
+      return it->second.second.find(collection, key, hash);
+    }
+
+    TermIndex& index = state.term_index(collection);
+    index.sync(collection);
+    return index.find(collection, key, hash);
+  }
+
+  Node VirtualMachine::dot(
+    State& state,
+    const Node& node,
+    const Node& key,
+    std::optional<std::size_t> key_hash) const
   {
     auto maybe_source = unwrap(node, {Object, Array, Set});
     if (!maybe_source.success)
@@ -1151,31 +3009,17 @@ namespace rego
     Node source = maybe_source.node;
     if (source == Object)
     {
-      std::string query_str = to_key(key);
-      for (Node& member : *source)
+      Node member = find_member(state, source, key, key_hash);
+      if (member == nullptr)
       {
-        std::string member_str = to_key(member / Key);
-        if (member_str == query_str)
-        {
-          return member / Val;
-        }
+        return nullptr;
       }
 
-      return nullptr;
+      return member / Val;
     }
     if (source == Set)
     {
-      std::string query_str = to_key(key);
-      for (Node& member : *source)
-      {
-        std::string member_str = to_key(member);
-        if (member_str == query_str)
-        {
-          return member;
-        }
-      }
-
-      return nullptr;
+      return find_member(state, source, key, key_hash);
     }
     else if (source == Array)
     {
@@ -1217,10 +3061,90 @@ namespace rego
     }
   }
 
+  bool VirtualMachine::scan_positions(
+    State& state,
+    const Instruction& inst,
+    const Node& source,
+    std::vector<std::uint32_t>& positions) const
+  {
+    if (inst.scan_key == NoScanKey)
+    {
+      return false;
+    }
+
+    const ScanKey& key = m_scan_keys[inst.scan_key];
+    auto it = m_field_indexes.find({source.get(), key.path});
+    if (it == m_field_indexes.end())
+    {
+      return false;
+    }
+
+    Value value = unpack_operand(state, key.probe.operand);
+    if (!key.probe.path.empty())
+    {
+      if (!value.is_defined())
+      {
+        return false;
+      }
+
+      Node node = value.to_node();
+      for (std::uint32_t step : key.probe.path)
+      {
+        const InternedString& string = m_strings[step];
+        node = dot(state, node, string.node, string.hash);
+        if (node == nullptr)
+        {
+          return false;
+        }
+      }
+
+      value = Value(node);
+    }
+
+    // only strings are indexed, and only those which are not escaped can be
+    // compared by their text
+    std::string_view text;
+    if (value.kind() == Value::Kind::String)
+    {
+      text = value.string_value().view();
+    }
+    else if (value.kind() == Value::Kind::Node && value.node() == JSONString)
+    {
+      text = value.node()->location().view();
+    }
+    else
+    {
+      return false;
+    }
+
+    if (text.find('\\') != std::string_view::npos)
+    {
+      return false;
+    }
+
+    const FieldIndex& index = it->second;
+    auto match = index.positions.find(text);
+    if (match == index.positions.end())
+    {
+      positions = index.escaped;
+    }
+    else
+    {
+      std::merge(
+        match->second.begin(),
+        match->second.end(),
+        index.escaped.begin(),
+        index.escaped.end(),
+        std::back_inserter(positions));
+    }
+
+    return true;
+  }
+
   VirtualMachine::Code VirtualMachine::run_scan(
-    State& state, const b::Statement& stmt) const
+    State& state, const Instruction& inst) const
   {
-    Node source = state.read_local(stmt.target);
+    Node source = state.read_local(inst.target).to_node();
     if (source->in({Int, Float, JSONString, True, False, Null}))
     {
       // non-iterable domain
@@ -1228,25 +3152,30 @@ namespace rego
       return Code::Undefined;
     }
 
-    for (size_t i = 0; i < source->size(); ++i)
+    // a scan for the items with a given value only visits those items
+    std::vector<std::uint32_t> positions;
+    bool is_indexed = scan_positions(state, inst, source, positions);
+    std::size_t count = is_indexed ? positions.size() : source->size();
+    for (size_t n = 0; n < count; ++n)
     {
+      size_t i = is_indexed ? positions[n] : n;
       logging::Trace() << "ScanStmt(index=" << i << ")";
       if (source == Object)
       {
         Node item = source->at(i);
-        state.write_local(stmt.op0.index, item / Key);
-        state.write_local(stmt.op1.index, item / Val);
+        state.write_local(inst.op0.index, item / Key);
+        state.write_local(inst.op1.index, item / Val);
       }
       else if (source == Array)
       {
         state.write_local(
-          stmt.op0.index, Term << (Scalar << (Int ^ std::to_string(i))));
-        state.write_local(stmt.op1.index, source->at(i));
+          inst.op0.index, Value::integer(static_cast<std::int64_t>(i)));
+        state.write_local(inst.op1.index, source->at(i));
       }
       else if (source == Set)
       {
-        state.write_local(stmt.op0.index, source->at(i));
-        state.write_local(stmt.op1.index, source->at(i));
+        state.write_local(inst.op0.index, source->at(i));
+        state.write_local(inst.op1.index, source->at(i));
       }
       else
       {
@@ -1255,7 +3184,7 @@ namespace rego
         throw std::runtime_error("Invalid source type for scan");
       }
 
-      Code code = run_block(state, stmt.ext->block());
+      Code code = run_block(state, m_blocks[inst.blocks.begin]);
       if (code != Code::Continue && code != Code::Undefined)
       {
         return code;
@@ -1265,10 +3194,13 @@ namespace rego
     return Code::Continue;
   }
 
-  Node VirtualMachine::write_and_swap(
-    State& state, size_t key, const std::vector<size_t>& path, Node value) const
+  Value VirtualMachine::write_and_swap(
+    State& state,
+    size_t key,
+    const std::vector<size_t>& path,
+    const Value& value) const
   {
-    Node old_source = state.read_local(key);
+    Value old_source = state.read_local(key);
 
     if (path.size() == 0)
     {
@@ -1276,63 +3208,67 @@ namespace rego
       return old_source;
     }
 
+    // Only the objects along the path are copied. Everything else is shared
+    // with the original value, which is left untouched so that it can be
+    // restored when the with block ends.
     Node source;
-    if (old_source == nullptr || old_source == Undefined)
+    if (old_source.type() == Object)
     {
-      source = NodeDef::create(Object);
+      source = shallow_copy(old_source.node());
     }
     else
     {
-      source = old_source->clone();
+      source = NodeDef::create(Object);
     }
 
     Node current = source;
     for (size_t i = 0; i < path.size(); ++i)
     {
-      const Location& query_str = m_bundle->strings[path[i]];
-
-      if (current != Object)
+      Node query = JSONString ^ m_bundle->strings[path[i]];
+      size_t index = 0;
+      while (
+        index < current->size() &&
+        !term_equal(current->at(index) / Key, query))
       {
-        Node obj = NodeDef::create(Object);
-        current->parent()->replace(current, obj);
-        current = obj;
+        ++index;
       }
 
-      Node child;
-      for (Node& member : *current)
+      Node item;
+      Node next;
+      if (i == path.size() - 1)
+      {
+        item = create_shared(
+          ObjectItem, {to_term(query), to_term(value.to_node())});
+      }
+      else
       {
-        std::string member_str = strip_quotes(to_key(member / Key));
-        if (member_str == query_str.view())
+        if (index < current->size())
         {
-          child = member;
-          break;
+          next = (current->at(index) / Val)->front();
         }
-      }
 
-      if (i == path.size() - 1)
-      {
-        if (child == nullptr)
+        if (next != nullptr && next == Object)
         {
-          current
-            << (ObjectItem << to_term((JSONString ^ query_str))
-                           << to_term(value));
+          next = shallow_copy(next);
         }
         else
         {
-          child->replace_at(1, to_term(value));
+          next = NodeDef::create(Object);
         }
+
+        item = create_shared(ObjectItem, {to_term(query), Term << next});
+      }
+
+      if (index < current->size())
+      {
+        current->replace_at(index, item);
       }
       else
       {
-        if (child == nullptr)
-        {
-          child = ObjectItem << to_term(JSONString ^ query_str)
-                             << to_term(NodeDef::create(Object));
-          current << child;
-        }
-
-        current = (child / Val)->front();
+        current << item;
       }
+
+      current = next;
     }
 
     state.write_local(key, source);
@@ -1379,37 +3315,37 @@ namespace rego
       return err(b, "conflicting values for rule", EvalConflictError);
     }
 
-    std::map<std::string, Node> items;
+    // Items are shared with the inputs rather than cloned; only items whose
+    // values need merging are rebuilt.
+    auto object = NodeDef::create(Object);
+    TermMap<size_t> positions;
     for (auto& item : *lhs_obj)
     {
-      items[to_key(item / Key)] = item->clone();
+      positions[item / Key] = object->size();
+      append_shared(object, item);
     }
 
     for (auto& item : *rhs_obj)
     {
-      std::string key = to_key(item / Key);
-      if (items.contains(key))
+      auto it = positions.find(item / Key);
+      if (it != positions.end())
       {
-        Node merged = merge_objects(items[key] / Val, item / Val, depth + 1);
+        Node existing = object->at(it->second);
+        Node merged = merge_objects(existing / Val, item / Val, depth + 1);
         if (merged == Error)
         {
           return merged;
         }
 
-        items[key] = ObjectItem << (item / Key)->clone() << merged;
+        object->replace_at(
+          it->second, create_shared(ObjectItem, {item / Key, merged}));
       }
       else
       {
-        items[key] = item->clone();
+        append_shared(object, item);
       }
     }
 
-    auto object = NodeDef::create(Object);
-    for (auto& [_, item] : items)
-    {
-      object->push_back(item);
-    }
-
     return Term << object;
   }
 
@@ -1419,18 +3355,18 @@ namespace rego
     Node rhs_set = b;
 
     Node set = NodeDef::create(Set);
-    std::set<std::string> items;
+    TermSet items;
     for (auto& item : *lhs_set)
     {
-      items.insert(to_key(item));
-      set << item;
+      items.insert(item);
+      append_shared(set, item);
     }
 
     for (auto& item : *rhs_set)
     {
-      if (!items.contains(to_key(item)))
+      if (items.insert(item).second)
       {
-        set << item;
+        append_shared(set, item);
       }
     }
 
@@ -1438,7 +3374,11 @@ namespace rego
   }
 
   bool VirtualMachine::insert_into_object(
-    const Node& object, const Node& key, const Node& value, bool once) const
+    State& state,
+    const Node& object,
+    const Node& key,
+    const Node& value,
+    bool once) const
   {
     if (object != Object)
     {
@@ -1447,44 +3387,36 @@ namespace rego
       return true;
     }
 
-    Node existing;
-    std::string insert_key = to_key(key);
-    for (Node item : *object)
-    {
-      std::string existing_key = to_key(item / Key);
-      if (insert_key == existing_key)
-      {
-        existing = item;
-        break;
-      }
-    }
-
+    Node existing = find_member(state, object, key);
     if (existing)
     {
-      if (once)
+      if (once && !term_equal(existing / Val, value))
       {
-        std::string existing_key = to_key(existing / Val);
-        std::string new_key = to_key(value);
-        if (existing_key != new_key)
-        {
-          logging::Error()
-            << "key " << insert_key
-            << " already exists but values do not match: existing="
-            << existing_key << " != new=" << new_key;
-          return true;
-        }
+        logging::Error() << "key " << to_key(key)
+                         << " already exists but values do not match: existing="
+                         << to_key(existing / Val)
+                         << " != new=" << to_key(value);
+        return true;
       }
 
-      existing / Val = to_term(value);
+      // the item may be shared with other collections (including the bundle
+      // data), so it is replaced rather than modified
+      auto it = object->find(existing);
+      object->replace_at(
+        static_cast<std::size_t>(it - object->begin()),
+        create_shared(ObjectItem, {existing / Key, to_term(value)}));
       return false;
     }
 
-    object << (ObjectItem << to_term(key) << to_term(value));
+    object << create_shared(ObjectItem, {to_term(key), to_term(value)});
     return false;
   }
 
   Node VirtualMachine::to_term(const Node& value) const
   {
+    // Values are not modified once they have been placed in a collection, so
+    // they are shared rather than deep-copied (and not re-parented, see
+    // append_shared). Only the Term (and Scalar) wrappers are new.
     if (value == Error)
     {
       return value;
@@ -1492,17 +3424,17 @@ namespace rego
 
     if (value->in({Term}))
     {
-      return value->clone();
+      return value;
     }
 
     if (value->in({Array, Set, Object, Scalar}))
     {
-      return Term << value->clone();
+      return create_shared(Term, {value});
     }
 
     if (value->in({Int, Float, JSONString, True, False, Null}))
     {
-      return Term << (Scalar << value->clone());
+      return Term << create_shared(Scalar, {value});
     }
 
     return err(value, "Not a term");
@@ -1540,4 +3472,44 @@ namespace rego
     m_max_block_depth = depth;
     return *this;
   }
+
+  size_t VirtualMachine::memo_limit() const
+  {
+    return m_memo_limit;
+  }
+
+  VirtualMachine& VirtualMachine::memo_limit(size_t limit)
+  {
+    m_memo_limit = limit;
+    return *this;
+  }
+
+  std::uint64_t VirtualMachine::stmts_executed() const
+  {
+    return m_stmts_executed.load(std::memory_order_relaxed);
+  }
+
+  bool VirtualMachine::arena_enabled() const
+  {
+    return m_arena_enabled;
+  }
+
+  VirtualMachine& VirtualMachine::arena_enabled(bool enabled)
+  {
+    m_arena_enabled = enabled;
+
+    // pooled states were created with the previous setting
+    std::lock_guard<std::mutex> lock(m_state_pool_mutex);
+    m_state_pool.clear();
+    return *this;
+  }
+
+  VirtualMachine::AllocationStats VirtualMachine::allocation_stats() const
+  {
+    return {
+      m_allocations.load(std::memory_order_relaxed),
+      m_allocated_bytes.load(std::memory_order_relaxed),
+      m_heap_allocations.load(std::memory_order_relaxed),
+      m_heap_bytes.load(std::memory_order_relaxed)};
+  }
 }
\ No newline at end of file
@@ -0,0 +1,228 @@
+// Measures virtual machine throughput on the queries of YAML test cases, e.g.
+//
+//   rego_bench aci/aci.yaml cheriot/cheriot.yaml -i 200
+//
+// Each query is compiled and bound once, and then evaluated repeatedly, so
+// the figures reported cover evaluation only. Pass --arena to allocate the
+// index and cache tables of each evaluation from an arena, and compare the
+// heap allocations reported per evaluation (which count those tables only).
+
+#include "rego/rego.hh"
+#include "test_case.h"
+#include "trieste/logging.h"
+
+#include <CLI/CLI.hpp>
+#include <chrono>
+
+namespace logging = trieste::logging;
+
+namespace
+{
+  using namespace rego;
+
+  struct Prepared
+  {
+    Bundle bundle;
+    BuiltIns builtins;
+    Node input;
+  };
+
+  std::optional<Prepared> prepare(
+    const rego_test::TestCase& testcase, std::string& error)
+  {
+    Interpreter interpreter;
+    interpreter.builtins()->register_builtins(
+      rego_test::custom_builtins(testcase.note()));
+
+    std::ostringstream os;
+    Node result = nullptr;
+    for (std::size_t i = 0; i < testcase.modules().size(); ++i)
+    {
+      std::string name = "module" + std::to_string(i) + ".rego";
+      result = interpreter.add_module(name, testcase.modules()[i]);
+      if (result != nullptr)
+      {
+        os << result;
+        error = os.str();
+        return std::nullopt;
+      }
+    }
+
+    if (!testcase.data_path().empty())
+    {
+      result = interpreter.add_data_json_file(testcase.data_path());
+    }
+    else if (testcase.data() != nullptr)
+    {
+      result = interpreter.add_data(testcase.data());
+    }
+
+    if (result == nullptr)
+    {
+      result = interpreter.set_query(testcase.query());
+    }
+
+    if (result == nullptr)
+    {
+      if (!testcase.input_path().empty())
+      {
+        result = interpreter.set_input_json_file(testcase.input_path());
+      }
+      else if (!testcase.input_term().empty())
+      {
+        result = interpreter.set_input_term(testcase.input_term());
+      }
+      else if (testcase.input() != nullptr)
+      {
+        result = interpreter.set_input(testcase.input());
+      }
+    }
+
+    if (result != nullptr)
+    {
+      os << result;
+      error = os.str();
+      return std::nullopt;
+    }
+
+    Node bundle_node = interpreter.build();
+    if (bundle_node == ErrorSeq)
+    {
+      os << bundle_node;
+      error = os.str();
+      return std::nullopt;
+    }
+
+    return Prepared{
+      BundleDef::from_node(bundle_node),
+      interpreter.builtins(),
+      interpreter.input()};
+  }
+}
+
+int main(int argc, char** argv)
+{
+  CLI::App app;
+
+  std::vector<std::filesystem::path> case_paths;
+  app.add_option("case,-c,--case", case_paths, "Test case YAML files")
+    ->required();
+
+  std::size_t iterations = 100;
+  app.add_option(
+    "-i,--iterations", iterations, "Number of evaluations per test case");
+
+  bool arena = false;
+  app.add_flag(
+    "--arena",
+    arena,
+    "Allocate the index and cache tables of evaluations from an arena");
+
+  std::string note_match;
+  app.add_option(
+    "-n,--note",
+    note_match,
+    "Note (or note substring) of specific test to run");
+
+  try
+  {
+    app.parse(argc, argv);
+  }
+  catch (const CLI::ParseError& e)
+  {
+    return app.exit(e);
+  }
+
+  logging::set_log_level_from_string("Output");
+
+  std::uint64_t total_stmts = 0;
+  std::uint64_t total_evals = 0;
+  std::chrono::duration<double> total_elapsed{0};
+  int failures = 0;
+
+  for (auto& path : case_paths)
+  {
+    for (auto& testcase : rego_test::TestCase::load(path))
+    {
+      if (
+        !note_match.empty() &&
+        testcase.note().find(note_match) == std::string::npos)
+      {
+        continue;
+      }
+
+      // cases which are expected to fail do not measure evaluation
+      if (
+        testcase.broken() || testcase.unsupported() ||
+        !testcase.want_error().empty() ||
+        !testcase.want_error_code().empty())
+      {
+        continue;
+      }
+
+      std::string error;
+      auto prepared = prepare(testcase, error);
+      if (!prepared.has_value())
+      {
+        failures++;
+        logging::Error() << "  FAIL: " << testcase.note() << std::endl
+                         << "  " << error;
+        continue;
+      }
+
+      WFContext context(wf_bundle);
+      VirtualMachine vm;
+      vm.bundle(prepared->bundle).builtins(prepared->builtins);
+      vm.arena_enabled(arena);
+
+      // warm up (and check that the query evaluates)
+      Node output = vm.run_query(prepared->input);
+      if (output == ErrorSeq)
+      {
+        failures++;
+        logging::Error() << "  FAIL: " << testcase.note() << std::endl
+                         << "  " << output;
+        continue;
+      }
+
+      std::uint64_t stmts_before = vm.stmts_executed();
+      auto allocs_before = vm.allocation_stats();
+      auto start = std::chrono::steady_clock::now();
+      for (std::size_t i = 0; i < iterations; ++i)
+      {
+        vm.run_query(prepared->input);
+      }
+      auto end = std::chrono::steady_clock::now();
+      const std::chrono::duration<double> elapsed = end - start;
+      std::uint64_t stmts = vm.stmts_executed() - stmts_before;
+      auto allocs = vm.allocation_stats();
+      std::uint64_t heap_allocs =
+        allocs.heap_allocations - allocs_before.heap_allocations;
+      std::uint64_t heap_bytes = allocs.heap_bytes - allocs_before.heap_bytes;
+
+      total_stmts += stmts;
+      total_evals += iterations;
+      total_elapsed += elapsed;
+
+      logging::Output() << "  " << testcase.note() << ": " << std::fixed
+                        << std::setprecision(0)
+                        << (stmts / elapsed.count()) << " stmts/sec, "
+                        << (iterations / elapsed.count()) << " evals/sec, "
+                        << (stmts / iterations) << " stmts/eval, "
+                        << (heap_allocs / iterations) << " allocs/eval ("
+                        << (heap_bytes / iterations) << " bytes)";
+    }
+  }
+
+  if (total_elapsed.count() > 0)
+  {
+    logging::Output() << std::endl
+                      << "total: " << std::fixed << std::setprecision(0)
+                      << (total_stmts / total_elapsed.count())
+                      << " stmts/sec, "
+                      << (total_evals / total_elapsed.count())
+                      << " evals/sec";
+  }
+
+  return failures;
+}
@@ -60,6 +60,12 @@ int main(void)
   regoNode* node = NULL;
   regoBundle* bundle = NULL;
   regoInput* input = NULL;
+  regoInput* batch_inputs[2] = {NULL, NULL};
+  regoOutput* batch_outputs[2] = {NULL, NULL};
+  regoSize batch_threads[3] = {2, 2, 1};
+  regoSize b = 0;
+  regoPreparedQuery* prepared = NULL;
+  regoSize i = 0;
   regoInterpreter* rego = regoNew();
   regoSize size = 0;
   char* buf = NULL;
@@ -264,6 +270,76 @@ int main(void)
     goto error;
   }
 
+  // the second batch reuses the threads of the first, and the third starts
+  // a pool with a different number of threads
+  batch_inputs[0] = input;
+  batch_inputs[1] = input;
+  for (b = 0; b < 3; ++b)
+  {
+    for (i = 0; i < 2; ++i)
+    {
+      if (batch_outputs[i] != NULL)
+      {
+        regoFreeOutput(batch_outputs[i]);
+        batch_outputs[i] = NULL;
+      }
+    }
+
+    err = regoBundleQueryEntrypointBatch(
+      rego,
+      bundle,
+      "objects/sites",
+      batch_inputs,
+      2,
+      batch_threads[b],
+      batch_outputs);
+    if (err != REGO_OK)
+    {
+      goto error;
+    }
+
+    for (i = 0; i < 2; ++i)
+    {
+      err = print_output("Bundle Query Endpoint Batch", batch_outputs[i]);
+      if (err != REGO_OK)
+      {
+        goto error;
+      }
+    }
+  }
+
+  prepared = regoPrepare(rego);
+  if (prepared == NULL)
+  {
+    goto error;
+  }
+
+  regoFreeOutput(output);
+  output = regoPreparedQueryEval(prepared, input);
+  if (output == NULL)
+  {
+    goto error;
+  }
+
+  err = print_output("Prepared Query", output);
+  if (err != REGO_OK)
+  {
+    goto error;
+  }
+
+  regoFreeOutput(output);
+  output = regoPreparedQueryEvalEntrypoint(prepared, "objects/sites", input);
+  if (output == NULL)
+  {
+    goto error;
+  }
+
+  err = print_output("Prepared Query Endpoint", output);
+  if (err != REGO_OK)
+  {
+    goto error;
+  }
+
   goto exit;
 
 error:
@@ -281,11 +357,24 @@ exit:
     regoFreeOutput(output);
   }
 
+  for (i = 0; i < 2; ++i)
+  {
+    if (batch_outputs[i] != NULL)
+    {
+      regoFreeOutput(batch_outputs[i]);
+    }
+  }
+
   if (input != NULL)
   {
     regoFreeInput(input);
   }
 
+  if (prepared != NULL)
+  {
+    regoFreePreparedQuery(prepared);
+  }
+
   if (bundle != NULL)
   {
     regoFreeBundle(bundle);
@@ -106,6 +106,70 @@ f := e["dev"])");
   std::cout << rego.output_to_string(rego.query_bundle(bundle)) << std::endl;
 
   // we can also query bundle entrypoints directly
-  std::cout << rego.output_to_string(rego.query_bundle(bundle, "objects/sites"))
-            << std::endl;
+  std::string sites =
+    rego.output_to_string(rego.query_bundle(bundle, "objects/sites"));
+  std::cout << sites << std::endl;
+
+  // the bundle is now loaded (and verified), so later queries against it
+  // need not load it again
+  std::string reused =
+    rego.output_to_string(rego.query_bundle("objects/sites"));
+  if (!bundle->is_verified() || reused != sites)
+  {
+    rego::logging::Error() << "Reused bundle: expected " << sites << ", got "
+                           << reused;
+    return 1;
+  }
+
+  // if only the input changes between queries, a prepared query avoids
+  // recompiling the policy each time
+  rego::PreparedQuery query = rego.prepare();
+  if (!query->ok())
+  {
+    rego::logging::Error() << query->errors();
+    return 1;
+  }
+
+  for (int b : {20, 30})
+  {
+    rego::Node prepared_input = rego::object(
+      {rego::object_item(rego::string("b"), rego::number(b))});
+    rego.set_input(prepared_input);
+    std::string expected = rego.output_to_string(rego.query_bundle(bundle));
+    std::string actual = rego.output_to_string(query->eval(prepared_input));
+    std::cout << actual << std::endl;
+    if (actual != expected)
+    {
+      rego::logging::Error() << "Prepared query: expected " << expected
+                             << ", got " << actual;
+      return 1;
+    }
+  }
+
+  // the result of an evaluation belongs to the caller, so changing it must
+  // not change the bundle data (or the results of later evaluations)
+  rego::Node first = query->eval(input);
+  std::string expected = rego.output_to_string(first);
+  rego::Nodes pending{first};
+  while (!pending.empty())
+  {
+    rego::Node node = pending.back();
+    pending.pop_back();
+    if (node->in({rego::Array, rego::Object}))
+    {
+      node->erase(node->begin(), node->end());
+      continue;
+    }
+
+    pending.insert(pending.end(), node->begin(), node->end());
+  }
+
+  std::string changed = rego.output_to_string(first);
+  std::string second = rego.output_to_string(query->eval(input));
+  if (changed == expected || second != expected)
+  {
+    rego::logging::Error() << "Prepared query after changing a result: "
+                           << "expected " << expected << ", got " << second;
+    return 1;
+  }
 }
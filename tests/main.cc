@@ -4,7 +4,9 @@
 #include "trieste/logging.h"
 
 #include <CLI/CLI.hpp>
+#include <functional>
 #include <stdexcept>
+#include <thread>
 
 const std::string Green = "\x1b[32m";
 const std::string Cyan = "\x1b[36m";
@@ -313,6 +315,967 @@ int manual_timeout_test(
   return 0;
 }
 
+// Runs a manual test which returns a description of the first failure (or
+// an empty string), and reports it in the same way as the test cases.
+int run_manual_test(
+  const std::string& note, const std::function<std::string()>& test)
+{
+  auto start = std::chrono::steady_clock::now();
+  std::string error = test();
+  auto end = std::chrono::steady_clock::now();
+  const std::chrono::duration<double> elapsed = end - start;
+
+  if (!error.empty())
+  {
+    logging::Error() << Red << "  FAIL: " << Reset << note << std::fixed
+                     << std::setw(62 - note.length()) << std::internal
+                     << std::setprecision(3) << elapsed.count() << " sec"
+                     << std::endl
+                     << "  " << error;
+    return 1;
+  }
+
+  logging::Output() << Green << "  PASS: " << Reset << note << std::fixed
+                    << std::setw(62 - note.length()) << std::internal
+                    << std::setprecision(3) << elapsed.count() << " sec";
+  return 0;
+}
+
+std::string term_identity_error()
+{
+  using namespace rego;
+  Node one = scalar(BigInt(std::int64_t(1)));
+  Node one_float = number(1.0);
+  Node two = scalar(BigInt(std::int64_t(2)));
+  Node lhs = object(
+    {object_item(string("a"), one), object_item(string("b"), set({two, one}))});
+  Node rhs = object(
+    {object_item(string("b"), set({one, two})), object_item(string("a"), one)});
+
+  if (!term_equal(one, one_float) || term_hash(one) != term_hash(one_float))
+  {
+    return "1 and 1.0 are not identical";
+  }
+
+  if (!term_equal(lhs, rhs) || term_hash(lhs) != term_hash(rhs))
+  {
+    return "objects differing only in order are not identical";
+  }
+
+  if (term_equal(string("1"), one))
+  {
+    return "\"1\" is identical to 1";
+  }
+
+  if (term_compare(two, string("1")) >= 0 || term_compare(one, two) >= 0)
+  {
+    return "numbers do not order before strings";
+  }
+
+  if (term_compare(null(), boolean(false)) >= 0)
+  {
+    return "null does not order before false";
+  }
+
+  if (
+    term_compare(array({one, two}), array({two})) >= 0 ||
+    term_compare(array({one}), array({one, two})) >= 0)
+  {
+    return "arrays are not ordered lexicographically";
+  }
+
+  return "";
+}
+
+// Evaluates one bundle on several threads at once (through a single virtual
+// machine) and checks that every evaluation gets the result it would get on
+// its own, with and without the evaluation arena, and through the batch API.
+// Best run in a build configured with -DREGOCPP_SANITIZE=thread.
+std::string concurrency_error()
+{
+  using namespace rego;
+  const std::size_t num_threads = 8;
+  const std::size_t iterations = 50;
+  const Location entrypoint("stress/result");
+
+  Interpreter interpreter;
+  Node error = interpreter.add_module("stress.rego", R"(
+    package stress
+
+    items := [{"id": i, "tags": {"a", "b"}} | some i in numbers.range(1, 40)]
+    evens := {item.id | some item in items; item.id % 2 == 0}
+    lookup := {item.id: item | some item in items}
+    names := [sprintf("%s-%d", [data.prefix, x]) | some x in evens]
+    same_time if time.now_ns() == time.now_ns()
+    same_uuid if uuid.rfc4122("k") == uuid.rfc4122("k")
+
+    result := {
+      "count": count(evens),
+      "item": lookup[input.value],
+      "names": names,
+      "input": input,
+      "data": data.shared,
+      "same_time": same_time,
+      "same_uuid": same_uuid,
+    }
+  )");
+  if (error == nullptr)
+  {
+    error = interpreter.add_data_json(
+      R"({"prefix": "p", "shared": {"values": [1, 2, 3], "flag": true}})");
+  }
+
+  if (error != nullptr)
+  {
+    return to_key(error);
+  }
+
+  interpreter.entrypoints({std::string(entrypoint.view())});
+  Node bundle_node = interpreter.build();
+  if (bundle_node == ErrorSeq)
+  {
+    return to_key(bundle_node);
+  }
+
+  VirtualMachine vm;
+  vm.bundle(BundleDef::from_node(bundle_node))
+    .builtins(interpreter.builtins());
+
+  Nodes inputs;
+  std::vector<std::string> expected;
+  for (std::size_t t = 0; t < num_threads; ++t)
+  {
+    interpreter.set_input_term(
+      "{\"value\": " + std::to_string(t + 1) + ", \"flag\": null}");
+    inputs.push_back(interpreter.input());
+    Node output = vm.run_entrypoint(entrypoint, inputs.back());
+    if (output != Results)
+    {
+      return "single-threaded evaluation failed: " + to_key(output);
+    }
+
+    expected.push_back(to_key(output));
+  }
+
+  // the threads run once with the temporaries on the heap, and once with
+  // them in per-evaluation arenas
+  for (bool arena : {false, true})
+  {
+    vm.arena_enabled(arena);
+    std::vector<std::string> errors(num_threads);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < num_threads; ++t)
+    {
+      // the threads install no WFContext of their own, as run_entrypoint
+      // installs one for each evaluation
+      threads.emplace_back([&, t]() {
+        for (std::size_t i = 0; i < iterations; ++i)
+        {
+          Node output = vm.run_entrypoint(entrypoint, inputs[t]);
+          std::string actual = to_key(output);
+          if (actual != expected[t])
+          {
+            errors[t] = "thread " + std::to_string(t) + ": " + actual +
+              " != " + expected[t];
+            return;
+          }
+        }
+      });
+    }
+
+    for (auto& thread : threads)
+    {
+      thread.join();
+    }
+
+    for (auto& message : errors)
+    {
+      if (!message.empty())
+      {
+        return message;
+      }
+    }
+  }
+
+  // the batch API must return the same results, in input order, on several
+  // pools (and so several worker threads) at once
+  Nodes batch_inputs;
+  for (std::size_t i = 0; i < iterations; ++i)
+  {
+    batch_inputs.push_back(inputs[i % num_threads]);
+  }
+
+  // an input of the wrong type fails on its own
+  const std::size_t bad_index = iterations / 2;
+  batch_inputs[bad_index] = Term << Null;
+
+  std::vector<std::string> errors(2);
+  std::vector<std::thread> callers;
+  for (std::size_t c = 0; c < errors.size(); ++c)
+  {
+    callers.emplace_back([&, c]() {
+      ThreadPool pool(4);
+      if (pool.size() < 2)
+      {
+        errors[c] = "the pool has a single worker";
+        return;
+      }
+
+      Nodes outputs = vm.run_entrypoint_batch(entrypoint, batch_inputs, pool);
+      for (std::size_t i = 0; i < iterations; ++i)
+      {
+        std::string actual = to_key(outputs[i]);
+        if (i == bad_index)
+        {
+          if (outputs[i] != ErrorSeq)
+          {
+            errors[c] = "batch output for a bad input: " + actual;
+            return;
+          }
+
+          continue;
+        }
+
+        if (actual != expected[i % num_threads])
+        {
+          errors[c] = "batch output " + std::to_string(i) + ": " + actual +
+            " != " + expected[i % num_threads];
+          return;
+        }
+      }
+    });
+  }
+
+  for (auto& caller : callers)
+  {
+    caller.join();
+  }
+
+  for (auto& message : errors)
+  {
+    if (!message.empty())
+    {
+      return message;
+    }
+  }
+
+  return "";
+}
+
+// Evaluates an entrypoint repeatedly through one virtual machine, so that
+// each evaluation reuses the pooled state of the one before, and checks that
+// nothing written by an evaluation (locals, partial rule results, function
+// caches) is seen by the next. The bundle and built-ins are set again before
+// each evaluation, as Interpreter::query_bundle does.
+std::string state_reuse_error()
+{
+  using namespace rego;
+  const Location entrypoint("reuse/result");
+
+  Interpreter interpreter;
+  Node error = interpreter.add_module("reuse.rego", R"(
+    package reuse
+
+    default value := 0
+    value := input.v if input.v > 1
+
+    members contains x if some x in input.xs
+    shifted(x) := x + input.v
+    names := [n | some u in input.users; n := u.name]
+
+    result := {
+      "value": value,
+      "members": members,
+      "shifted": shifted(1),
+      "names": names,
+    }
+  )");
+  if (error != nullptr)
+  {
+    return to_key(error);
+  }
+
+  interpreter.entrypoints({std::string(entrypoint.view())});
+  Node bundle_node = interpreter.build();
+  if (bundle_node == ErrorSeq)
+  {
+    return to_key(bundle_node);
+  }
+
+  Bundle bundle = BundleDef::from_node(bundle_node);
+  VirtualMachine vm;
+
+  auto eval = [&](const std::string& input) {
+    interpreter.set_input_term(input);
+    vm.bundle(bundle).builtins(interpreter.builtins());
+    Output output(vm.run_entrypoint(entrypoint, interpreter.input()));
+    if (!output.ok())
+    {
+      return "error: " + to_key(output.node());
+    }
+
+    return to_key(output.expressions()->front());
+  };
+
+  const std::string first =
+    R"({"v": 5, "xs": [1, 2], "users": [{"name": "ann"}, {"name": "bob"}]})";
+  const std::string second = R"({"v": 0, "xs": [3], "users": []})";
+  for (bool arena : {false, true})
+  {
+    vm.arena_enabled(arena);
+    std::string expected_first =
+      R"({"members":<1,2>, "names":["ann","bob"], "shifted":6, "value":5})";
+    std::string expected_second =
+      R"({"members":<3>, "names":[], "shifted":1, "value":0})";
+    for (int i = 0; i < 2; ++i)
+    {
+      std::string result = eval(first);
+      if (result != expected_first)
+      {
+        return "first input: expected " + expected_first + ", got " + result;
+      }
+
+      result = eval(second);
+      if (result != expected_second)
+      {
+        return "second input: expected " + expected_second + ", got " +
+          result;
+      }
+    }
+  }
+
+  return "";
+}
+
+// Checks that the results of rules which depend only on data are computed
+// once and shared between evaluations, and that rules which read the input
+// or call a non-deterministic built-in are still evaluated every time. A
+// custom built-in is not known to be deterministic, so it is treated as
+// non-deterministic.
+std::string shared_results_error()
+{
+  using namespace rego;
+  const Location allow("rbac/allow");
+  const Location now("rbac/now");
+  const Location ticket("rbac/ticket");
+
+  int tickets = 0;
+  BuiltIns builtins = BuiltInsDef::create();
+  builtins->register_builtin(BuiltInDef::create(
+    Location("test.ticket"), 0, [&tickets](const Nodes&) {
+      return Term << (Scalar << (Int ^ std::to_string(++tickets)));
+    }));
+
+  auto build = [&](const std::string& data, Node& bundle_node) {
+    Interpreter interpreter;
+    interpreter.builtins()->register_builtin(builtins->at("test.ticket"));
+    Node error = interpreter.add_module("rbac.rego", R"(
+      package rbac
+
+      grants := {[r, p] | some r, perms in data.roles; some p in perms}
+      now := time.now_ns()
+      ticket := test.ticket()
+
+      default allow := false
+      allow if {
+        some role in input.roles
+        grants[[role, input.perm]]
+      }
+    )");
+    if (error == nullptr)
+    {
+      error = interpreter.add_data_json(data);
+    }
+
+    if (error != nullptr)
+    {
+      return to_key(error);
+    }
+
+    interpreter.entrypoints({"rbac/allow", "rbac/now", "rbac/ticket"});
+    bundle_node = interpreter.build();
+    if (bundle_node == ErrorSeq)
+    {
+      return to_key(bundle_node);
+    }
+
+    return std::string();
+  };
+
+  Interpreter inputs;
+  auto input = [&](const std::string& term) {
+    inputs.set_input_term(term);
+    return inputs.input();
+  };
+
+  VirtualMachine vm;
+  auto eval = [&](const Location& entrypoint, Node value) {
+    Output output(vm.run_entrypoint(entrypoint, value));
+    if (!output.ok())
+    {
+      return "error: " + to_key(output.node());
+    }
+
+    return to_key(output.expressions()->front());
+  };
+
+  Node bundle_node;
+  std::string error =
+    build(R"({"roles": {"admin": ["read", "write"], "guest": ["read"]}})",
+      bundle_node);
+  if (!error.empty())
+  {
+    return error;
+  }
+
+  vm.bundle(BundleDef::from_node(bundle_node)).builtins(builtins);
+
+  Node guest_write = input(R"({"roles": ["guest"], "perm": "write"})");
+  Node admin_write = input(R"({"roles": ["admin"], "perm": "write"})");
+
+  std::uint64_t before = vm.stmts_executed();
+  std::string result = eval(allow, guest_write);
+  std::uint64_t first = vm.stmts_executed() - before;
+  if (result != "false")
+  {
+    return "guest write: " + result;
+  }
+
+  before = vm.stmts_executed();
+  result = eval(allow, guest_write);
+  std::uint64_t second = vm.stmts_executed() - before;
+  if (result != "false")
+  {
+    return "guest write (again): " + result;
+  }
+
+  result = eval(allow, admin_write);
+  if (result != "true")
+  {
+    return "admin write: " + result;
+  }
+
+  if (second >= first)
+  {
+    return "grants was recomputed (" + std::to_string(second) +
+      " statements, first evaluation " + std::to_string(first) + ")";
+  }
+
+  std::string now0 = eval(now, input("{}"));
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  std::string now1 = eval(now, input("{}"));
+  if (now0 == now1)
+  {
+    return "time.now_ns() was shared between evaluations";
+  }
+
+  std::string ticket0 = eval(ticket, input("{}"));
+  std::string ticket1 = eval(ticket, input("{}"));
+  if (ticket0 == ticket1)
+  {
+    return "test.ticket() was shared between evaluations (" + ticket0 + ")";
+  }
+
+  // binding a bundle with new data discards the shared results
+  error = build(R"({"roles": {"guest": ["read", "write"]}})", bundle_node);
+  if (!error.empty())
+  {
+    return error;
+  }
+
+  vm.bundle(BundleDef::from_node(bundle_node));
+  result = eval(allow, guest_write);
+  if (result != "true")
+  {
+    return "guest write after data change: " + result;
+  }
+
+  return "";
+}
+
+// Checks that memoizing functions by their arguments (including the calls for
+// which they are undefined) does not change results, also inside and between
+// with statements, and that it saves re-evaluating the function bodies.
+std::string memo_error()
+{
+  using namespace rego;
+  const Location entrypoint("memo/result");
+
+  Interpreter interpreter;
+  Node error = interpreter.add_module("memo.rego", R"(
+    package memo
+
+    is_allowed(r) if {
+      some grant in data.grants
+      grant.resource == r
+      grant.user == input.user
+    }
+
+    owner(r) := o if {
+      some grant in data.grants
+      grant.resource == r
+      o := grant.user
+    }
+
+    read if is_allowed(input.resource)
+    write if is_allowed(input.resource)
+    delete if is_allowed(input.resource)
+    others := {r | some r in ["a", "b", "c", "a", "b"]; is_allowed(r)}
+    owners := [owner(r) | some r in ["a", "b", "x", "a", "x"]]
+    scoped := [n |
+      some u in ["alice", "bob", "alice"]
+      n := count(others) with input.user as u
+    ]
+    scoped_ok := scoped == [2, 1, 2]
+    revoked := count(others) with data.grants as []
+
+    result := {
+      "read": read,
+      "write": write,
+      "delete": delete,
+      "others": others,
+      "owners": owners,
+      "scoped_ok": scoped_ok,
+      "revoked": revoked,
+    } if {
+      read
+    } else := {
+      "others": others,
+      "owners": owners,
+      "scoped_ok": scoped_ok,
+      "revoked": revoked,
+    }
+  )");
+  if (error == nullptr)
+  {
+    error = interpreter.add_data_json(R"({"grants": [
+      {"resource": "a", "user": "alice"},
+      {"resource": "b", "user": "bob"},
+      {"resource": "c", "user": "alice"}
+    ]})");
+  }
+
+  if (error != nullptr)
+  {
+    return to_key(error);
+  }
+
+  interpreter.entrypoints({std::string(entrypoint.view())});
+  Node bundle_node = interpreter.build();
+  if (bundle_node == ErrorSeq)
+  {
+    return to_key(bundle_node);
+  }
+
+  VirtualMachine vm;
+  vm.bundle(BundleDef::from_node(bundle_node))
+    .builtins(interpreter.builtins());
+
+  for (std::string user : {"alice", "bob", "carol"})
+  {
+    interpreter.set_input_term(
+      R"({"user": ")" + user + R"(", "resource": "a"})");
+    Node input = interpreter.input();
+
+    std::vector<std::string> results;
+    std::vector<std::uint64_t> stmts;
+    for (size_t limit : {0, 1, 100})
+    {
+      vm.memo_limit(limit);
+      std::uint64_t before = vm.stmts_executed();
+      results.push_back(to_key(vm.run_entrypoint(entrypoint, input)));
+      stmts.push_back(vm.stmts_executed() - before);
+    }
+
+    for (size_t i = 1; i < results.size(); ++i)
+    {
+      if (results[i] != results[0])
+      {
+        return user + ": " + results[i] + " != " + results[0];
+      }
+    }
+
+    if (
+      results[0].find(R"("scoped_ok":true)") == std::string::npos ||
+      results[0].find(R"("revoked":0)") == std::string::npos)
+    {
+      return user + ": wrong results under with: " + results[0];
+    }
+
+    if (stmts[2] >= stmts[0])
+    {
+      return user + ": memoization did not save any statements";
+    }
+  }
+
+  return "";
+}
+
+// Checks that rules guarded by comparing the input with constant strings
+// give the same results when only the bodies which can match are run, and
+// that the other bodies are skipped.
+std::string rule_index_error()
+{
+  using namespace rego;
+  const Location allow("gateway/allow");
+  const Location probe("gateway/probe");
+  const int num_rules = 40;
+  const std::vector<std::string> methods{"GET", "POST", "PUT", "DELETE"};
+
+  std::ostringstream policy;
+  policy << "package gateway\n\n"
+         << "default allow := false\n"
+         << "probe := allow with input as "
+         << R"({"method": "PUT", "path": "/r2"})" << "\n";
+  for (int i = 0; i < num_rules; ++i)
+  {
+    policy << "allow if {\n"
+           << "  input.method == \"" << methods[i % methods.size()] << "\"\n"
+           << "  input.path == \"/r" << i << "\"\n"
+           << "}\n";
+  }
+
+  Interpreter interpreter;
+  Node error = interpreter.add_module("gateway.rego", policy.str());
+  if (error != nullptr)
+  {
+    return to_key(error);
+  }
+
+  interpreter.entrypoints({"gateway/allow", "gateway/probe"});
+  Node bundle_node = interpreter.build();
+  if (bundle_node == ErrorSeq)
+  {
+    return to_key(bundle_node);
+  }
+
+  VirtualMachine vm;
+  vm.bundle(BundleDef::from_node(bundle_node))
+    .builtins(interpreter.builtins());
+
+  auto eval = [&](const Location& entrypoint, const std::string& input) {
+    interpreter.set_input_term(input);
+    Output output(vm.run_entrypoint(entrypoint, interpreter.input()));
+    if (!output.ok())
+    {
+      return "error: " + to_key(output.node());
+    }
+
+    return to_key(output.expressions()->front());
+  };
+
+  const std::vector<std::pair<std::string, std::string>> cases{
+    {R"({"method": "GET", "path": "/r0"})", "true"},
+    {R"({"method": "POST", "path": "/r1"})", "true"},
+    {R"({"method": "DELETE", "path": "/r39"})", "true"},
+    {R"({"method": "GET", "path": "/r1"})", "false"},
+    {R"({"method": "PATCH", "path": "/r0"})", "false"},
+    {R"({"method": 1, "path": "/r0"})", "false"},
+    {R"({"path": "/r0"})", "false"},
+    {R"("GET")", "false"},
+  };
+  for (const auto& [input, expected] : cases)
+  {
+    std::string result = eval(allow, input);
+    if (result != expected)
+    {
+      return input + ": expected " + expected + ", got " + result;
+    }
+  }
+
+  std::string result = eval(probe, R"({"method": "GET"})");
+  if (result != "true")
+  {
+    return "probe: expected true, got " + result;
+  }
+
+  // each body costs at least two statements when it is tried
+  std::uint64_t before = vm.stmts_executed();
+  eval(allow, R"({"method": "PATCH", "path": "/r0"})");
+  std::uint64_t stmts = vm.stmts_executed() - before;
+  if (stmts >= num_rules)
+  {
+    return "the bodies were not skipped (" + std::to_string(stmts) +
+      " statements)";
+  }
+
+  return "";
+}
+
+// Checks that scans of the data for the items with a field equal to a value
+// from the input give the same results when only those items are visited,
+// and that the other items are skipped.
+std::string field_index_error()
+{
+  using namespace rego;
+  const Location names("users/names");
+  const Location probe("users/probe");
+  const int num_users = 100;
+
+  std::ostringstream data;
+  data << R"({"users": [)";
+  for (int i = 0; i < num_users; ++i)
+  {
+    data << R"({"id": "u)" << i << R"(", "name": "user )" << i << R"("},)";
+  }
+  data << R"({"id": "u1", "name": "again"}, {"id": 2, "name": "number"}]})";
+
+  Interpreter interpreter;
+  Node error = interpreter.add_module("users.rego", R"(
+    package users
+
+    names := [u.name | some u in data.users; u.id == input.id]
+    probe := names with data.users as [{"id": "x", "name": "X"}]
+  )");
+  if (error == nullptr)
+  {
+    error = interpreter.add_data_json(data.str());
+  }
+
+  if (error != nullptr)
+  {
+    return to_key(error);
+  }
+
+  interpreter.entrypoints({"users/names", "users/probe"});
+  Node bundle_node = interpreter.build();
+  if (bundle_node == ErrorSeq)
+  {
+    return to_key(bundle_node);
+  }
+
+  VirtualMachine vm;
+  vm.bundle(BundleDef::from_node(bundle_node))
+    .builtins(interpreter.builtins());
+
+  auto eval = [&](const Location& entrypoint, const std::string& input) {
+    interpreter.set_input_term(input);
+    Output output(vm.run_entrypoint(entrypoint, interpreter.input()));
+    if (!output.ok())
+    {
+      return "error: " + to_key(output.node());
+    }
+
+    return to_key(output.expressions()->front());
+  };
+
+  const std::vector<std::pair<std::string, std::string>> cases{
+    {R"({"id": "u0"})", R"(["user 0"])"},
+    {R"({"id": "u1"})", R"(["user 1", "again"])"},
+    {R"({"id": "u99"})", R"(["user 99"])"},
+    {R"({"id": "nobody"})", "[]"},
+    {R"({"id": 2})", R"(["number"])"},
+    {R"({"id": "x"})", "[]"},
+  };
+  for (const auto& [input, expected] : cases)
+  {
+    std::string result = eval(names, input);
+    if (result != expected)
+    {
+      return input + ": expected " + expected + ", got " + result;
+    }
+  }
+
+  std::string result = eval(probe, R"({"id": "x"})");
+  if (result != R"(["X"])")
+  {
+    return "probe: expected [\"X\"], got " + result;
+  }
+
+  std::uint64_t before = vm.stmts_executed();
+  eval(names, R"({"id": "u50"})");
+  std::uint64_t stmts = vm.stmts_executed() - before;
+  if (stmts >= num_users)
+  {
+    return "the other users were not skipped (" + std::to_string(stmts) +
+      " statements)";
+  }
+
+  return "";
+}
+
+// Checks that the optimized bundle gives the same results as the bundle
+// produced without the optimization passes, while running fewer statements.
+// This includes calls in scan bodies which raise an error, which must not be
+// raised when the scan has no items or every item fails before the call.
+std::string optimize_error()
+{
+  using namespace rego;
+  const std::vector<Location> entrypoints{
+    "access/allow",
+    "access/names",
+    "access/active",
+    "access/probe",
+    "access/team",
+    "access/same_team",
+    "access/picked"};
+
+  const std::string policy = R"(
+    package access
+
+    default allow := false
+
+    allow if {
+      input.user.role == "admin"
+      input.user.active
+    }
+
+    allow if {
+      input.user.role == "owner"
+      input.user.name == input.resource.owner
+      not input.resource.locked
+    }
+
+    names := [name |
+      some u in input.users
+      name := u.name
+      name != input.user.name
+    ]
+
+    active := count([u | some u in input.users; u.active == true])
+
+    probe := allow with input.user.role as "admin"
+
+    team := [u.name |
+      some u in input.users
+      u.team == input.request.team
+      u.name != input.user.name
+    ]
+
+    team_of(r) := r.team
+    same_team := [u.name |
+      some u in input.users
+      u.team == team_of(input.request)
+    ]
+
+    pick(xs) := x if some x in xs
+    picked := [u.name |
+      some u in input.users
+      u.active == true
+      u.name == pick(input.pick)
+    ]
+  )";
+
+  auto build = [&](bool optimize) -> std::pair<Bundle, Node> {
+    Interpreter interpreter;
+    interpreter.optimize_enabled(optimize);
+    Node error = interpreter.add_module("access.rego", policy);
+    if (error != nullptr)
+    {
+      return {nullptr, error};
+    }
+
+    interpreter.entrypoints(
+      {"access/allow",
+       "access/names",
+       "access/active",
+       "access/probe",
+       "access/team",
+       "access/same_team",
+       "access/picked"});
+    Node bundle_node = interpreter.build();
+    if (bundle_node == ErrorSeq)
+    {
+      return {nullptr, bundle_node};
+    }
+
+    return {BundleDef::from_node(bundle_node), nullptr};
+  };
+
+  auto [plain, plain_error] = build(false);
+  if (plain == nullptr)
+  {
+    return to_key(plain_error);
+  }
+
+  auto [optimized, optimized_error] = build(true);
+  if (optimized == nullptr)
+  {
+    return to_key(optimized_error);
+  }
+
+  Interpreter interpreter;
+  VirtualMachine plain_vm;
+  plain_vm.bundle(plain).builtins(interpreter.builtins());
+  VirtualMachine optimized_vm;
+  optimized_vm.bundle(optimized).builtins(interpreter.builtins());
+
+  auto eval = [&](
+                VirtualMachine& vm,
+                const Location& entrypoint,
+                const std::string& input) {
+    interpreter.set_input_term(input);
+    Output output(vm.run_entrypoint(entrypoint, interpreter.input()));
+    if (!output.ok())
+    {
+      return "error: " + to_key(output.node());
+    }
+
+    return to_key(output.expressions()->front());
+  };
+
+  const std::vector<std::string> inputs{
+    R"({"user": {"name": "ann", "role": "admin", "active": true}})",
+    R"({"user": {"name": "ann", "role": "admin", "active": false}})",
+    R"({"user": {"name": "bob", "role": "owner"},
+        "resource": {"owner": "bob"}})",
+    R"({"user": {"name": "bob", "role": "owner"},
+        "resource": {"owner": "bob", "locked": true}})",
+    R"({"user": {"name": "bob", "role": "owner"},
+        "resource": {"owner": "cat"}})",
+    R"({"user": {"name": "bob"},
+        "users": [{"name": "ann", "active": true}, {"name": "bob"},
+                  {"name": "cat", "active": false}]})",
+    R"({"users": [{"name": "ann", "active": true}, {"active": true}]})",
+    R"({"user": {"name": "cat"}, "request": {"team": "red"},
+        "users": [{"name": "ann", "team": "red"}, {"name": "bob"},
+                  {"name": "cat", "team": "red"},
+                  {"name": "dan", "team": "blue"}]})",
+    R"({"request": {"team": "red"},
+        "users": [{"name": "ann", "team": "red"}, {"name": "bob"}]})",
+    R"({"user": {"name": "cat"},
+        "users": [{"name": "ann", "team": "red"}, {"name": "bob"}]})",
+    R"({"pick": ["ann", "bob"], "users": []})",
+    R"({"pick": ["ann", "bob"], "users": [{"name": "ann"}]})",
+    R"({"pick": ["ann", "bob"],
+        "users": [{"name": "ann", "active": true}]})",
+    R"({"pick": ["ann"],
+        "users": [{"name": "ann", "active": true}, {"name": "bob"}]})",
+    "{}",
+  };
+  for (const std::string& input : inputs)
+  {
+    for (const Location& entrypoint : entrypoints)
+    {
+      std::string expected = eval(plain_vm, entrypoint, input);
+      std::string result = eval(optimized_vm, entrypoint, input);
+      if (result != expected)
+      {
+        return std::string(entrypoint.view()) + " " + input + ": expected " +
+          expected + ", got " + result;
+      }
+    }
+  }
+
+  if (optimized_vm.stmts_executed() >= plain_vm.stmts_executed())
+  {
+    return "no statements were removed (" +
+      std::to_string(optimized_vm.stmts_executed()) + " vs " +
+      std::to_string(plain_vm.stmts_executed()) + " statements)";
+  }
+
+  std::string conflict = eval(
+    optimized_vm,
+    "access/picked",
+    R"({"pick": ["ann", "bob"], "users": [{"name": "ann", "active": true}]})");
+  if (!conflict.starts_with("error: "))
+  {
+    return "access/picked: expected a conflict error, got " + conflict;
+  }
+
+  return "";
+}
+
 int manual_whitelist_test()
 {
   auto start = std::chrono::steady_clock::now();
@@ -480,6 +1443,9 @@ int main(int argc, char** argv)
   bool wf_checks{false};
   app.add_flag("-w,--wf", wf_checks, "Enable well-formedness checks (slow)");
 
+  bool optimize{false};
+  app.add_flag("-o,--optimize", optimize, "Optimize the compiled bundles");
+
   bool fail_first{false};
   app.add_flag(
     "-f,--fail-first", fail_first, "Stop after first test case failure");
@@ -559,7 +1525,7 @@ int main(int argc, char** argv)
 
   if (note_match == "manual")
   {
-    total += 5;
+    total += 13;
     if (manual_construction_test(debug_path, wf_checks, log_level) != 0)
     {
       failures++;
@@ -584,6 +1550,46 @@ int main(int argc, char** argv)
     {
       failures++;
     }
+
+    if (run_manual_test("manual term identity test", term_identity_error))
+    {
+      failures++;
+    }
+
+    if (run_manual_test("manual concurrency test", concurrency_error))
+    {
+      failures++;
+    }
+
+    if (run_manual_test("manual state reuse test", state_reuse_error))
+    {
+      failures++;
+    }
+
+    if (run_manual_test("manual shared results test", shared_results_error))
+    {
+      failures++;
+    }
+
+    if (run_manual_test("manual memo test", memo_error))
+    {
+      failures++;
+    }
+
+    if (run_manual_test("manual rule index test", rule_index_error))
+    {
+      failures++;
+    }
+
+    if (run_manual_test("manual field index test", field_index_error))
+    {
+      failures++;
+    }
+
+    if (run_manual_test("manual optimize test", optimize_error))
+    {
+      failures++;
+    }
   }
 
   for (auto& [category, cat_cases] : all_testcases)
@@ -610,7 +1616,8 @@ int main(int argc, char** argv)
         logging::Info() << "Test " << testcase.note() << " from "
                         << testcase.filename();
         auto start = std::chrono::steady_clock::now();
-        auto result = testcase.run(debug_path, wf_checks, roundtrip, log_level);
+        auto result =
+          testcase.run(debug_path, wf_checks, optimize, roundtrip, log_level);
         auto end = std::chrono::steady_clock::now();
         const std::chrono::duration<double> elapsed = end - start;
 
@@ -642,6 +642,7 @@ namespace rego_test
   TestResult TestCase::run(
     const std::filesystem::path& debug_path,
     bool wf_checks,
+    bool optimize,
     RoundTrip roundtrip,
     LogLevel log_level) const
   {
@@ -649,6 +650,7 @@ namespace rego_test
     interpreter.builtins()->strict_errors(m_strict_error);
     interpreter.builtins()->register_builtins(custom_builtins(m_note));
     interpreter.wf_check_enabled(wf_checks)
+      .optimize_enabled(optimize)
       .debug_enabled(!debug_path.empty())
       .debug_path(debug_path)
       .log_level(log_level);
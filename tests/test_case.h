@@ -44,6 +44,7 @@ namespace rego_test
     TestResult run(
       const std::filesystem::path& debug_path,
       bool wf_checks,
+      bool optimize,
       RoundTrip roundtrip,
       LogLevel log_level) const;
 
@@ -1,6 +1,6 @@
 """regopy - Python wrapper for rego-cpp."""
 
-from .interpreter import Bundle, BundleFormat, Input, Interpreter
+from .interpreter import Bundle, BundleFormat, Input, Interpreter, PreparedQuery
 from .node import Node, NodeKind
 from .output import Output
 from .rego_shared import LogLevel, RegoError, rego_version
@@ -9,7 +9,7 @@ __version__ = rego_version()
 
 __all__ = [
     "Bundle", "BundleFormat", "Input", "Interpreter", "RegoError", "LogLevel",
-    "Output",
+    "Output", "PreparedQuery",
     "Node", "NodeKind"
 ]
 
@@ -35,6 +35,10 @@ from .rego_shared import (
     rego_bundle_node,
     rego_bundle_ok,
     rego_free_bundle,
+    rego_prepare,
+    rego_prepared_query_eval,
+    rego_prepared_query_eval_entrypoint,
+    rego_free_prepared_query,
     rego_free,
     rego_input_from_value,
     rego_free_input,
@@ -84,6 +88,69 @@ class Input:
             rego_free_input(self._impl)
 
 
+class PreparedQuery:
+    """A compiled query which can be evaluated many times with different inputs.
+
+    A prepared query is created by :func:`~regopy.Interpreter.prepare`. It holds
+    the compiled policy, so evaluating it does not recompile the modules, and it
+    is not affected by later changes to the interpreter.
+
+    Example:
+        >>> from regopy import Interpreter
+        >>> rego = Interpreter()
+        >>> rego.add_data({"a": 7})
+        >>> query = rego.prepare("x = data.a * input.y")
+        >>> print(query.eval({"y": 2}))
+        {"expressions":[true], "bindings":{"x":14}}
+        >>> print(query.eval({"y": 3}))
+        {"expressions":[true], "bindings":{"x":21}}
+    """
+
+    def __init__(self, impl):
+        self._impl = impl
+
+    def __del__(self):
+        if hasattr(self, "_impl"):
+            rego_free_prepared_query(self._impl)
+
+    def eval(self, value: Any = None) -> Output:
+        """Evaluates the query with the provided input.
+
+        Args:
+            value (Any): The input value, either an :class:`~regopy.Input` or a
+                         JSON encodable value. If None, the input is undefined.
+
+        Returns:
+            output (Output): The result of the query
+        """
+        if value is None:
+            return Output(rego_prepared_query_eval(self._impl, None))
+
+        if not isinstance(value, Input):
+            value = Input(value)
+
+        return Output(rego_prepared_query_eval(self._impl, value._impl))
+
+    def eval_entrypoint(self, entrypoint: str, value: Any = None) -> Output:
+        """Evaluates an entrypoint with the provided input.
+
+        Args:
+            entrypoint (str): The entrypoint to execute, which must have been
+                              provided to :func:`~regopy.Interpreter.prepare`.
+            value (Any): The input value, as for :func:`eval`.
+
+        Returns:
+            output (Output): The result of the entrypoint
+        """
+        if value is None:
+            return Output(rego_prepared_query_eval_entrypoint(self._impl, entrypoint, None))
+
+        if not isinstance(value, Input):
+            value = Input(value)
+
+        return Output(rego_prepared_query_eval_entrypoint(self._impl, entrypoint, value._impl))
+
+
 class Interpreter:
     """Pythonic interface to the rego-cpp interpreter.
 
@@ -485,6 +552,35 @@ class Interpreter:
 
         return Bundle(rego_build(self._impl))
 
+    def prepare(self, query: Optional[str] = None, entrypoints: Sequence[str] = tuple()) -> PreparedQuery:
+        """Compiles the policy once, for evaluation against many inputs.
+
+        Args:
+            query (Optional[str]): The query string. Either a query or at least
+                                   one entrypoint must be provided.
+
+            entrypoints (Sequence[str]): Zero or more entrypoints, as for
+                                         :func:`~regopy.Interpreter.build`.
+
+        Returns:
+            PreparedQuery: the compiled query, which can be evaluated with
+                           different inputs without recompiling.
+
+        Raises:
+            ValueError: If neither a query nor an entrypoint is provided.
+            RegoError: If an error occurs during compilation.
+        """
+        if query is None and len(entrypoints) == 0:
+            raise ValueError("no query or entrypoints specified")
+
+        if query is not None:
+            rego_set_query(self._impl, query)
+
+        for e in entrypoints:
+            rego_add_entrypoint(self._impl, e)
+
+        return PreparedQuery(rego_prepare(self._impl))
+
     def save_bundle(self, path: str, bundle: Bundle, format=BundleFormat.JSON):
         """Save a bundle to disk.
 
@@ -421,6 +421,49 @@ def rego_bundle_query_entrypoint(impl: ctypes.c_void_p, bundle: ctypes.c_void_p,
     return p_output
 
 
+rego.regoPrepare.restype = ctypes.c_void_p
+rego.regoPrepare.argtypes = [ctypes.c_void_p]
+
+
+def rego_prepare(impl: ctypes.c_void_p) -> ctypes.c_void_p:
+    p_query = rego.regoPrepare(impl)
+    if p_query is None or p_query == 0:
+        raise RegoError(rego_get_error(impl))
+
+    return p_query
+
+
+rego.regoPreparedQueryEval.restype = ctypes.c_void_p
+rego.regoPreparedQueryEval.argtypes = [ctypes.c_void_p, ctypes.c_void_p]
+
+
+def rego_prepared_query_eval(query: ctypes.c_void_p, p_input: ctypes.c_void_p) -> ctypes.c_void_p:
+    p_output = rego.regoPreparedQueryEval(query, p_input)
+    if p_output is None or p_output == 0:
+        raise RegoError("Unable to evaluate prepared query")
+
+    return p_output
+
+
+rego.regoPreparedQueryEvalEntrypoint.restype = ctypes.c_void_p
+rego.regoPreparedQueryEvalEntrypoint.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_void_p]
+
+
+def rego_prepared_query_eval_entrypoint(query: ctypes.c_void_p, entrypoint: str,
+                                        p_input: ctypes.c_void_p) -> ctypes.c_void_p:
+    p_entrypoint = ctypes.create_string_buffer(entrypoint.encode("utf-8"))
+    p_output = rego.regoPreparedQueryEvalEntrypoint(query, p_entrypoint, p_input)
+    if p_output is None or p_output == 0:
+        raise RegoError("Unable to evaluate prepared query")
+
+    return p_output
+
+
+rego.regoFreePreparedQuery.restype = None
+rego.regoFreePreparedQuery.argtypes = [ctypes.c_void_p]
+rego_free_prepared_query = rego.regoFreePreparedQuery
+
+
 # Output functions
 
 rego.regoOutputOk.restype = ctypes.c_bool
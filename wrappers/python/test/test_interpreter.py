@@ -214,3 +214,38 @@ def test_build():
     bundle_bin = rego_run.load_bundle(str(f), BundleFormat.Binary)
     output_bin = rego_run.query_bundle_entrypoint(bundle_bin, "example/foo")
     assert str(output) == str(output_bin)
+
+
+def test_prepare():
+    module = """
+        package example
+
+        foo := data.a * input.x + data.b * input.y
+    """
+
+    rego = Interpreter()
+    rego.add_data({"a": 7, "b": 13})
+    rego.add_module("test.rego", module)
+    query = rego.prepare("x=data.example.foo", ["example/foo"])
+
+    for x, y in [(104, 119), (1, 2), (0, 0)]:
+        output = query.eval({"x": x, "y": y})
+        assert output.binding("x").value == 7 * x + 13 * y
+
+        output = query.eval_entrypoint("example/foo", {"x": x, "y": y})
+        assert output.expressions()[0].value == 7 * x + 13 * y
+
+
+def test_prepare_entrypoints_only():
+    rego = Interpreter()
+    rego.add_module("test.rego", "package example\n\nfoo := input.x * 2\n")
+    query = rego.prepare(entrypoints=["example/foo"])
+    output = query.eval_entrypoint("example/foo", {"x": 21})
+    assert output.expressions()[0].value == 42
+
+
+def test_prepare_requires_query_or_entrypoint():
+    rego = Interpreter()
+    rego.add_module("test.rego", "package example\n\nfoo := 1\n")
+    with pytest.raises(ValueError):
+        rego.prepare()
@@ -383,6 +383,74 @@ impl PartialEq for Bundle {
     }
 }
 
+/// A query compiled once for evaluation against many inputs. This is produced
+/// by the [`Interpreter::prepare()`] method. Evaluating it does not recompile
+/// the policy, and it is not affected by later changes to the interpreter.
+/// A prepared query can be shared between threads.
+#[derive(Debug)]
+pub struct PreparedQuery {
+    c_ptr: *mut regoPreparedQuery,
+}
+
+unsafe impl Send for PreparedQuery {}
+unsafe impl Sync for PreparedQuery {}
+
+impl PreparedQuery {
+    fn new(c_ptr: *mut regoPreparedQuery) -> Self {
+        Self { c_ptr }
+    }
+
+    fn input_ptr(input: Option<&Input>) -> *mut regoInput {
+        match input {
+            Some(value) => value.c_ptr,
+            None => std::ptr::null_mut(),
+        }
+    }
+
+    /// Evaluates the query with the provided input (or an undefined input if
+    /// `None`).
+    pub fn eval(&self, input: Option<&Input>) -> Result<Output, String> {
+        let output_ptr = unsafe { regoPreparedQueryEval(self.c_ptr, Self::input_ptr(input)) };
+
+        if output_ptr == std::ptr::null_mut() {
+            Err("Unable to evaluate prepared query".to_string())
+        } else {
+            Ok(Output::new(output_ptr))
+        }
+    }
+
+    /// Evaluates an entrypoint with the provided input (or an undefined input
+    /// if `None`).
+    ///
+    /// This method requires that the entrypoint specified by `entrypoint`
+    /// was provided to [`Interpreter::prepare()`]. Otherwise, it will fail.
+    pub fn eval_entrypoint(
+        &self,
+        entrypoint: &str,
+        input: Option<&Input>,
+    ) -> Result<Output, String> {
+        let entrypoint_cstr = CString::new(entrypoint).unwrap();
+        let entrypoint_ptr = entrypoint_cstr.as_ptr();
+        let output_ptr = unsafe {
+            regoPreparedQueryEvalEntrypoint(self.c_ptr, entrypoint_ptr, Self::input_ptr(input))
+        };
+
+        if output_ptr == std::ptr::null_mut() {
+            Err("Unable to evaluate prepared query".to_string())
+        } else {
+            Ok(Output::new(output_ptr))
+        }
+    }
+}
+
+impl Drop for PreparedQuery {
+    fn drop(&mut self) {
+        unsafe {
+            regoFreePreparedQuery(self.c_ptr);
+        }
+    }
+}
+
 /// The Input interface allows the creation of inputs to a policy without
 /// requiring serialization to JSON. The interface is that of a stack,
 /// in which values are pushed and then various operations are used to turn
@@ -1115,6 +1183,64 @@ impl Interpreter {
         }
     }
 
+    /// Compiles the policy once, for evaluation against many inputs.
+    ///
+    /// The query and entrypoints are set as for [`Interpreter::build()`].
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// # use regorust::*;
+    /// let rego = Interpreter::new();
+    /// rego.add_data_json(r#"{"a": 7}"#).expect("Failed to add data");
+    /// let query = rego.prepare(&Some("x=data.a * input.y"), &[]).expect("Failed to prepare query");
+    /// for y in [2, 3] {
+    ///     let input = Input::new().str("y").int(y).objectitem().object(1)
+    ///         .validate().expect("Unable to create input");
+    ///     let result = query.eval(Some(&input)).expect("Failed query");
+    ///     let x = result.binding("x").expect("cannot get x");
+    ///     println!("x = {}", x.json().unwrap());
+    ///     # assert_eq!(x.json().unwrap(), (7 * y).to_string());
+    /// }
+    /// ```
+    pub fn prepare<T: AsRef<str>>(
+        &self,
+        query: &Option<T>,
+        entrypoints: &[T],
+    ) -> Result<PreparedQuery, String> {
+        match query {
+            Some(value) => {
+                let query_cstr = CString::new(value.as_ref()).unwrap();
+                let query_ptr = query_cstr.as_ptr();
+                let result = unsafe { regoSetQuery(self.c_ptr, query_ptr) };
+                if result != REGO_OK {
+                    return Err(self.get_error());
+                }
+            }
+            None => (),
+        }
+
+        for e in entrypoints {
+            let e_cstr = CString::new(e.as_ref()).unwrap();
+            let e_ptr = e_cstr.as_ptr();
+            let result = unsafe { regoAddEntrypoint(self.c_ptr, e_ptr) };
+            if result != REGO_OK {
+                return Err(self.get_error());
+            }
+        }
+
+        if entrypoints.is_empty() && query.is_none() {
+            return Err("Must provide at least one entrypoint or a query".to_string());
+        }
+
+        let query_ptr = unsafe { regoPrepare(self.c_ptr) };
+        if query_ptr == std::ptr::null_mut() {
+            Err(self.get_error())
+        } else {
+            Ok(PreparedQuery::new(query_ptr))
+        }
+    }
+
     /// Loads a bundle from the disk.
     pub fn load_bundle(&self, path: &Path, format: BundleFormat) -> Result<Bundle, String> {
         let path_str = path.to_str().unwrap();
@@ -2151,4 +2277,49 @@ mod tests {
             }
         };
     }
+
+    #[test]
+    fn prepare() {
+        let module = r#"
+            package test
+
+            foo := data.a * input.x + data.b * input.y
+        "#;
+
+        let rego = Interpreter::new();
+        rego.add_data_json(r#"{"a": 7, "b": 13}"#)
+            .expect("Unable to add data");
+        rego.add_module("test.rego", module)
+            .expect("Unable to add module");
+        let query = rego
+            .prepare(&Some("x=data.test.foo"), &["test/foo"])
+            .expect("Failed to prepare query");
+
+        for (x, y) in [(104, 119), (1, 2), (0, 0)] {
+            let input = Input::new()
+                .str("x")
+                .int(x)
+                .objectitem()
+                .str("y")
+                .int(y)
+                .objectitem()
+                .object(2)
+                .validate()
+                .expect("Unable to construct input");
+            let output = query.eval(Some(&input)).expect("Failed query");
+            let value = output
+                .binding("x")
+                .expect("cannot get x")
+                .json()
+                .expect("cannot convert x to JSON");
+            assert_eq!(value, (7 * x + 13 * y).to_string());
+
+            let output = query
+                .eval_entrypoint("test/foo", Some(&input))
+                .expect("Failed entrypoint query");
+            let expressions = output.expressions().expect("Unable to get expressions");
+            let value = expressions[0].json().expect("cannot convert to JSON");
+            assert_eq!(value, (7 * x + 13 * y).to_string());
+        }
+    }
 }